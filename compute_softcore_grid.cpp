@@ -21,11 +21,14 @@
 #include "compute_softcore_grid.h"
 #include "pair_hybrid_softcore.h"
 #include "pair_softcore.h"
+#include "fix_softcore_restraint.h"
+#include "modify.h"
 #include "force.h"
 #include "domain.h"
 #include "error.h"
 #include "string.h"
 #include "atom.h"
+#include "comm.h"
 #include "memory.h"
 
 using namespace LAMMPS_NS;
@@ -54,6 +57,7 @@ ComputeSoftcoreGrid::ComputeSoftcoreGrid(LAMMPS *lmp, int narg, char **arg) :
   }
   else {
     pair = new class PairSoftcore*[1];
+    npairs = 1;
     if (!(pair[0] = dynamic_cast<class PairSoftcore*>(force->pair)))
       error->all(FLERR,"Compute softcore/grid requires a softcore-type pair style");
   }
@@ -72,60 +76,74 @@ ComputeSoftcoreGrid::ComputeSoftcoreGrid(LAMMPS *lmp, int narg, char **arg) :
   size_vector = nodes;
   vector = new double[size_vector];
 
-  nmax = atom->nlocal;
-  if (force->newton_pair) nmax += atom->nghost;
-  memory->create(f,nmax,3,"compute_softcore_grid::f");
+  nrestraints = 0;
+  restraint = NULL;
 }
 
 /* ---------------------------------------------------------------------- */
 
 ComputeSoftcoreGrid::~ComputeSoftcoreGrid()
 {
-  memory->destroy(f);
+  delete [] pair;
+  delete [] vector;
+  delete [] restraint;
+}
+
+/* ----------------------------------------------------------------------
+   Retrieve lambda-coupled restraints, whose node energies are included
+------------------------------------------------------------------------- */
+
+void ComputeSoftcoreGrid::init()
+{
+  delete [] restraint;
+  restraint = new class FixSoftcoreRestraint*[modify->nfix];
+  nrestraints = 0;
+  for (int i = 0; i < modify->nfix; i++)
+    if (restraint[nrestraints] = dynamic_cast<class FixSoftcoreRestraint*>(modify->fix[i]))
+      nrestraints++;
+  for (int i = 0; i < nrestraints; i++)
+    if (restraint[i]->grid_size() != size_vector)
+      error->all(FLERR,"compute softcore/grid: restraint and lambda grids have different numbers of nodes");
 }
 
 /* ---------------------------------------------------------------------- */
 
 void ComputeSoftcoreGrid::compute_vector()
 {
-  // Compute lambda-related energy at every grid node:
-  for (int i = 0; i < size_vector; i++)
-    vector[i] = 0.0;
+  // Compute local lambda-related energy at every grid node:
+  double local[size_vector];
+  for (int j = 0; j < size_vector; j++)
+    local[j] = 0.0;
   for (int i = 0; i < npairs; i++) {
     if (pair[i]->gridsize != size_vector)
       error->all(FLERR,"compute softcore/grid: number of lambda nodes has changed");
-    double node_energy[size_vector];
-    if (!pair[i]->uptodate) {
-      int n = number_of_atoms();
-      std::swap(f,atom->f);
-      pair[i]->gridflag = 1;
-      pair[i]->compute(0,0);
-      std::swap(atom->f,f);
-    }
-    MPI_Allreduce(pair[i]->evdwlnode,&node_energy[0],size_vector,MPI_DOUBLE,MPI_SUM,world);
-    if (pair[i]->tail_flag) {
-      double volume = domain->xprd*domain->yprd*domain->zprd;
+    if (pair[i]->uptodate)
       for (int j = 0; j < size_vector; j++)
-        node_energy[j] += pair[i]->etailnode[j]/volume;
-    }
-    for (int j = 0; j < size_vector; j++)
-      vector[j] += node_energy[j];
+        local[j] += pair[i]->evdwlnode[j];
+    else
+      pair[i]->compute_softcore(pair[0]->scratch_forces(),local,NULL,0,0);
   }
-}
-
-/* ----------------------------------------------------------------------
-   Return the size of per-atom arrays (increase storage space if needed)
-------------------------------------------------------------------------- */
 
-int ComputeSoftcoreGrid::number_of_atoms()
-{
-  int n = atom->nlocal;
-  if (force->newton_pair)
-    n += atom->nghost;
-  if (n > nmax) {
-    nmax = n;
-    memory->grow(f,nmax,3,"compute_softcore_grid::f");
+  // Restraint energies at every node are summed into proc 0:
+  double erest[size_vector];
+  for (int j = 0; j < size_vector; j++)
+    erest[j] = 0.0;
+  for (int i = 0; i < nrestraints; i++)
+    restraint[i]->node_energies(erest);
+
+  // Sum into proc 0 over the procs holding softcore pairs, add tail
+  // corrections and restraints, and broadcast to all procs:
+  MPI_Comm gridcomm = pair[0]->grid_comm(pair,npairs);
+  if (gridcomm != MPI_COMM_NULL)
+    MPI_Reduce(local,vector,size_vector,MPI_DOUBLE,MPI_SUM,0,gridcomm);
+  if (comm->me == 0) {
+    for (int j = 0; j < size_vector; j++)
+      vector[j] += erest[j];
+    double volume = domain->xprd*domain->yprd*domain->zprd;
+    for (int i = 0; i < npairs; i++)
+      if (pair[i]->tail_flag)
+        for (int j = 0; j < size_vector; j++)
+          vector[j] += pair[i]->etailnode[j]/volume;
   }
-  return n;
+  MPI_Bcast(vector,size_vector,MPI_DOUBLE,0,world);
 }
-
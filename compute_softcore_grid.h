@@ -29,16 +29,14 @@ class ComputeSoftcoreGrid : public Compute {
  public:
   ComputeSoftcoreGrid(class LAMMPS *, int, char **);
   ~ComputeSoftcoreGrid();
-  void init() {}
+  void init();
   void compute_vector();
 
  private:
   int npairs;
   class PairSoftcore **pair;
-
-  int nmax;
-  double **f;
-  int number_of_atoms();
+  int nrestraints;
+  class FixSoftcoreRestraint **restraint;
 };
 
 }
@@ -0,0 +1,138 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under 
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------------
+   Contributing author: Charlles Abreu (abreu@eq.ufrj.br)
+                        Applied Thermodynamics & Molecular Simulation (ATOMS)
+                        Federal University of Rio de Janeiro / Brazil
+------------------------------------------------------------------------- */
+
+#include "mpi.h"
+#include "compute_softcore_perturb.h"
+#include "pair_hybrid_softcore.h"
+#include "pair_softcore.h"
+#include "force.h"
+#include "update.h"
+#include "domain.h"
+#include "error.h"
+#include "comm.h"
+
+using namespace LAMMPS_NS;
+
+/* ----------------------------------------------------------------------
+   compute ID all softcore/perturb
+   Element k of the vector is the energy of all perturbed softcore styles
+   with the coefficients of perturbation node k (see pair_modify perturb)
+   at the current lambda. Unperturbed softcore styles are not included.
+   The energies are computed along with the forces of the steps at which
+   the compute is invoked, or by an extra pass of the styles otherwise.
+------------------------------------------------------------------------- */
+
+ComputeSoftcorePerturb::ComputeSoftcorePerturb(LAMMPS *lmp, int narg,
+                                               char **arg) :
+  Compute(lmp, narg, arg)
+{
+  if (narg != 3)
+    error->all(FLERR,"Illegal compute softcore/perturb command");
+
+  if (igroup)
+    error->all(FLERR,"Compute softcore/perturb must use group all");
+
+  // Retrieve all softcore pair styles with perturbation nodes:
+  PairHybridSoftcore *hybrid = dynamic_cast<PairHybridSoftcore*>(force->pair);
+  PairSoftcore *style;
+  npairs = 0;
+  if (hybrid) {
+    pair = new class PairSoftcore*[hybrid->nstyles];
+    for (int i = 0; i < hybrid->nstyles; i++)
+      if ((style = dynamic_cast<class PairSoftcore*>(hybrid->styles[i])) &&
+          style->npert)
+        pair[npairs++] = style;
+  }
+  else {
+    pair = new class PairSoftcore*[1];
+    if ((style = dynamic_cast<class PairSoftcore*>(force->pair)) &&
+        style->npert)
+      pair[npairs++] = style;
+  }
+  if (npairs == 0)
+    error->all(FLERR,"Compute softcore/perturb requires a perturbed softcore pair style");
+
+  // Determine the number of perturbation nodes:
+  int nodes = pair[0]->npert;
+  for (int i = 1; i < npairs; i++)
+    if (pair[i]->npert != nodes)
+      error->all(FLERR,"Compute softcore/perturb: pair styles have different "
+                 "numbers of perturbation nodes");
+
+  vector_flag = 1;
+  timeflag = 1;
+  size_vector = nodes;
+  vector = new double[size_vector];
+}
+
+/* ---------------------------------------------------------------------- */
+
+ComputeSoftcorePerturb::~ComputeSoftcorePerturb()
+{
+  delete [] pair;
+  delete [] vector;
+}
+
+/* ----------------------------------------------------------------------
+   Make the styles compute perturbation energies at the steps at which
+   this compute is invoked (see Compute::addstep)
+------------------------------------------------------------------------- */
+
+void ComputeSoftcorePerturb::init()
+{
+  for (int i = 0; i < npairs; i++)
+    pair[i]->add_pert_compute(this);
+}
+
+/* ---------------------------------------------------------------------- */
+
+void ComputeSoftcorePerturb::compute_vector()
+{
+  // Use the energies computed along with the forces of this step, or
+  // evaluate them in one pass of each style, with forces discarded into
+  // a scratch buffer:
+  double local[size_vector];
+  for (int k = 0; k < size_vector; k++)
+    local[k] = 0.0;
+  for (int i = 0; i < npairs; i++) {
+    if (pair[i]->npert != size_vector)
+      error->all(FLERR,"Compute softcore/perturb: number of perturbation "
+                 "nodes has changed");
+    if (pair[i]->pertstep != update->ntimestep) {
+      pair[i]->pertflag = 1;
+      pair[i]->compute_softcore(pair[0]->scratch_forces(),NULL,NULL,0,0);
+    }
+    for (int k = 0; k < size_vector; k++)
+      local[k] += pair[i]->epertnode[k];
+  }
+
+  // Sum into proc 0 over the procs holding softcore pairs, add tail
+  // corrections, and broadcast to all procs:
+  MPI_Comm gridcomm = pair[0]->grid_comm(pair,npairs);
+  if (gridcomm != MPI_COMM_NULL)
+    MPI_Reduce(local,vector,size_vector,MPI_DOUBLE,MPI_SUM,0,gridcomm);
+  if (comm->me == 0) {
+    double volume = domain->xprd*domain->yprd*domain->zprd;
+    for (int i = 0; i < npairs; i++)
+      if (pair[i]->tail_flag)
+        for (int k = 0; k < size_vector; k++)
+          vector[k] += pair[i]->perturb_tail(k)/volume;
+  }
+  MPI_Bcast(vector,size_vector,MPI_DOUBLE,0,world);
+}
@@ -0,0 +1,71 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under 
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifdef COMPUTE_CLASS
+
+ComputeStyle(softcore/perturb,ComputeSoftcorePerturb)
+
+#else
+
+#ifndef LMP_COMPUTE_SOFTCORE_PERTURB_H
+#define LMP_COMPUTE_SOFTCORE_PERTURB_H
+
+#include "compute.h"
+#include "pair_softcore.h"
+
+namespace LAMMPS_NS {
+
+class ComputeSoftcorePerturb : public Compute {
+ public:
+  ComputeSoftcorePerturb(class LAMMPS *, int, char **);
+  ~ComputeSoftcorePerturb();
+  void init();
+  void compute_vector();
+
+ private:
+  int npairs;
+  class PairSoftcore **pair;
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Compute softcore/perturb must use group all
+
+Energies computed by potentials (pair, bond, etc) are computed on all
+atoms.
+
+E: Compute softcore/perturb requires a perturbed softcore pair style
+
+No softcore pair style has perturbation nodes.  Use pair_modify perturb
+to define them.
+
+E: Compute softcore/perturb: pair styles have different numbers of perturbation nodes
+
+All perturbed softcore sub-styles must define the same number of nodes.
+
+E: Compute softcore/perturb: number of perturbation nodes has changed
+
+The perturbation nodes were redefined after the compute was created.
+
+*/
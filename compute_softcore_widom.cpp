@@ -0,0 +1,331 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------------
+   Contributing author: Charlles Abreu (abreu@eq.ufrj.br)
+                        Applied Thermodynamics & Molecular Simulation (ATOMS)
+                        Federal University of Rio de Janeiro / Brazil
+------------------------------------------------------------------------- */
+
+#include "mpi.h"
+#include "math.h"
+#include "string.h"
+#include "compute_softcore_widom.h"
+#include "pair_hybrid_softcore.h"
+#include "atom.h"
+#include "molecule.h"
+#include "comm.h"
+#include "domain.h"
+#include "force.h"
+#include "update.h"
+#include "random_park.h"
+#include "math_extra.h"
+#include "math_const.h"
+#include "memory.h"
+#include "error.h"
+
+using namespace LAMMPS_NS;
+using namespace MathConst;
+
+/* ----------------------------------------------------------------------
+   compute ID all softcore/widom N T seed type I
+   compute ID all softcore/widom N T seed mol template-ID
+   Each invocation inserts N virtual copies of an atom of type I or of a
+   rigid molecule at random positions and orientations, without changing
+   the system, and accumulates the Widom average of exp(-U/kT) at every
+   node of the lambda grid (or at the current lambda if there is no grid).
+   The vector holds the excess chemical potential at each node.
+------------------------------------------------------------------------- */
+
+ComputeSoftcoreWidom::ComputeSoftcoreWidom(LAMMPS *lmp, int narg, char **arg) :
+  Compute(lmp, narg, arg)
+{
+  if (narg != 8) error->all(FLERR,"Illegal compute softcore/widom command");
+  if (igroup)
+    error->all(FLERR,"Compute softcore/widom must use group all");
+
+  ninsert = force->inumeric(FLERR,arg[3]);
+  double temperature = force->numeric(FLERR,arg[4]);
+  int seed = force->inumeric(FLERR,arg[5]);
+  if (ninsert <= 0 || temperature <= 0.0 || seed <= 0)
+    error->all(FLERR,"Illegal compute softcore/widom command");
+  beta = 1.0/(force->boltz*temperature);
+
+  itype = 0;
+  onemol = NULL;
+  if (strcmp(arg[6],"type") == 0) {
+    itype = force->inumeric(FLERR,arg[7]);
+    if (itype < 1 || itype > atom->ntypes)
+      error->all(FLERR,"Illegal compute softcore/widom command");
+  }
+  else if (strcmp(arg[6],"mol") == 0) {
+    int index = atom->find_molecule(arg[7]);
+    if (index == -1)
+      error->all(FLERR,"Molecule template ID for compute softcore/widom does not exist");
+    onemol = atom->molecules[index];
+    onemol->compute_center();
+    for (int m = 0; m < onemol->natoms; m++)
+      if (onemol->type[m] < 1 || onemol->type[m] > atom->ntypes)
+        error->all(FLERR,"Illegal compute softcore/widom command");
+  }
+  else error->all(FLERR,"Illegal compute softcore/widom command");
+
+  // same seed on all procs, so that all procs draw the same insertions
+
+  random_equal = new RanPark(lmp,seed);
+
+  // Retrieve all lambda-related pair styles:
+  PairHybridSoftcore *hybrid = dynamic_cast<PairHybridSoftcore*>(force->pair);
+  if (hybrid) {
+    pair = new class PairSoftcore*[hybrid->nstyles];
+    npairs = 0;
+    for (int i = 0; i < hybrid->nstyles; i++)
+      if ((pair[npairs] = dynamic_cast<class PairSoftcore*>(hybrid->styles[i])))
+        npairs++;
+    if (npairs == 0)
+      error->all(FLERR,"Compute softcore/widom requires a softcore-type pair style");
+  }
+  else {
+    pair = new class PairSoftcore*[1];
+    npairs = 1;
+    if (!(pair[0] = dynamic_cast<class PairSoftcore*>(force->pair)))
+      error->all(FLERR,"Compute softcore/widom requires a softcore-type pair style");
+  }
+  for (int i = 0; i < npairs; i++)
+    if (!pair[i]->test_enable)
+      error->all(FLERR,"Compute softcore/widom: pair style has no energy-only kernel");
+
+  int nodes = pair[0]->gridsize;
+  for (int i = 1; i < npairs; i++)
+    if (pair[i]->gridsize != nodes)
+      error->all(FLERR,"Compute softcore/widom: lambda grids have different numbers of nodes");
+
+  vector_flag = 1;
+  size_vector = MAX(nodes,1);
+  extvector = 0;
+  vector = new double[size_vector];
+
+  active = NULL;
+  memory->create(energy,ninsert*size_vector,"widom:energy");
+  memory->create(all,ninsert*size_vector,"widom:all");
+  memory->create(lnsum,size_vector,"widom:lnsum");
+  count = 0.0;
+  for (int k = 0; k < size_vector; k++)
+    vector[k] = lnsum[k] = 0.0;
+
+  maxbin = maxatom = 0;
+  binhead = next = jlist = NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+
+ComputeSoftcoreWidom::~ComputeSoftcoreWidom()
+{
+  delete random_equal;
+  delete [] pair;
+  delete [] vector;
+  memory->destroy(active);
+  memory->destroy(energy);
+  memory->destroy(all);
+  memory->destroy(lnsum);
+  memory->destroy(binhead);
+  memory->destroy(next);
+  memory->destroy(jlist);
+}
+
+/* ----------------------------------------------------------------------
+   with pair style hybrid/softcore, flag the type pairs assigned to each
+   softcore sub-style
+------------------------------------------------------------------------- */
+
+void ComputeSoftcoreWidom::init()
+{
+  if (domain->triclinic)
+    error->all(FLERR,"Compute softcore/widom does not support triclinic boxes");
+
+  cutmax = 0.0;
+  for (int i = 0; i < npairs; i++)
+    cutmax = MAX(cutmax,pair[i]->cutforce);
+
+  memory->destroy(active);
+  active = NULL;
+  PairHybridSoftcore *hybrid = dynamic_cast<PairHybridSoftcore*>(force->pair);
+  if (!hybrid) return;
+
+  int n = atom->ntypes;
+  memory->create(active,npairs,n+1,n+1,"widom:active");
+  for (int p = 0; p < npairs; p++)
+    for (int i = 0; i <= n; i++)
+      for (int j = 0; j <= n; j++) {
+        active[p][i][j] = 0;
+        if (i == 0 || j == 0) continue;
+        for (int k = 0; k < hybrid->nmap[i][j]; k++)
+          if (hybrid->styles[hybrid->map[i][j][k]] == pair[p])
+            active[p][i][j] = 1;
+      }
+}
+
+/* ---------------------------------------------------------------------- */
+
+void ComputeSoftcoreWidom::compute_vector()
+{
+  invoked_vector = update->ntimestep;
+
+  int nodes = size_vector;
+  for (int i = 0; i < npairs; i++)
+    if (MAX(pair[i]->gridsize,1) != nodes)
+      error->all(FLERR,"Compute softcore/widom: number of lambda nodes has changed");
+
+  double radius = onemol ? onemol->molradius : 0.0;
+  double cutghost = MIN(comm->cutghost[0],MIN(comm->cutghost[1],comm->cutghost[2]));
+  if (radius + cutmax > cutghost)
+    error->all(FLERR,"Compute softcore/widom molecule is larger than the ghost cutoff");
+
+  bin_atoms();
+
+  // each proc evaluates the insertions whose center lies in its subdomain
+
+  double *boxlo = domain->boxlo;
+  double *prd = domain->prd;
+  double *sublo = domain->sublo;
+  double *subhi = domain->subhi;
+  double xgeom[3],quat[4],rotmat[3][3],xsite[3];
+
+  for (int i = 0; i < ninsert*nodes; i++) energy[i] = 0.0;
+
+  for (int t = 0; t < ninsert; t++) {
+    for (int k = 0; k < 3; k++)
+      xgeom[k] = boxlo[k] + random_equal->uniform()*prd[k];
+    if (onemol) {
+      // uniform random rotation (Shoemake's method)
+      double u1 = random_equal->uniform();
+      double u2 = MY_2PI*random_equal->uniform();
+      double u3 = MY_2PI*random_equal->uniform();
+      quat[0] = sqrt(1.0-u1)*sin(u2);
+      quat[1] = sqrt(1.0-u1)*cos(u2);
+      quat[2] = sqrt(u1)*sin(u3);
+      quat[3] = sqrt(u1)*cos(u3);
+      MathExtra::quat_to_mat(quat,rotmat);
+    }
+    if (xgeom[0] < sublo[0] || xgeom[0] >= subhi[0] ||
+        xgeom[1] < sublo[1] || xgeom[1] >= subhi[1] ||
+        xgeom[2] < sublo[2] || xgeom[2] >= subhi[2]) continue;
+
+    double *e = &energy[t*nodes];
+    int nsites = onemol ? onemol->natoms : 1;
+    for (int s = 0; s < nsites; s++) {
+      int stype = itype;
+      if (onemol) {
+        stype = onemol->type[s];
+        MathExtra::matvec(rotmat,onemol->dx[s],xsite);
+        MathExtra::add3(xsite,xgeom,xsite);
+      }
+      else MathExtra::copy3(xgeom,xsite);
+
+      int n = gather(xsite);
+      for (int p = 0; p < npairs; p++)
+        pair[p]->test_energy(stype,xsite,n,jlist,active ? active[p] : NULL,e);
+    }
+  }
+
+  MPI_Allreduce(energy,all,ninsert*nodes,MPI_DOUBLE,MPI_SUM,world);
+
+  // accumulate log(sum of exp(-beta*U)) without overflow
+
+  for (int t = 0; t < ninsert; t++)
+    for (int k = 0; k < nodes; k++) {
+      double x = -beta*all[t*nodes+k];
+      if (count == 0.0 && t == 0) lnsum[k] = x;
+      else if (x > lnsum[k]) lnsum[k] = x + log(1.0 + exp(lnsum[k] - x));
+      else lnsum[k] += log(1.0 + exp(x - lnsum[k]));
+    }
+  count += ninsert;
+
+  for (int k = 0; k < nodes; k++)
+    vector[k] = -(lnsum[k] - log(count))/beta;
+}
+
+/* ----------------------------------------------------------------------
+   bin owned and ghost atoms over this proc's subdomain extended by the
+   ghost cutoff, with bins not smaller than the largest pair cutoff
+------------------------------------------------------------------------- */
+
+void ComputeSoftcoreWidom::bin_atoms()
+{
+  double **x = atom->x;
+  int nall = atom->nlocal + atom->nghost;
+
+  int nbins = 1;
+  for (int d = 0; d < 3; d++) {
+    binlo[d] = domain->sublo[d] - comm->cutghost[d];
+    double length = domain->subhi[d] + comm->cutghost[d] - binlo[d];
+    nbin[d] = MAX(static_cast<int>(length/cutmax),1);
+    bininv[d] = nbin[d]/length;
+    nbins *= nbin[d];
+  }
+
+  if (nbins > maxbin) {
+    maxbin = nbins;
+    memory->destroy(binhead);
+    memory->create(binhead,maxbin,"widom:binhead");
+  }
+  if (nall > maxatom) {
+    maxatom = atom->nmax;
+    memory->destroy(next);
+    memory->destroy(jlist);
+    memory->create(next,maxatom,"widom:next");
+    memory->create(jlist,maxatom,"widom:jlist");
+  }
+
+  for (int i = 0; i < nbins; i++) binhead[i] = -1;
+  for (int i = nall-1; i >= 0; i--) {
+    int ix = static_cast<int>((x[i][0] - binlo[0])*bininv[0]);
+    int iy = static_cast<int>((x[i][1] - binlo[1])*bininv[1]);
+    int iz = static_cast<int>((x[i][2] - binlo[2])*bininv[2]);
+    if (x[i][0] < binlo[0] || ix >= nbin[0] ||
+        x[i][1] < binlo[1] || iy >= nbin[1] ||
+        x[i][2] < binlo[2] || iz >= nbin[2]) continue;
+    int ibin = (iz*nbin[1] + iy)*nbin[0] + ix;
+    next[i] = binhead[ibin];
+    binhead[ibin] = i;
+  }
+}
+
+/* ----------------------------------------------------------------------
+   store in jlist the atoms of the bins around point xs, return count
+------------------------------------------------------------------------- */
+
+int ComputeSoftcoreWidom::gather(double *xs)
+{
+  int c[3];
+  for (int d = 0; d < 3; d++)
+    c[d] = static_cast<int>((xs[d] - binlo[d])*bininv[d]);
+
+  int n = 0;
+  for (int iz = MAX(c[2]-1,0); iz <= MIN(c[2]+1,nbin[2]-1); iz++)
+    for (int iy = MAX(c[1]-1,0); iy <= MIN(c[1]+1,nbin[1]-1); iy++)
+      for (int ix = MAX(c[0]-1,0); ix <= MIN(c[0]+1,nbin[0]-1); ix++)
+        for (int j = binhead[(iz*nbin[1] + iy)*nbin[0] + ix]; j >= 0; j = next[j])
+          jlist[n++] = j;
+  return n;
+}
+
+/* ---------------------------------------------------------------------- */
+
+double ComputeSoftcoreWidom::memory_usage()
+{
+  double bytes = 2.0*ninsert*size_vector*sizeof(double);
+  bytes += maxbin*sizeof(int);
+  bytes += 2.0*maxatom*sizeof(int);
+  return bytes;
+}
@@ -0,0 +1,112 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifdef COMPUTE_CLASS
+
+ComputeStyle(softcore/widom,ComputeSoftcoreWidom)
+
+#else
+
+#ifndef LMP_COMPUTE_SOFTCORE_WIDOM_H
+#define LMP_COMPUTE_SOFTCORE_WIDOM_H
+
+#include "compute.h"
+#include "pair_softcore.h"
+
+namespace LAMMPS_NS {
+
+class ComputeSoftcoreWidom : public Compute {
+ public:
+  ComputeSoftcoreWidom(class LAMMPS *, int, char **);
+  ~ComputeSoftcoreWidom();
+  void init();
+  void compute_vector();
+  double memory_usage();
+
+ private:
+  int ninsert;          // # of virtual insertions per invocation
+  double beta;          // 1/kT
+  class RanPark *random_equal;
+
+  int itype;            // type of the virtual atom (0 = molecule)
+  class Molecule *onemol;
+
+  int npairs;
+  class PairSoftcore **pair;
+  int ***active;        // type pairs of each sub-style (NULL = all)
+
+  double *energy;       // energy of each insertion at each node
+  double *all;
+  double *lnsum;        // log of the sum of exp(-beta*U) at each node
+  double count;         // # of insertions accumulated so far
+
+  // bins of owned and ghost atoms around this proc's subdomain
+
+  double cutmax;
+  double binlo[3],bininv[3];
+  int nbin[3];
+  int maxbin,maxatom;
+  int *binhead,*next,*jlist;
+
+  void bin_atoms();
+  int gather(double *);
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Compute softcore/widom must use group all
+
+The virtual insertions interact with all atoms.
+
+E: Molecule template ID for compute softcore/widom does not exist
+
+Self-explanatory.
+
+E: Compute softcore/widom requires a softcore-type pair style
+
+No pair style derived from PairSoftcore is defined.
+
+E: Compute softcore/widom: pair style has no energy-only kernel
+
+Every softcore sub-style must implement test-particle energies.
+
+E: Compute softcore/widom: lambda grids have different numbers of nodes
+
+All softcore sub-styles must share the same lambda grid.
+
+E: Compute softcore/widom: number of lambda nodes has changed
+
+Self-explanatory.
+
+E: Compute softcore/widom does not support triclinic boxes
+
+Self-explanatory.
+
+E: Compute softcore/widom molecule is larger than the ghost cutoff
+
+The neighbors of every virtual atom must be within the ghost atoms of
+the proc owning the insertion point. Increase the ghost cutoff with
+comm_modify cutoff.
+
+*/
@@ -0,0 +1,268 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------------
+   Contributing author: Charlles Abreu (abreu@eq.ufrj.br)
+                        Applied Thermodynamics & Molecular Simulation (ATOMS)
+                        Federal University of Rio de Janeiro / Brazil
+------------------------------------------------------------------------- */
+
+#include "mpi.h"
+#include "string.h"
+#include "dump_softcore.h"
+#include "pair_hybrid_softcore.h"
+#include "pair_softcore.h"
+#include "atom.h"
+#include "domain.h"
+#include "force.h"
+#include "neighbor.h"
+#include "update.h"
+#include "memory.h"
+#include "error.h"
+
+using namespace LAMMPS_NS;
+
+// per-atom record: id mol type q x y z ix iy iz
+
+#define RECORD 10
+
+/* ----------------------------------------------------------------------
+   dump ID group-ID softcore N file.bin [skin value]
+   group-ID defines the solute. Each frame contains the solute atoms and
+   every atom within the softcore cutoff (plus skin) of any solute atom.
+------------------------------------------------------------------------- */
+
+DumpSoftcore::DumpSoftcore(LAMMPS *lmp, int narg, char **arg) :
+  Dump(lmp, narg, arg)
+{
+  if (narg != 5) error->all(FLERR,"Illegal dump softcore command");
+
+  // the format is always compact binary:
+  binary = 1;
+  size_one = RECORD;
+
+  skin = -1.0;
+  maxlocal = 0;
+  choose = NULL;
+
+  nsolute = maxsolute = 0;
+  xsolute = NULL;
+  recvcounts = new int[nprocs];
+  displs = new int[nprocs];
+}
+
+/* ---------------------------------------------------------------------- */
+
+DumpSoftcore::~DumpSoftcore()
+{
+  memory->destroy(choose);
+  memory->destroy(xsolute);
+  delete [] recvcounts;
+  delete [] displs;
+}
+
+/* ----------------------------------------------------------------------
+   Determine the neighborhood radius from the largest cutoff among all
+   softcore pair styles
+------------------------------------------------------------------------- */
+
+void DumpSoftcore::init_style()
+{
+  double cutmax = -1.0;
+  PairHybridSoftcore *hybrid = dynamic_cast<PairHybridSoftcore*>(force->pair);
+  if (hybrid) {
+    for (int i = 0; i < hybrid->nstyles; i++)
+      if (dynamic_cast<class PairSoftcore*>(hybrid->styles[i]))
+        cutmax = MAX(cutmax,hybrid->styles[i]->cutforce);
+  }
+  else if (dynamic_cast<class PairSoftcore*>(force->pair))
+    cutmax = force->pair->cutforce;
+  if (cutmax < 0.0)
+    error->all(FLERR,"Dump softcore requires a softcore-type pair style");
+
+  double cut = cutmax + (skin < 0.0 ? neighbor->skin : skin);
+  cutsq = cut*cut;
+
+  double *prd = domain->prd;
+  for (int k = 0; k < 3; k++)
+    if (domain->periodicity[k] && cut > 0.5*prd[k])
+      error->all(FLERR,"Dump softcore neighborhood is larger than half the box");
+
+  // open single file, one time only
+
+  if (multifile == 0) openfile();
+}
+
+/* ---------------------------------------------------------------------- */
+
+int DumpSoftcore::modify_param(int narg, char **arg)
+{
+  if (strcmp(arg[0],"skin") == 0) {
+    if (narg < 2) error->all(FLERR,"Illegal dump_modify command");
+    skin = force->numeric(FLERR,arg[1]);
+    if (skin < 0.0) error->all(FLERR,"Illegal dump_modify command");
+    return 2;
+  }
+  return 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void DumpSoftcore::write_header(bigint ndump)
+{
+  fwrite(&update->ntimestep,sizeof(bigint),1,fp);
+  fwrite(&ndump,sizeof(bigint),1,fp);
+  fwrite(&domain->triclinic,sizeof(int),1,fp);
+  fwrite(&domain->boundary[0][0],6*sizeof(int),1,fp);
+  fwrite(&boxxlo,sizeof(double),1,fp);
+  fwrite(&boxxhi,sizeof(double),1,fp);
+  fwrite(&boxylo,sizeof(double),1,fp);
+  fwrite(&boxyhi,sizeof(double),1,fp);
+  fwrite(&boxzlo,sizeof(double),1,fp);
+  fwrite(&boxzhi,sizeof(double),1,fp);
+  if (domain->triclinic) {
+    fwrite(&boxxy,sizeof(double),1,fp);
+    fwrite(&boxxz,sizeof(double),1,fp);
+    fwrite(&boxyz,sizeof(double),1,fp);
+  }
+  fwrite(&size_one,sizeof(int),1,fp);
+  if (multiproc) fwrite(&nclusterprocs,sizeof(int),1,fp);
+  else fwrite(&nprocs,sizeof(int),1,fp);
+}
+
+/* ----------------------------------------------------------------------
+   Select owned atoms which are either solute atoms or lie within the
+   neighborhood radius of some solute atom (minimum image convention)
+------------------------------------------------------------------------- */
+
+int DumpSoftcore::count()
+{
+  int nlocal = atom->nlocal;
+  if (nlocal > maxlocal) {
+    maxlocal = atom->nmax;
+    memory->destroy(choose);
+    memory->create(choose,maxlocal,"dump:choose");
+  }
+
+  gather_solute();
+
+  double **x = atom->x;
+  int *mask = atom->mask;
+  double delta[3];
+
+  int m = 0;
+  for (int i = 0; i < nlocal; i++) {
+    choose[i] = mask[i] & groupbit;
+    for (int k = 0; !choose[i] && k < nsolute; k++) {
+      delta[0] = x[i][0] - xsolute[k][0];
+      delta[1] = x[i][1] - xsolute[k][1];
+      delta[2] = x[i][2] - xsolute[k][2];
+      domain->minimum_image(delta);
+      choose[i] = delta[0]*delta[0] + delta[1]*delta[1] +
+                  delta[2]*delta[2] < cutsq;
+    }
+    if (choose[i]) m++;
+  }
+  return m;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void DumpSoftcore::pack(tagint *ids)
+{
+  tagint *tag = atom->tag;
+  tagint *molecule = atom->molecule;
+  int *type = atom->type;
+  double *q = atom->q;
+  imageint *image = atom->image;
+  double **x = atom->x;
+  int nlocal = atom->nlocal;
+
+  int m = 0;
+  int n = 0;
+  for (int i = 0; i < nlocal; i++)
+    if (choose[i]) {
+      buf[m++] = tag[i];
+      buf[m++] = molecule ? molecule[i] : 0;
+      buf[m++] = type[i];
+      buf[m++] = q ? q[i] : 0.0;
+      buf[m++] = x[i][0];
+      buf[m++] = x[i][1];
+      buf[m++] = x[i][2];
+      buf[m++] = (image[i] & IMGMASK) - IMGMAX;
+      buf[m++] = (image[i] >> IMGBITS & IMGMASK) - IMGMAX;
+      buf[m++] = (image[i] >> IMG2BITS) - IMGMAX;
+      if (ids) ids[n++] = tag[i];
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+
+void DumpSoftcore::write_data(int n, double *mybuf)
+{
+  n *= size_one;
+  fwrite(&n,sizeof(int),1,fp);
+  fwrite(mybuf,sizeof(double),n,fp);
+}
+
+/* ----------------------------------------------------------------------
+   Make coordinates of all solute atoms available on every processor
+------------------------------------------------------------------------- */
+
+void DumpSoftcore::gather_solute()
+{
+  int nlocal = atom->nlocal;
+  int *mask = atom->mask;
+  double **x = atom->x;
+
+  int nmine = 0;
+  for (int i = 0; i < nlocal; i++)
+    if (mask[i] & groupbit) nmine++;
+
+  MPI_Allgather(&nmine,1,MPI_INT,recvcounts,1,MPI_INT,world);
+  nsolute = 0;
+  for (int iproc = 0; iproc < nprocs; iproc++) {
+    displs[iproc] = 3*nsolute;
+    nsolute += recvcounts[iproc];
+    recvcounts[iproc] *= 3;
+  }
+
+  if (nsolute > maxsolute) {
+    maxsolute = nsolute;
+    memory->destroy(xsolute);
+    memory->create(xsolute,maxsolute,3,"dump:xsolute");
+  }
+
+  double *sendbuf = new double[3*nmine+1];
+  int m = 0;
+  for (int i = 0; i < nlocal; i++)
+    if (mask[i] & groupbit) {
+      sendbuf[m++] = x[i][0];
+      sendbuf[m++] = x[i][1];
+      sendbuf[m++] = x[i][2];
+    }
+  double *recvbuf = nsolute ? &xsolute[0][0] : NULL;
+  MPI_Allgatherv(sendbuf,3*nmine,MPI_DOUBLE,recvbuf,recvcounts,displs,
+                 MPI_DOUBLE,world);
+  delete [] sendbuf;
+}
+
+/* ---------------------------------------------------------------------- */
+
+bigint DumpSoftcore::memory_usage()
+{
+  bigint bytes = Dump::memory_usage();
+  bytes += memory->usage(choose,maxlocal);
+  bytes += memory->usage(xsolute,maxsolute,3);
+  return bytes;
+}
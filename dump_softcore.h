@@ -0,0 +1,77 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifdef DUMP_CLASS
+
+DumpStyle(softcore,DumpSoftcore)
+
+#else
+
+#ifndef LMP_DUMP_SOFTCORE_H
+#define LMP_DUMP_SOFTCORE_H
+
+#include "dump.h"
+
+namespace LAMMPS_NS {
+
+class DumpSoftcore : public Dump {
+ public:
+  DumpSoftcore(class LAMMPS *, int, char **);
+  ~DumpSoftcore();
+
+ protected:
+  double skin;          // extra distance beyond the softcore cutoff
+  double cutsq;         // squared radius of the solute neighborhood
+  int maxlocal;         // size of choose array
+  int *choose;          // 1 if local atom is written in this frame
+
+  int nsolute;          // total # of solute atoms
+  int maxsolute;        // size of xsolute array
+  double **xsolute;     // coordinates of all solute atoms
+  int *recvcounts,*displs;
+
+  void init_style();
+  int modify_param(int, char **);
+  void write_header(bigint);
+  int count();
+  void pack(tagint *);
+  void write_data(int, double *);
+  bigint memory_usage();
+
+  void gather_solute();
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Dump softcore requires a softcore-type pair style
+
+No pair style derived from PairSoftcore is defined, so there is no
+lambda-coupled cutoff around which the solute neighborhood can be built.
+
+E: Dump softcore neighborhood is larger than half the box
+
+The softcore cutoff plus skin must be smaller than half of every
+periodic box length, so that the minimum image convention applies.
+
+*/
@@ -41,6 +41,7 @@ using namespace MathConst;
 enum{SINGLE,MOLECULE,GROUP};
 enum{NONE,XYZ,XY,YZ,XZ};
 enum{ISO,ANISO,TRICLINIC};
+enum{RICHARDSON,NO_SQUISH};
 
 #define MAXLINE 1024
 #define CHUNK 1024
@@ -62,7 +63,7 @@ FixRigid::FixRigid(LAMMPS *lmp, int narg, char **arg) :
   vcm(NULL), fcm(NULL), inertia(NULL), ex_space(NULL), 
   ey_space(NULL), ez_space(NULL), angmom(NULL), omega(NULL), 
   torque(NULL), quat(NULL), imagebody(NULL), fflag(NULL), 
-  tflag(NULL), langextra(NULL), sum(NULL), all(NULL), 
+  tflag(NULL), langextra(NULL), cmom(NULL), sum(NULL), all(NULL), 
   remapflag(NULL), xcmimage(NULL), eflags(NULL), orient(NULL), 
   dorient(NULL), id_dilate(NULL), random(NULL), avec_ellipsoid(NULL), 
   avec_line(NULL), avec_tri(NULL)
@@ -88,6 +89,8 @@ FixRigid::FixRigid(LAMMPS *lmp, int narg, char **arg) :
   body = NULL;
   xcmimage = NULL;
   displace = NULL;
+  weight = NULL;
+  weightflag = 0;
   eflags = NULL;
   orient = NULL;
   dorient = NULL;
@@ -235,6 +238,7 @@ FixRigid::FixRigid(LAMMPS *lmp, int narg, char **arg) :
   memory->create(angmom,nbody,3,"rigid:angmom");
   memory->create(omega,nbody,3,"rigid:omega");
   memory->create(torque,nbody,3,"rigid:torque");
+  memory->create(cmom,nbody,3,"rigid:cmom");
   memory->create(quat,nbody,4,"rigid:quat");
   memory->create(imagebody,nbody,"rigid:imagebody");
   memory->create(fflag,nbody,3,"rigid:fflag");
@@ -267,6 +271,8 @@ FixRigid::FixRigid(LAMMPS *lmp, int narg, char **arg) :
 
   int seed;
   langflag = 0;
+  rotflag = RICHARDSON;
+  vbodyflag = 0;
   reinitflag = 1;
 
   tstat_flag = 0;
@@ -366,6 +372,44 @@ FixRigid::FixRigid(LAMMPS *lmp, int narg, char **arg) :
       if (seed <= 0) error->all(FLERR,"Illegal fix rigid command");
       iarg += 5;
 
+    } else if (strcmp(arg[iarg],"rotate") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix rigid command");
+      if (strcmp(style,"rigid") != 0)
+        error->all(FLERR,"Illegal fix rigid command");
+      if (strcmp(arg[iarg+1],"richardson") == 0) rotflag = RICHARDSON;
+      else if (strcmp(arg[iarg+1],"no_squish") == 0) rotflag = NO_SQUISH;
+      else error->all(FLERR,"Illegal fix rigid command");
+      iarg += 2;
+
+    // virial atom = tally the constraint virial per atom (default)
+    // virial body = compute the global constraint virial from body-level
+    //   quantities, falling back to per-atom tallies on steps that need
+    //   the per-atom virial; Langevin forces and force components zeroed
+    //   by the force keyword are not part of the body-level expression,
+    //   so their virial is left out
+
+    } else if (strcmp(arg[iarg],"virial") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix rigid command");
+      if (strcmp(arg[iarg+1],"atom") == 0) vbodyflag = 0;
+      else if (strcmp(arg[iarg+1],"body") == 0) vbodyflag = 1;
+      else error->all(FLERR,"Illegal fix rigid command");
+      iarg += 2;
+
+    // weight Watom = output the extra cost of rigid-body work of each
+    //   atom as a per-atom vector, meant for balance or fix balance
+    //   through an atom-style variable, e.g.
+    //     variable w atom 1.0+f_ID
+    //     balance 1.1 shift xyz 10 1.1 weight var w
+    //   the weights only change the cost of atoms; the cuts cannot be
+    //   biased away from splitting bodies
+
+    } else if (strcmp(arg[iarg],"weight") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix rigid command");
+      weightflag = 1;
+      weight_atom = force->numeric(FLERR,arg[iarg+1]);
+      if (weight_atom < 0.0) error->all(FLERR,"Illegal fix rigid command");
+      iarg += 2;
+
     } else if (strcmp(arg[iarg],"temp") == 0) {
       if (iarg+4 > narg) error->all(FLERR,"Illegal fix rigid command");
       if (strcmp(style,"rigid/nvt") != 0 && strcmp(style,"rigid/npt") != 0 &&
@@ -525,6 +569,16 @@ FixRigid::FixRigid(LAMMPS *lmp, int narg, char **arg) :
   if (pcouple == XYZ || (dimension == 2 && pcouple == XY)) pstyle = ISO;
   else pstyle = ANISO;
 
+  // per-atom cost weights, usable by balance via an atom-style variable
+
+  if (weightflag) {
+    peratom_flag = 1;
+    size_peratom_cols = 0;
+    peratom_freq = 1;
+    vector_atom = weight;
+    for (i = 0; i < atom->nlocal; i++) weight[i] = 0.0;
+  }
+
   // initialize Marsaglia RNG with processor-unique seed
 
   if (langflag) random = new RanMars(lmp,seed + me);
@@ -604,6 +658,7 @@ FixRigid::~FixRigid()
   memory->destroy(body);
   memory->destroy(xcmimage);
   memory->destroy(displace);
+  memory->destroy(weight);
   memory->destroy(eflags);
   memory->destroy(orient);
   memory->destroy(dorient);
@@ -627,6 +682,7 @@ FixRigid::~FixRigid()
   memory->destroy(fflag);
   memory->destroy(tflag);
   memory->destroy(langextra);
+  memory->destroy(cmom);
 
   memory->destroy(sum);
   memory->destroy(all);
@@ -703,6 +759,18 @@ void FixRigid::init()
     setupflag = 1;
   }
 
+  if (vbodyflag && extended)
+    error->all(FLERR,"Fix rigid virial body cannot be used with extended particles");
+  if (vbodyflag && comm->me == 0) {
+    int partial = langflag;
+    for (int ibody = 0; ibody < nbody; ibody++)
+      for (int k = 0; k < domain->dimension; k++)
+        if (fflag[ibody][k] == 0.0) partial = 1;
+    if (partial)
+      error->warning(FLERR,"Fix rigid virial body omits Langevin forces "
+                     "and zeroed force components");
+  }
+
   // temperature scale factor
 
   double ndof = 0.0;
@@ -767,6 +835,7 @@ void FixRigid::setup(int vflag)
 
   for (ibody = 0; ibody < nbody; ibody++)
     for (i = 0; i < 6; i++) sum[ibody][i] = 0.0;
+  for (i = 0; i < 6; i++) fmoment[i] = 0.0;
 
   for (i = 0; i < nlocal; i++) {
     if (body[i] < 0) continue;
@@ -780,6 +849,15 @@ void FixRigid::setup(int vflag)
     sum[ibody][0] += dy * f[i][2] - dz * f[i][1];
     sum[ibody][1] += dz * f[i][0] - dx * f[i][2];
     sum[ibody][2] += dx * f[i][1] - dy * f[i][0];
+
+    if (vbodyflag) {
+      fmoment[0] += dx*f[i][0];
+      fmoment[1] += dy*f[i][1];
+      fmoment[2] += dz*f[i][2];
+      fmoment[3] += 0.5*(dx*f[i][1] + dy*f[i][0]);
+      fmoment[4] += 0.5*(dx*f[i][2] + dz*f[i][0]);
+      fmoment[5] += 0.5*(dy*f[i][2] + dz*f[i][1]);
+    }
   }
 
   // extended particles add their torque to torque of body
@@ -841,7 +919,7 @@ void FixRigid::setup(int vflag)
 
 void FixRigid::initial_integrate(int vflag)
 {
-  double dtfm;
+  double dtfm,mbody[3],conjqm[4];
 
   for (int ibody = 0; ibody < nbody; ibody++) {
 
@@ -864,17 +942,43 @@ void FixRigid::initial_integrate(int vflag)
     angmom[ibody][1] += dtf * torque[ibody][1] * tflag[ibody][1];
     angmom[ibody][2] += dtf * torque[ibody][2] * tflag[ibody][2];
 
-    // compute omega at 1/2 step from angmom at 1/2 step and current q
-    // update quaternion a full step via Richardson iteration
-    // returns new normalized quaternion, also updated omega at 1/2 step
+    // update quaternion a full step, either via Richardson iteration
+    // or via symplectic NO_SQUISH free rotations of conjugate momentum
     // update ex,ey,ez to reflect new quaternion
-
-    MathExtra::angmom_to_omega(angmom[ibody],ex_space[ibody],ey_space[ibody],
-                               ez_space[ibody],inertia[ibody],omega[ibody]);
-    MathExtra::richardson(quat[ibody],angmom[ibody],omega[ibody],
-                          inertia[ibody],dtq);
-    MathExtra::q_to_exyz(quat[ibody],
-                         ex_space[ibody],ey_space[ibody],ez_space[ibody]);
+    // omega at 1/2 step is computed from angmom and updated orientation
+
+    if (rotflag == NO_SQUISH) {
+      MathExtra::transpose_matvec(ex_space[ibody],ey_space[ibody],
+                                  ez_space[ibody],angmom[ibody],mbody);
+      MathExtra::quatvec(quat[ibody],mbody,conjqm);
+      conjqm[0] *= 2.0;
+      conjqm[1] *= 2.0;
+      conjqm[2] *= 2.0;
+      conjqm[3] *= 2.0;
+      MathExtra::no_squish_rotate(3,conjqm,quat[ibody],inertia[ibody],dtq);
+      MathExtra::no_squish_rotate(2,conjqm,quat[ibody],inertia[ibody],dtq);
+      MathExtra::no_squish_rotate(1,conjqm,quat[ibody],inertia[ibody],dtv);
+      MathExtra::no_squish_rotate(2,conjqm,quat[ibody],inertia[ibody],dtq);
+      MathExtra::no_squish_rotate(3,conjqm,quat[ibody],inertia[ibody],dtq);
+      MathExtra::qnormalize(quat[ibody]);
+      MathExtra::q_to_exyz(quat[ibody],
+                           ex_space[ibody],ey_space[ibody],ez_space[ibody]);
+      MathExtra::invquatvec(quat[ibody],conjqm,mbody);
+      MathExtra::matvec(ex_space[ibody],ey_space[ibody],ez_space[ibody],
+                        mbody,angmom[ibody]);
+      angmom[ibody][0] *= 0.5;
+      angmom[ibody][1] *= 0.5;
+      angmom[ibody][2] *= 0.5;
+      MathExtra::angmom_to_omega(angmom[ibody],ex_space[ibody],ey_space[ibody],
+                                 ez_space[ibody],inertia[ibody],omega[ibody]);
+    } else {
+      MathExtra::angmom_to_omega(angmom[ibody],ex_space[ibody],ey_space[ibody],
+                                 ez_space[ibody],inertia[ibody],omega[ibody]);
+      MathExtra::richardson(quat[ibody],angmom[ibody],omega[ibody],
+                            inertia[ibody],dtq);
+      MathExtra::q_to_exyz(quat[ibody],
+                           ex_space[ibody],ey_space[ibody],ez_space[ibody]);
+    }
   }
 
   // virial setup before call to set_xv
@@ -910,6 +1014,7 @@ void FixRigid::post_force(int vflag)
 
   for (ibody = 0; ibody < nbody; ibody++)
     for (i = 0; i < 6; i++) sum[ibody][i] = 0.0;
+  for (i = 0; i < 6; i++) fmoment[i] = 0.0;
 
   for (i = 0; i < nlocal; i++) {
     if (body[i] < 0) continue;
@@ -927,6 +1032,17 @@ void FixRigid::post_force(int vflag)
     sum[ibody][3] += dy*f[i][2] - dz*f[i][1];
     sum[ibody][4] += dz*f[i][0] - dx*f[i][2];
     sum[ibody][5] += dx*f[i][1] - dy*f[i][0];
+
+    // symmetric moment of atom forces around COM, for body-level virial
+
+    if (vbodyflag) {
+      fmoment[0] += dx*f[i][0];
+      fmoment[1] += dy*f[i][1];
+      fmoment[2] += dz*f[i][2];
+      fmoment[3] += 0.5*(dx*f[i][1] + dy*f[i][0]);
+      fmoment[4] += 0.5*(dx*f[i][2] + dz*f[i][0]);
+      fmoment[5] += 0.5*(dy*f[i][2] + dz*f[i][1]);
+    }
   }
 
   // extended particles add their torque to torque of body
@@ -1097,6 +1213,23 @@ void FixRigid::pre_neighbor()
   for (int ibody = 0; ibody < nbody; ibody++)
     domain->remap(xcm[ibody],imagebody[ibody]);
   image_shift();
+  if (weightflag) set_weights();
+}
+
+/* ----------------------------------------------------------------------
+   per-atom cost weights for load balancing
+   all bodies are integrated redundantly by every proc, so only the
+     per-atom work of set_xv(), set_v() and force/torque sums varies
+   weights migrate with atoms, so they remain valid between reneighborings
+   usage: variable w atom 1.0+f_ID, then balance/fix balance ... weight var w
+   biasing RCB or shift cuts away from bodies is not supported
+------------------------------------------------------------------------- */
+
+void FixRigid::set_weights()
+{
+  int nlocal = atom->nlocal;
+  for (int i = 0; i < nlocal; i++)
+    weight[i] = body[i] < 0 ? 0.0 : weight_atom;
 }
 
 /* ----------------------------------------------------------------------
@@ -1260,6 +1393,11 @@ void FixRigid::set_xv()
   int *type = atom->type;
   int nlocal = atom->nlocal;
 
+  // per-atom constraint virial, unless only the global virial is needed
+  // and it is computed from body-level quantities
+
+  int atomvirial = evflag && (!vbodyflag || vflag_atom);
+
   double xprd = domain->xprd;
   double yprd = domain->yprd;
   double zprd = domain->zprd;
@@ -1282,7 +1420,7 @@ void FixRigid::set_xv()
 
     // save old positions and velocities for virial
 
-    if (evflag) {
+    if (atomvirial) {
       if (triclinic == 0) {
         x0 = x[i][0] + xbox*xprd;
         x1 = x[i][1] + ybox*yprd;
@@ -1330,7 +1468,7 @@ void FixRigid::set_xv()
     // 1/2 factor b/c final_integrate contributes other half
     // assume per-atom contribution is due to constraint force on that atom
 
-    if (evflag) {
+    if (atomvirial) {
       if (rmass) massone = rmass[i];
       else massone = mass[type[i]];
       fc0 = massone*(v[i][0] - v0)/dtf - f[i][0];
@@ -1412,6 +1550,10 @@ void FixRigid::set_xv()
       }
     }
   }
+
+  // global constraint virial from body-level quantities
+
+  if (evflag && !atomvirial) body_virial();
 }
 
 /* ----------------------------------------------------------------------
@@ -1435,6 +1577,11 @@ void FixRigid::set_v()
   int *type = atom->type;
   int nlocal = atom->nlocal;
 
+  // per-atom constraint virial, unless only the global virial is needed
+  // and it is computed from body-level quantities
+
+  int atomvirial = evflag && (!vbodyflag || vflag_atom);
+
   double xprd = domain->xprd;
   double yprd = domain->yprd;
   double zprd = domain->zprd;
@@ -1455,7 +1602,7 @@ void FixRigid::set_v()
 
     // save old velocities for virial
 
-    if (evflag) {
+    if (atomvirial) {
       v0 = v[i][0];
       v1 = v[i][1];
       v2 = v[i][2];
@@ -1474,7 +1621,7 @@ void FixRigid::set_v()
     // 1/2 factor b/c initial_integrate contributes other half
     // assume per-atom contribution is due to constraint force on that atom
 
-    if (evflag) {
+    if (atomvirial) {
       if (rmass) massone = rmass[i];
       else massone = mass[type[i]];
       fc0 = massone*(v[i][0] - v0)/dtf - f[i][0];
@@ -1550,6 +1697,75 @@ void FixRigid::set_v()
       }
     }
   }
+
+  // global constraint virial from body-level quantities
+
+  if (evflag && !atomvirial) body_virial();
+}
+
+/* ----------------------------------------------------------------------
+   tally 1/2 of the global constraint virial of all rigid bodies,
+   as set_xv() and set_v() each contribute one half
+   for exact rigid motion, sum_i d_i (x) fc_i over the atoms of a body is
+     sym(C (-[alpha]x + omega omega^T)) - |omega|^2 C - sym(sum_i d_i (x) f_i)
+   C = second moment of mass, alpha = angular acceleration from Euler eqs
+   the force moment was summed per proc in post_force(), so each proc
+     tallies its own part, while proc 0 tallies all body-level terms
+   Langevin forces and zeroed force components are not included
+------------------------------------------------------------------------- */
+
+void FixRigid::body_virial()
+{
+  int a,b;
+  double c[3][3],m[3][3],k[3][3];
+  double tq[3],tb[3],ab[3],alpha[3],w2;
+  double vr[6];
+
+  for (a = 0; a < 6; a++) vr[a] = -0.5*fmoment[a];
+
+  if (me == 0)
+    for (int ibody = 0; ibody < nbody; ibody++) {
+      double *ex = ex_space[ibody];
+      double *ey = ey_space[ibody];
+      double *ez = ez_space[ibody];
+      double *w = omega[ibody];
+
+      for (a = 0; a < 3; a++)
+        for (b = 0; b < 3; b++)
+          c[a][b] = cmom[ibody][0]*ex[a]*ex[b] + cmom[ibody][1]*ey[a]*ey[b] +
+            cmom[ibody][2]*ez[a]*ez[b];
+
+      MathExtra::cross3(w,angmom[ibody],tq);
+      tq[0] = torque[ibody][0] - tq[0];
+      tq[1] = torque[ibody][1] - tq[1];
+      tq[2] = torque[ibody][2] - tq[2];
+      MathExtra::transpose_matvec(ex,ey,ez,tq,tb);
+      for (a = 0; a < 3; a++)
+        ab[a] = inertia[ibody][a] == 0.0 ? 0.0 : tb[a]/inertia[ibody][a];
+      MathExtra::matvec(ex,ey,ez,ab,alpha);
+
+      w2 = MathExtra::dot3(w,w);
+      m[0][0] = w[0]*w[0] - w2;
+      m[1][1] = w[1]*w[1] - w2;
+      m[2][2] = w[2]*w[2] - w2;
+      m[0][1] = w[0]*w[1] + alpha[2];
+      m[1][0] = w[1]*w[0] - alpha[2];
+      m[0][2] = w[0]*w[2] - alpha[1];
+      m[2][0] = w[2]*w[0] + alpha[1];
+      m[1][2] = w[1]*w[2] + alpha[0];
+      m[2][1] = w[2]*w[1] - alpha[0];
+
+      MathExtra::times3(c,m,k);
+
+      vr[0] += 0.5*k[0][0];
+      vr[1] += 0.5*k[1][1];
+      vr[2] += 0.5*k[2][2];
+      vr[3] += 0.25*(k[0][1] + k[1][0]);
+      vr[4] += 0.25*(k[0][2] + k[2][0]);
+      vr[5] += 0.25*(k[1][2] + k[2][1]);
+    }
+
+  for (a = 0; a < 6; a++) virial[a] += vr[a];
 }
 
 /* ----------------------------------------------------------------------
@@ -2066,6 +2282,15 @@ void FixRigid::setup_bodies_static()
       error->all(FLERR,"Fix rigid: Bad principal moments");
   }
 
+  // second moments of mass along principal axes, for body-level virial
+  // from re-computed point-particle moments, diagonal in principal frame
+
+  for (ibody = 0; ibody < nbody; ibody++) {
+    cmom[ibody][0] = 0.5*(all[ibody][1] + all[ibody][2] - all[ibody][0]);
+    cmom[ibody][1] = 0.5*(all[ibody][0] + all[ibody][2] - all[ibody][1]);
+    cmom[ibody][2] = 0.5*(all[ibody][0] + all[ibody][1] - all[ibody][2]);
+  }
+
   if (infile) memory->destroy(inbody);
 }
 
@@ -2355,6 +2580,7 @@ double FixRigid::memory_usage()
   double bytes = nmax * sizeof(int);
   bytes += nmax * sizeof(imageint);
   bytes += nmax*3 * sizeof(double);
+  bytes += nmax * sizeof(double);          // weight
   bytes += maxvatom*6 * sizeof(double);    // vatom
   if (extended) {
     bytes += nmax * sizeof(int);
@@ -2373,6 +2599,8 @@ void FixRigid::grow_arrays(int nmax)
   memory->grow(body,nmax,"rigid:body");
   memory->grow(xcmimage,nmax,"rigid:xcmimage");
   memory->grow(displace,nmax,3,"rigid:displace");
+  memory->grow(weight,nmax,"rigid:weight");
+  if (weightflag) vector_atom = weight;
   if (extended) {
     memory->grow(eflags,nmax,"rigid:eflags");
     if (orientflag) memory->grow(orient,nmax,orientflag,"rigid:orient");
@@ -2401,6 +2629,7 @@ void FixRigid::copy_arrays(int i, int j, int delflag)
   displace[j][0] = displace[i][0];
   displace[j][1] = displace[i][1];
   displace[j][2] = displace[i][2];
+  weight[j] = weight[i];
   if (extended) {
     eflags[j] = eflags[i];
     for (int k = 0; k < orientflag; k++)
@@ -2431,6 +2660,7 @@ void FixRigid::set_arrays(int i)
   displace[i][0] = 0.0;
   displace[i][1] = 0.0;
   displace[i][2] = 0.0;
+  weight[i] = 0.0;
 
   // must also zero vatom if per-atom virial calculated on this timestep
   // since vatom is calculated before and after atom migration
@@ -2451,9 +2681,11 @@ int FixRigid::pack_exchange(int i, double *buf)
   buf[2] = displace[i][0];
   buf[3] = displace[i][1];
   buf[4] = displace[i][2];
-  if (!extended) return 5;
 
   int m = 5;
+  if (weightflag) buf[m++] = weight[i];
+  if (!extended) return m;
+
   buf[m++] = eflags[i];
   for (int j = 0; j < orientflag; j++)
     buf[m++] = orient[i][j];
@@ -2484,9 +2716,11 @@ int FixRigid::unpack_exchange(int nlocal, double *buf)
   displace[nlocal][0] = buf[2];
   displace[nlocal][1] = buf[3];
   displace[nlocal][2] = buf[4];
-  if (!extended) return 5;
 
   int m = 5;
+  if (weightflag) weight[nlocal] = buf[m++];
+  if (!extended) return m;
+
   eflags[nlocal] = static_cast<int> (buf[m++]);
   for (int j = 0; j < orientflag; j++)
     orient[nlocal][j] = buf[m++];
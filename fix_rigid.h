@@ -81,6 +81,7 @@ class FixRigid : public Fix {
 
   int *body;                // which body each atom is part of (-1 if none)
   double **displace;        // displacement of each atom in body coords
+  double *weight;           // per-atom cost of body integration for balancing
 
   double *masstotal;        // total mass of each rigid body
   double **xcm;             // coords of center-of-mass of each rigid body
@@ -97,6 +98,7 @@ class FixRigid : public Fix {
   double **fflag;           // flag for on/off of center-of-mass force
   double **tflag;           // flag for on/off of center-of-mass torque
   double **langextra;       // Langevin thermostat forces and torques
+  double **cmom;            // 3 principal second moments of mass of each
 
   double **sum,**all;       // work vectors for each rigid body
   int **remapflag;          // PBC remap flags for each rigid body
@@ -114,6 +116,11 @@ class FixRigid : public Fix {
 
   double tfactor;           // scale factor on temperature of rigid bodies
   int langflag;             // 0/1 = no/yes Langevin thermostat
+  int rotflag;              // RICHARDSON or NO_SQUISH orientation update
+  int weightflag;           // 1 if per-atom cost weights are output
+  double weight_atom;       // cost of one body atom relative to a free atom
+  int vbodyflag;            // 1 if global virial is computed per body
+  double fmoment[6];        // moment of atom forces about COMs, this proc
 
   int tstat_flag;           // NVT settings
   double t_start,t_stop,t_target;
@@ -140,8 +147,10 @@ class FixRigid : public Fix {
   int OMEGA,ANGMOM,TORQUE;
 
   void image_shift();
+  void set_weights();
   void set_xv();
   void set_v();
+  void body_virial();
   void setup_bodies_static();
   void setup_bodies_dynamic();
   void readfile(int, double *, double **, double **, double **,
@@ -207,6 +216,18 @@ W: More than one fix rigid
 
 It is not efficient to use fix rigid more than once.
 
+E: Fix rigid virial body cannot be used with extended particles
+
+The body-level virial assumes point particles, whose second moments
+of mass follow from the principal moments of inertia.
+
+W: Fix rigid virial body omits Langevin forces and zeroed force components
+
+The body-level virial is computed from the deterministic forces and
+torques as applied to the bodies, so the virial of the Langevin forces
+and of force components switched off by the force keyword is not
+included in the pressure.  Use virial atom if it is needed.
+
 E: Rigid fix must come before NPT/NPH fix
 
 NPT/NPH fix must be defined in input script after all rigid fixes,
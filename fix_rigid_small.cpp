@@ -14,6 +14,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include "fix_rigid_small.h"
 #include "math_extra.h"
@@ -57,15 +58,19 @@ using namespace MathConst;
 
 enum{NONE,XYZ,XY,YZ,XZ};        // same as in FixRigid
 enum{ISO,ANISO,TRICLINIC};      // same as in FixRigid
+enum{RICHARDSON,NO_SQUISH};     // same as in FixRigid
 
-enum{FULL_BODY,INITIAL,FINAL,FORCE_TORQUE,VCM_ANGMOM,XCM_MASS,ITENSOR,DOF};
+enum{FULL_BODY,INITIAL,FINAL,FORCE_TORQUE,VCM_ANGMOM,XCM_MASS,ITENSOR,DOF,
+     BODYINDEX};
+enum{ALLATOMS,INTERIOR,BOUNDARY};   // atoms summed by sum_body_forces()
 
 /* ---------------------------------------------------------------------- */
 
 FixRigidSmall::FixRigidSmall(LAMMPS *lmp, int narg, char **arg) :
   Fix(lmp, narg, arg), step_respa(NULL), 
   infile(NULL), body(NULL), bodyown(NULL), bodytag(NULL), atom2body(NULL), 
-  xcmimage(NULL), displace(NULL), eflags(NULL), orient(NULL), dorient(NULL), 
+  xcmimage(NULL), displace(NULL), weight(NULL), eflags(NULL), orient(NULL),
+  dorient(NULL), 
   avec_ellipsoid(NULL), avec_line(NULL), avec_tri(NULL), counts(NULL), 
   itensor(NULL), mass_body(NULL), langextra(NULL), random(NULL), id_dilate(NULL), 
   onemols(NULL), hash(NULL), bbox(NULL), ctr(NULL), idclose(NULL), rsqclose(NULL)
@@ -94,6 +99,25 @@ FixRigidSmall::FixRigidSmall(LAMMPS *lmp, int narg, char **arg) :
   atom2body = NULL;
   xcmimage = NULL;
   displace = NULL;
+  weight = NULL;
+  weightflag = 0;
+  rmaflag = 0;
+  rmaproc = rmaindex = NULL;
+  nmax_rma = 0;
+  bsum = NULL;
+  maxbsum = 0;
+#ifdef LMP_RIGID_RMA
+  winflag = 0;
+  nrmarank = maxrmarank = 0;
+  rmarank = NULL;
+  rmaorigin = rmatarget = NULL;
+  rmareq = NULL;
+  nrmareq = 0;
+#endif
+  earlyflag = 0;
+  interior = NULL;
+  maxinterior = 0;
+  prestep = -1;
   eflags = NULL;
   orient = NULL;
   dorient = NULL;
@@ -132,6 +156,8 @@ FixRigidSmall::FixRigidSmall(LAMMPS *lmp, int narg, char **arg) :
 
   int seed;
   langflag = 0;
+  rotflag = RICHARDSON;
+  vbodyflag = 0;
   infile = NULL;
   onemols = NULL;
   reinitflag = 1;
@@ -171,6 +197,55 @@ FixRigidSmall::FixRigidSmall(LAMMPS *lmp, int narg, char **arg) :
       if (seed <= 0) error->all(FLERR,"Illegal fix rigid/small command");
       iarg += 5;
 
+    } else if (strcmp(arg[iarg],"rotate") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix rigid/small command");
+      if (strcmp(style,"rigid/small") != 0)
+        error->all(FLERR,"Illegal fix rigid/small command");
+      if (strcmp(arg[iarg+1],"richardson") == 0) rotflag = RICHARDSON;
+      else if (strcmp(arg[iarg+1],"no_squish") == 0) rotflag = NO_SQUISH;
+      else error->all(FLERR,"Illegal fix rigid/small command");
+      iarg += 2;
+
+    } else if (strcmp(arg[iarg],"rma") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix rigid/small command");
+      if (strcmp(arg[iarg+1],"no") == 0) rmaflag = 0;
+      else if (strcmp(arg[iarg+1],"yes") == 0) rmaflag = 1;
+      else error->all(FLERR,"Illegal fix rigid/small command");
+#ifndef LMP_RIGID_RMA
+      if (rmaflag) error->all(FLERR,"Fix rigid/small rma requires MPI-3");
+#endif
+      iarg += 2;
+
+    // virial atom = tally the constraint virial per atom (default)
+    // virial body = compute the global constraint virial from body-level
+    //   quantities, falling back to per-atom tallies on steps that need
+    //   the per-atom virial; Langevin forces are not part of the
+    //   body-level expression, so their virial is left out
+
+    } else if (strcmp(arg[iarg],"virial") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix rigid/small command");
+      if (strcmp(arg[iarg+1],"atom") == 0) vbodyflag = 0;
+      else if (strcmp(arg[iarg+1],"body") == 0) vbodyflag = 1;
+      else error->all(FLERR,"Illegal fix rigid/small command");
+      iarg += 2;
+
+    // weight Watom Wbody = output the extra cost of rigid-body work of
+    //   each atom as a per-atom vector, meant for balance or fix balance
+    //   through an atom-style variable, e.g.
+    //     variable w atom 1.0+f_ID
+    //     balance 1.1 rcb weight var w
+    //   the weights only change the cost of atoms; the RCB and shift cuts
+    //   cannot be biased away from splitting large bodies
+
+    } else if (strcmp(arg[iarg],"weight") == 0) {
+      if (iarg+3 > narg) error->all(FLERR,"Illegal fix rigid/small command");
+      weightflag = 1;
+      weight_atom = force->numeric(FLERR,arg[iarg+1]);
+      weight_body = force->numeric(FLERR,arg[iarg+2]);
+      if (weight_atom < 0.0 || weight_body < 0.0)
+        error->all(FLERR,"Illegal fix rigid/small command");
+      iarg += 3;
+
     } else if (strcmp(arg[iarg],"infile") == 0) {
       if (iarg+2 > narg) error->all(FLERR,"Illegal fix rigid/small command");
       delete [] infile;
@@ -343,6 +418,16 @@ FixRigidSmall::FixRigidSmall(LAMMPS *lmp, int narg, char **arg) :
   if (pcouple == XYZ || (domain->dimension == 2 && pcouple == XY)) pstyle = ISO;
   else pstyle = ANISO;
 
+  // per-atom cost weights, usable by balance via an atom-style variable
+
+  if (weightflag) {
+    peratom_flag = 1;
+    size_peratom_cols = 0;
+    peratom_freq = 1;
+    vector_atom = weight;
+    for (i = 0; i < atom->nlocal; i++) weight[i] = 0.0;
+  }
+
   // create rigid bodies based on molecule ID
   // sets bodytag for owned atoms
   // body attributes are computed later by setup_bodies()
@@ -464,9 +549,25 @@ FixRigidSmall::~FixRigidSmall()
   memory->destroy(atom2body);
   memory->destroy(xcmimage);
   memory->destroy(displace);
+  memory->destroy(weight);
   memory->destroy(eflags);
   memory->destroy(orient);
   memory->destroy(dorient);
+  memory->destroy(rmaproc);
+  memory->destroy(rmaindex);
+  memory->destroy(bsum);
+  memory->destroy(interior);
+#ifdef LMP_RIGID_RMA
+  if (winflag) {
+    MPI_Win_unlock_all(bodywin);
+    MPI_Win_free(&bodywin);
+    rma_types(0);
+  }
+  memory->destroy(rmarank);
+  memory->destroy(rmaorigin);
+  memory->destroy(rmatarget);
+  memory->destroy(rmareq);
+#endif
 
   delete random;
   delete [] infile;
@@ -482,6 +583,7 @@ int FixRigidSmall::setmask()
   int mask = 0;
   mask |= INITIAL_INTEGRATE;
   mask |= FINAL_INTEGRATE;
+  mask |= PRE_REVERSE;
   mask |= POST_FORCE;
   mask |= PRE_NEIGHBOR;
   mask |= INITIAL_INTEGRATE_RESPA;
@@ -524,6 +626,15 @@ void FixRigidSmall::init()
 
   if (strstr(update->integrate_style,"respa"))
     step_respa = ((Respa *) update->integrate)->step;
+
+  // atoms whose forces are final before reverse comm can be summed early,
+  //   unless fixes invoked before this one add forces in post_force()
+  //   or rRESPA sums forces level by level
+
+  earlyflag = 1;
+  if (strstr(update->integrate_style,"respa")) earlyflag = 0;
+  for (i = 0; i < modify->nfix && modify->fix[i] != this; i++)
+    if (modify->fmask[i] & POST_FORCE) earlyflag = 0;
 }
 
 /* ----------------------------------------------------------------------
@@ -550,6 +661,12 @@ void FixRigidSmall::setup_pre_neighbor()
   if ((reinitflag || !setupflag) && !infile)
     setup_bodies_dynamic();
 
+  if (vbodyflag && extended)
+    error->all(FLERR,"Fix rigid/small virial body cannot be used with extended particles");
+  if (vbodyflag && langflag && comm->me == 0)
+    error->warning(FLERR,"Fix rigid/small virial body omits Langevin forces");
+
+  if (weightflag) set_weights();
   setupflag = 1;
 }
 
@@ -582,6 +699,7 @@ void FixRigidSmall::setup(int vflag)
     tcm = body[ibody].torque;
     tcm[0] = tcm[1] = tcm[2] = 0.0;
   }
+  for (int k = 0; k < 6; k++) fmoment[k] = 0.0;
 
   for (i = 0; i < nlocal; i++) {
     if (atom2body[i] < 0) continue;
@@ -602,6 +720,15 @@ void FixRigidSmall::setup(int vflag)
     tcm[0] += dy * f[i][2] - dz * f[i][1];
     tcm[1] += dz * f[i][0] - dx * f[i][2];
     tcm[2] += dx * f[i][1] - dy * f[i][0];
+
+    if (vbodyflag) {
+      fmoment[0] += dx*f[i][0];
+      fmoment[1] += dy*f[i][1];
+      fmoment[2] += dz*f[i][2];
+      fmoment[3] += 0.5*(dx*f[i][1] + dy*f[i][0]);
+      fmoment[4] += 0.5*(dx*f[i][2] + dz*f[i][0]);
+      fmoment[5] += 0.5*(dy*f[i][2] + dz*f[i][1]);
+    }
   }
 
   // extended particles add their rotation/torque to angmom/torque of body
@@ -623,8 +750,7 @@ void FixRigidSmall::setup(int vflag)
 
   // reverse communicate fcm, torque of all bodies
 
-  commflag = FORCE_TORQUE;
-  comm->reverse_comm_fix(this,6);
+  reverse_bodies(FORCE_TORQUE,6);
 
   // virial setup before call to set_v
 
@@ -639,8 +765,7 @@ void FixRigidSmall::setup(int vflag)
                                b->ez_space,b->inertia,b->omega);
   }
 
-  commflag = FINAL;
-  comm->forward_comm_fix(this,10);
+  forward_bodies(FINAL,10);
 
   // set velocity/rotation of atoms in rigid bodues
 
@@ -661,7 +786,7 @@ void FixRigidSmall::setup(int vflag)
 
 void FixRigidSmall::initial_integrate(int vflag)
 {
-  double dtfm;
+  double dtfm,mbody[3],conjqm[4];
 
   //check(2);
 
@@ -687,15 +812,39 @@ void FixRigidSmall::initial_integrate(int vflag)
     b->angmom[1] += dtf * b->torque[1];
     b->angmom[2] += dtf * b->torque[2];
 
-    // compute omega at 1/2 step from angmom at 1/2 step and current q
-    // update quaternion a full step via Richardson iteration
-    // returns new normalized quaternion, also updated omega at 1/2 step
+    // update quaternion a full step, either via Richardson iteration
+    // or via symplectic NO_SQUISH free rotations of conjugate momentum
     // update ex,ey,ez to reflect new quaternion
-
-    MathExtra::angmom_to_omega(b->angmom,b->ex_space,b->ey_space,
-                               b->ez_space,b->inertia,b->omega);
-    MathExtra::richardson(b->quat,b->angmom,b->omega,b->inertia,dtq);
-    MathExtra::q_to_exyz(b->quat,b->ex_space,b->ey_space,b->ez_space);
+    // omega at 1/2 step is computed from angmom and updated orientation
+
+    if (rotflag == NO_SQUISH) {
+      MathExtra::transpose_matvec(b->ex_space,b->ey_space,b->ez_space,
+                                  b->angmom,mbody);
+      MathExtra::quatvec(b->quat,mbody,conjqm);
+      conjqm[0] *= 2.0;
+      conjqm[1] *= 2.0;
+      conjqm[2] *= 2.0;
+      conjqm[3] *= 2.0;
+      MathExtra::no_squish_rotate(3,conjqm,b->quat,b->inertia,dtq);
+      MathExtra::no_squish_rotate(2,conjqm,b->quat,b->inertia,dtq);
+      MathExtra::no_squish_rotate(1,conjqm,b->quat,b->inertia,dtv);
+      MathExtra::no_squish_rotate(2,conjqm,b->quat,b->inertia,dtq);
+      MathExtra::no_squish_rotate(3,conjqm,b->quat,b->inertia,dtq);
+      MathExtra::qnormalize(b->quat);
+      MathExtra::q_to_exyz(b->quat,b->ex_space,b->ey_space,b->ez_space);
+      MathExtra::invquatvec(b->quat,conjqm,mbody);
+      MathExtra::matvec(b->ex_space,b->ey_space,b->ez_space,mbody,b->angmom);
+      b->angmom[0] *= 0.5;
+      b->angmom[1] *= 0.5;
+      b->angmom[2] *= 0.5;
+      MathExtra::angmom_to_omega(b->angmom,b->ex_space,b->ey_space,
+                                 b->ez_space,b->inertia,b->omega);
+    } else {
+      MathExtra::angmom_to_omega(b->angmom,b->ex_space,b->ey_space,
+                                 b->ez_space,b->inertia,b->omega);
+      MathExtra::richardson(b->quat,b->angmom,b->omega,b->inertia,dtq);
+      MathExtra::q_to_exyz(b->quat,b->ex_space,b->ey_space,b->ez_space);
+    }
   }
 
   // virial setup before call to set_xv
@@ -705,14 +854,34 @@ void FixRigidSmall::initial_integrate(int vflag)
 
   // forward communicate updated info of all bodies
 
-  commflag = INITIAL;
-  comm->forward_comm_fix(this,26);
+  forward_bodies(INITIAL,26);
 
   // set coords/orient and velocity/rotation of atoms in rigid bodies
 
   set_xv();
 }
 
+/* ----------------------------------------------------------------------
+   sum forces and torques of interior atoms of owned bodies into bsum
+   invoked after the force computation but before reverse comm of atom
+     forces, which does not change the forces of interior atoms
+------------------------------------------------------------------------- */
+
+void FixRigidSmall::pre_reverse(int eflag, int vflag)
+{
+  if (!earlyflag) return;
+
+  if (nlocal_body > maxbsum) {
+    maxbsum = nmax_body;
+    memory->destroy(bsum);
+    memory->create(bsum,maxbsum,6,"rigid/small:bsum");
+  }
+
+  for (int k = 0; k < 6; k++) fmoment[k] = 0.0;
+  sum_body_forces(0,nlocal_body,bsum,INTERIOR);
+  prestep = update->ntimestep;
+}
+
 /* ----------------------------------------------------------------------
    apply Langevin thermostat to all 6 DOF of rigid bodies I own
    unlike fix langevin, this stores extra force in extra arrays,
@@ -721,14 +890,12 @@ void FixRigidSmall::initial_integrate(int vflag)
 
 void FixRigidSmall::post_force(int vflag)
 {
+  double *fcm,*tcm;
 
-  double **x = atom->x;
-  double **f = atom->f;
-  int nlocal = atom->nlocal;
+  // forces of interior atoms of owned bodies are already in bsum
+  //   if pre_reverse() was invoked on this step
 
-  double dx,dy,dz;
-  double unwrap[3];
-  double *xcm,*fcm,*tcm;
+  int early = earlyflag && prestep == update->ntimestep;
 
   // sum over atoms to get force and torque on rigid body
 
@@ -738,50 +905,35 @@ void FixRigidSmall::post_force(int vflag)
     tcm = body[ibody].torque;
     tcm[0] = tcm[1] = tcm[2] = 0.0;
   }
+  if (!early) for (int k = 0; k < 6; k++) fmoment[k] = 0.0;
 
-  for (int i = 0; i < nlocal; i++) {
-    if (atom2body[i] < 0) continue;
-    Body *b = &body[atom2body[i]];
-
-    fcm = b->fcm;
-    fcm[0] += f[i][0];
-    fcm[1] += f[i][1];
-    fcm[2] += f[i][2];
-
-    domain->unmap(x[i],xcmimage[i],unwrap);
-    xcm = b->xcm;
-    dx = unwrap[0] - xcm[0];
-    dy = unwrap[1] - xcm[1];
-    dz = unwrap[2] - xcm[2];
-
-    tcm = b->torque;
-    tcm[0] += dy*f[i][2] - dz*f[i][1];
-    tcm[1] += dz*f[i][0] - dx*f[i][2];
-    tcm[2] += dx*f[i][1] - dy*f[i][0];
+  if (nlocal_body > maxbsum) {
+    maxbsum = nmax_body;
+    memory->destroy(bsum);
+    memory->create(bsum,maxbsum,6,"rigid/small:bsum");
   }
 
-  // extended particles add their torque to torque of body
-
-  if (extended) {
-    double **torque = atom->torque;
+  // reverse communicate fcm, torque of all bodies
+  // ghost bodies are summed first, owned bodies are summed into bsum
+  //   which is added to them once the ghosts have been reduced
+  // with rma, the accumulation of ghosts into their owners proceeds while
+  //   the remaining atoms of owned bodies are summed
 
-    for (int i = 0; i < nlocal; i++) {
-      if (atom2body[i] < 0) continue;
+  sum_body_forces(nlocal_body,nlocal_body+nghost_body,NULL,ALLATOMS);
+  if (rmaflag) reverse_bodies_start();
+  else reverse_bodies(FORCE_TORQUE,6);
+  sum_body_forces(0,nlocal_body,bsum,early ? BOUNDARY : ALLATOMS);
+  if (rmaflag) reverse_bodies_finish();
 
-      if (eflags[i] & TORQUE) {
-        tcm = body[atom2body[i]].torque;
-        tcm[0] += torque[i][0];
-        tcm[1] += torque[i][1];
-        tcm[2] += torque[i][2];
-      }
+  for (int ibody = 0; ibody < nlocal_body; ibody++) {
+    fcm = body[ibody].fcm;
+    tcm = body[ibody].torque;
+    for (int k = 0; k < 3; k++) {
+      fcm[k] += bsum[ibody][k];
+      tcm[k] += bsum[ibody][3+k];
     }
   }
 
-  // reverse communicate fcm, torque of all bodies
-
-  commflag = FORCE_TORQUE;
-  comm->reverse_comm_fix(this,6);
-
   // include Langevin thermostat forces and torques
 
   if (langflag) {
@@ -902,8 +1054,7 @@ void FixRigidSmall::final_integrate()
 
   // forward communicate updated info of all bodies
 
-  commflag = FINAL;
-  comm->forward_comm_fix(this,10);
+  forward_bodies(FINAL,10);
 
   // set velocity/rotation of atoms in rigid bodies
   // virial is already setup from initial_integrate
@@ -965,9 +1116,47 @@ void FixRigidSmall::pre_neighbor()
   commflag = FULL_BODY;
   comm->forward_comm_fix(this);
   reset_atom2body();
+  rma_setup();
+  find_interior();
   //check(4);
 
   image_shift();
+  if (weightflag) set_weights();
+}
+
+/* ----------------------------------------------------------------------
+   per-atom cost weights for load balancing
+   each body atom costs weight_atom (set_xv, set_v, force/torque sums)
+   each owned body costs weight_body (integration, migration of Body struct),
+     assigned to its owning atom
+   each ghost body also costs weight_body (forward comm of the body and
+     reverse comm of its force/torque), assigned to one local atom of it,
+     so that procs holding fragments of split bodies appear more loaded
+   weights migrate with atoms, so they remain valid between reneighborings
+   usage: variable w atom 1.0+f_ID, then balance/fix balance ... weight var w
+   biasing RCB or shift cuts away from large bodies is not supported
+------------------------------------------------------------------------- */
+
+void FixRigidSmall::set_weights()
+{
+  int nlocal = atom->nlocal;
+
+  int *charged = new int[nghost_body+1];
+  for (int ibody = 0; ibody < nghost_body; ibody++) charged[ibody] = 0;
+
+  for (int i = 0; i < nlocal; i++) {
+    weight[i] = 0.0;
+    if (atom2body[i] < 0) continue;
+    weight[i] = weight_atom;
+    if (bodyown[i] >= 0) weight[i] += weight_body;
+    int ighost = atom2body[i] - nlocal_body;
+    if (ighost >= 0 && !charged[ighost]) {
+      weight[i] += weight_body;
+      charged[ighost] = 1;
+    }
+  }
+
+  delete [] charged;
 }
 
 /* ----------------------------------------------------------------------
@@ -1148,6 +1337,11 @@ void FixRigidSmall::set_xv()
   int *type = atom->type;
   int nlocal = atom->nlocal;
 
+  // per-atom constraint virial, unless only the global virial is needed
+  // and it is computed from body-level quantities
+
+  int atomvirial = evflag && (!vbodyflag || vflag_atom);
+
   // set x and v of each atom
 
   for (int i = 0; i < nlocal; i++) {
@@ -1160,7 +1354,7 @@ void FixRigidSmall::set_xv()
 
     // save old positions and velocities for virial
 
-    if (evflag) {
+    if (atomvirial) {
       if (triclinic == 0) {
         x0 = x[i][0] + xbox*xprd;
         x1 = x[i][1] + ybox*yprd;
@@ -1204,7 +1398,7 @@ void FixRigidSmall::set_xv()
     // 1/2 factor b/c final_integrate contributes other half
     // assume per-atom contribution is due to constraint force on that atom
 
-    if (evflag) {
+    if (atomvirial) {
       if (rmass) massone = rmass[i];
       else massone = mass[type[i]];
       fc0 = massone*(v[i][0] - v0)/dtf - f[i][0];
@@ -1285,6 +1479,10 @@ void FixRigidSmall::set_xv()
       }
     }
   }
+
+  // global constraint virial from body-level quantities
+
+  if (evflag && !atomvirial) body_virial();
 }
 
 /* ----------------------------------------------------------------------
@@ -1314,6 +1512,11 @@ void FixRigidSmall::set_v()
   int *type = atom->type;
   int nlocal = atom->nlocal;
 
+  // per-atom constraint virial, unless only the global virial is needed
+  // and it is computed from body-level quantities
+
+  int atomvirial = evflag && (!vbodyflag || vflag_atom);
+
   // set v of each atom
 
   for (int i = 0; i < nlocal; i++) {
@@ -1324,7 +1527,7 @@ void FixRigidSmall::set_v()
 
     // save old velocities for virial
 
-    if (evflag) {
+    if (atomvirial) {
       v0 = v[i][0];
       v1 = v[i][1];
       v2 = v[i][2];
@@ -1340,7 +1543,7 @@ void FixRigidSmall::set_v()
     // 1/2 factor b/c initial_integrate contributes other half
     // assume per-atom contribution is due to constraint force on that atom
 
-    if (evflag) {
+    if (atomvirial) {
       if (rmass) massone = rmass[i];
       else massone = mass[type[i]];
       fc0 = massone*(v[i][0] - v0)/dtf - f[i][0];
@@ -1416,6 +1619,72 @@ void FixRigidSmall::set_v()
       }
     }
   }
+
+  // global constraint virial from body-level quantities
+
+  if (evflag && !atomvirial) body_virial();
+}
+
+/* ----------------------------------------------------------------------
+   tally 1/2 of the global constraint virial of owned rigid bodies,
+   as set_xv() and set_v() each contribute one half
+   same body-level expression as in FixRigid::body_virial()
+   the force moment was summed over owned atoms in post_force()
+   Langevin forces are not included
+------------------------------------------------------------------------- */
+
+void FixRigidSmall::body_virial()
+{
+  int a,b;
+  double c[3][3],m[3][3],k[3][3];
+  double tq[3],tb[3],ab[3],alpha[3],w2;
+  double vr[6];
+
+  for (a = 0; a < 6; a++) vr[a] = -0.5*fmoment[a];
+
+  for (int ibody = 0; ibody < nlocal_body; ibody++) {
+    Body *bd = &body[ibody];
+    double *ex = bd->ex_space;
+    double *ey = bd->ey_space;
+    double *ez = bd->ez_space;
+    double *w = bd->omega;
+
+    for (a = 0; a < 3; a++)
+      for (b = 0; b < 3; b++)
+        c[a][b] = bd->cmom[0]*ex[a]*ex[b] + bd->cmom[1]*ey[a]*ey[b] +
+          bd->cmom[2]*ez[a]*ez[b];
+
+    MathExtra::cross3(w,bd->angmom,tq);
+    tq[0] = bd->torque[0] - tq[0];
+    tq[1] = bd->torque[1] - tq[1];
+    tq[2] = bd->torque[2] - tq[2];
+    MathExtra::transpose_matvec(ex,ey,ez,tq,tb);
+    for (a = 0; a < 3; a++)
+      ab[a] = bd->inertia[a] == 0.0 ? 0.0 : tb[a]/bd->inertia[a];
+    MathExtra::matvec(ex,ey,ez,ab,alpha);
+
+    w2 = MathExtra::dot3(w,w);
+    m[0][0] = w[0]*w[0] - w2;
+    m[1][1] = w[1]*w[1] - w2;
+    m[2][2] = w[2]*w[2] - w2;
+    m[0][1] = w[0]*w[1] + alpha[2];
+    m[1][0] = w[1]*w[0] - alpha[2];
+    m[0][2] = w[0]*w[2] - alpha[1];
+    m[2][0] = w[2]*w[0] + alpha[1];
+    m[1][2] = w[1]*w[2] + alpha[0];
+    m[2][1] = w[2]*w[1] - alpha[0];
+
+    MathExtra::times3(c,m,k);
+
+    vr[0] += 0.5*k[0][0];
+    vr[1] += 0.5*k[1][1];
+    vr[2] += 0.5*k[2][2];
+    vr[3] += 0.25*(k[0][1] + k[1][0]);
+    vr[4] += 0.25*(k[0][2] + k[2][0]);
+    vr[5] += 0.25*(k[1][2] + k[2][1]);
+  }
+
+  for (a = 0; a < 6; a++) virial[a] += vr[a];
 }
 
 /* ----------------------------------------------------------------------
@@ -1842,6 +2111,8 @@ void FixRigidSmall::setup_bodies_static()
   commflag = FULL_BODY;
   comm->forward_comm_fix(this);
   reset_atom2body();
+  rma_setup();
+  find_interior();
 
   // compute mass & center-of-mass of each rigid body
 
@@ -2071,8 +2342,7 @@ void FixRigidSmall::setup_bodies_static()
 
   // forward communicate updated info of all bodies
 
-  commflag = INITIAL;
-  comm->forward_comm_fix(this,26);
+  forward_bodies(INITIAL,26);
 
   // displace = initial atom coords in basis of principal axes
   // set displace = 0.0 for atoms not in any rigid body
@@ -2245,6 +2515,16 @@ void FixRigidSmall::setup_bodies_static()
       error->all(FLERR,"Fix rigid: Bad principal moments");
   }
 
+  // second moments of mass along principal axes, for body-level virial
+  // from re-computed point-particle moments, diagonal in principal frame
+
+  for (ibody = 0; ibody < nlocal_body; ibody++) {
+    double *cmom = body[ibody].cmom;
+    cmom[0] = 0.5*(itensor[ibody][1] + itensor[ibody][2] - itensor[ibody][0]);
+    cmom[1] = 0.5*(itensor[ibody][0] + itensor[ibody][2] - itensor[ibody][1]);
+    cmom[2] = 0.5*(itensor[ibody][0] + itensor[ibody][1] - itensor[ibody][2]);
+  }
+
   // clean up
 
   memory->destroy(itensor);
@@ -2536,38 +2816,8 @@ void FixRigidSmall::write_restart_file(char *file)
   else memory->create(buf,MAX(1,sendrow),ncol,"rigid/small:buf");
 
   // pack my rigid body info into buf
-  // compute I tensor against xyz axes from diagonalized I and current quat
-  // Ispace = P Idiag P_transpose
-  // P is stored column-wise in exyz_space
 
-  double p[3][3],pdiag[3][3],ispace[3][3];
-
-  for (int i = 0; i < nlocal_body; i++) {
-    MathExtra::col2mat(body[i].ex_space,body[i].ey_space,body[i].ez_space,p);
-    MathExtra::times3_diag(p,body[i].inertia,pdiag);
-    MathExtra::times3_transpose(pdiag,p,ispace);
-
-    buf[i][0] = atom->molecule[body[i].ilocal];
-    buf[i][1] = body[i].mass;
-    buf[i][2] = body[i].xcm[0];
-    buf[i][3] = body[i].xcm[1];
-    buf[i][4] = body[i].xcm[2];
-    buf[i][5] = ispace[0][0];
-    buf[i][6] = ispace[1][1];
-    buf[i][7] = ispace[2][2];
-    buf[i][8] = ispace[0][1];
-    buf[i][9] = ispace[0][2];
-    buf[i][10] = ispace[1][2];
-    buf[i][11] = body[i].vcm[0];
-    buf[i][12] = body[i].vcm[1];
-    buf[i][13] = body[i].vcm[2];
-    buf[i][14] = body[i].angmom[0];
-    buf[i][15] = body[i].angmom[1];
-    buf[i][16] = body[i].angmom[2];
-    buf[i][17] = (body[i].image & IMGMASK) - IMGMAX;
-    buf[i][18] = (body[i].image >> IMGBITS & IMGMASK) - IMGMAX;
-    buf[i][19] = (body[i].image >> IMG2BITS) - IMGMAX;
-  }
+  pack_body_info(buf);
 
   // write one chunk of rigid body info per proc to file
   // proc 0 pings each proc, receives its chunk, writes to file
@@ -2613,6 +2863,46 @@ void FixRigidSmall::write_restart_file(char *file)
   if (me == 0) fclose(fp);
 }
 
+/* ----------------------------------------------------------------------
+   pack mass, COM, inertia tensor, velocities and image flags of owned
+   bodies into buf, one row of ATTRIBUTE_PERBODY values per body
+   compute I tensor against xyz axes from diagonalized I and current quat
+   Ispace = P Idiag P_transpose
+   P is stored column-wise in exyz_space
+------------------------------------------------------------------------- */
+
+void FixRigidSmall::pack_body_info(double **buf)
+{
+  double p[3][3],pdiag[3][3],ispace[3][3];
+
+  for (int i = 0; i < nlocal_body; i++) {
+    MathExtra::col2mat(body[i].ex_space,body[i].ey_space,body[i].ez_space,p);
+    MathExtra::times3_diag(p,body[i].inertia,pdiag);
+    MathExtra::times3_transpose(pdiag,p,ispace);
+
+    buf[i][0] = atom->molecule[body[i].ilocal];
+    buf[i][1] = body[i].mass;
+    buf[i][2] = body[i].xcm[0];
+    buf[i][3] = body[i].xcm[1];
+    buf[i][4] = body[i].xcm[2];
+    buf[i][5] = ispace[0][0];
+    buf[i][6] = ispace[1][1];
+    buf[i][7] = ispace[2][2];
+    buf[i][8] = ispace[0][1];
+    buf[i][9] = ispace[0][2];
+    buf[i][10] = ispace[1][2];
+    buf[i][11] = body[i].vcm[0];
+    buf[i][12] = body[i].vcm[1];
+    buf[i][13] = body[i].vcm[2];
+    buf[i][14] = body[i].angmom[0];
+    buf[i][15] = body[i].angmom[1];
+    buf[i][16] = body[i].angmom[2];
+    buf[i][17] = (body[i].image & IMGMASK) - IMGMAX;
+    buf[i][18] = (body[i].image >> IMGBITS & IMGMASK) - IMGMAX;
+    buf[i][19] = (body[i].image >> IMG2BITS) - IMGMAX;
+  }
+}
+
 /* ----------------------------------------------------------------------
    allocate local atom-based arrays
 ------------------------------------------------------------------------- */
@@ -2624,6 +2914,8 @@ void FixRigidSmall::grow_arrays(int nmax)
   memory->grow(atom2body,nmax,"rigid/small:atom2body");
   memory->grow(xcmimage,nmax,"rigid/small:xcmimage");
   memory->grow(displace,nmax,3,"rigid/small:displace");
+  memory->grow(weight,nmax,"rigid/small:weight");
+  if (weightflag) vector_atom = weight;
   if (extended) {
     memory->grow(eflags,nmax,"rigid/small:eflags");
     if (orientflag) memory->grow(orient,nmax,orientflag,"rigid/small:orient");
@@ -2652,6 +2944,7 @@ void FixRigidSmall::copy_arrays(int i, int j, int delflag)
   displace[j][0] = displace[i][0];
   displace[j][1] = displace[i][1];
   displace[j][2] = displace[i][2];
+  weight[j] = weight[i];
 
   if (extended) {
     eflags[j] = eflags[i];
@@ -2699,6 +2992,7 @@ void FixRigidSmall::set_arrays(int i)
   displace[i][0] = 0.0;
   displace[i][1] = 0.0;
   displace[i][2] = 0.0;
+  weight[i] = 0.0;
 
   // must also zero vatom if per-atom virial calculated on this timestep
   // since vatom is calculated before and after atom migration
@@ -2775,6 +3069,13 @@ void FixRigidSmall::set_molecule(int nlocalprev, tagint tagprev, int imol,
       b->inertia[1] = onemols[imol]->inertia[1];
       b->inertia[2] = onemols[imol]->inertia[2];
 
+      // second moments of mass along principal axes, for body-level virial
+      // point particles only (virial body rejects extended particles)
+
+      b->cmom[0] = 0.5*(b->inertia[1] + b->inertia[2] - b->inertia[0]);
+      b->cmom[1] = 0.5*(b->inertia[0] + b->inertia[2] - b->inertia[1]);
+      b->cmom[2] = 0.5*(b->inertia[0] + b->inertia[1] - b->inertia[2]);
+
       // final quat is product of insertion quat and original quat
       // true even if insertion rotation was not around COM
 
@@ -2805,9 +3106,11 @@ int FixRigidSmall::pack_exchange(int i, double *buf)
   buf[3] = displace[i][1];
   buf[4] = displace[i][2];
 
+  int m = 5;
+  if (weightflag) buf[m++] = weight[i];
+
   // extended attribute info
 
-  int m = 5;
   if (extended) {
     buf[m++] = eflags[i];
     for (int j = 0; j < orientflag; j++)
@@ -2857,9 +3160,11 @@ int FixRigidSmall::unpack_exchange(int nlocal, double *buf)
   displace[nlocal][1] = buf[3];
   displace[nlocal][2] = buf[4];
 
+  int m = 5;
+  if (weightflag) weight[nlocal] = buf[m++];
+
   // extended attribute info
 
-  int m = 5;
   if (extended) {
     eflags[nlocal] = static_cast<int> (buf[m++]);
     for (int j = 0; j < orientflag; j++)
@@ -2976,6 +3281,14 @@ int FixRigidSmall::pack_forward_comm(int n, int *list, double *buf,
       buf[m++] = conjqm[3];
     }
 
+  } else if (commflag == BODYINDEX) {
+    for (i = 0; i < n; i++) {
+      j = list[i];
+      if (bodyown[j] < 0) continue;
+      buf[m++] = rmaproc[bodyown[j]];
+      buf[m++] = rmaindex[bodyown[j]];
+    }
+
   } else if (commflag == FULL_BODY) {
     for (i = 0; i < n; i++) {
       j = list[i];
@@ -3062,6 +3375,13 @@ void FixRigidSmall::unpack_forward_comm(int n, int first, double *buf)
       conjqm[3] = buf[m++];
     }
 
+  } else if (commflag == BODYINDEX) {
+    for (i = first; i < last; i++) {
+      if (bodyown[i] < 0) continue;
+      rmaproc[bodyown[i]] = static_cast<int> (buf[m++]);
+      rmaindex[bodyown[i]] = static_cast<int> (buf[m++]);
+    }
+
   } else if (commflag == FULL_BODY) {
     for (i = first; i < last; i++) {
       bodyown[i] = static_cast<int> (buf[m++]);
@@ -3239,6 +3559,357 @@ void FixRigidSmall::grow_body()
                                    "rigid/small:body");
 }
 
+/* ----------------------------------------------------------------------
+   sum force and torque of owned atoms into bodies with index in [lo,hi)
+   which = ALLATOMS, INTERIOR or BOUNDARY (non-interior) atoms
+   sum = NULL: add to fcm, torque of the bodies
+   else: set (ALLATOMS, INTERIOR) or add to (BOUNDARY) sum[ibody] the
+     force (0-2) and torque (3-5) of owned bodies
+   extended particles add their torque to torque of body
+   also accumulate moment of atom forces around COM for body-level virial
+------------------------------------------------------------------------- */
+
+void FixRigidSmall::sum_body_forces(int lo, int hi, double **sum, int which)
+{
+  double **x = atom->x;
+  double **f = atom->f;
+  double **torque = atom->torque;
+  int nlocal = atom->nlocal;
+
+  double dx,dy,dz;
+  double unwrap[3];
+  double *xcm,*fcm,*tcm;
+
+  if (sum && which != BOUNDARY)
+    for (int ibody = lo; ibody < hi; ibody++)
+      for (int k = 0; k < 6; k++) sum[ibody][k] = 0.0;
+
+  for (int i = 0; i < nlocal; i++) {
+    int ibody = atom2body[i];
+    if (ibody < lo || ibody >= hi) continue;
+    if (which == INTERIOR && !interior[i]) continue;
+    if (which == BOUNDARY && interior[i]) continue;
+    Body *b = &body[ibody];
+
+    fcm = sum ? &sum[ibody][0] : b->fcm;
+    fcm[0] += f[i][0];
+    fcm[1] += f[i][1];
+    fcm[2] += f[i][2];
+
+    domain->unmap(x[i],xcmimage[i],unwrap);
+    xcm = b->xcm;
+    dx = unwrap[0] - xcm[0];
+    dy = unwrap[1] - xcm[1];
+    dz = unwrap[2] - xcm[2];
+
+    tcm = sum ? &sum[ibody][3] : b->torque;
+    tcm[0] += dy*f[i][2] - dz*f[i][1];
+    tcm[1] += dz*f[i][0] - dx*f[i][2];
+    tcm[2] += dx*f[i][1] - dy*f[i][0];
+
+    if (extended && (eflags[i] & TORQUE)) {
+      tcm[0] += torque[i][0];
+      tcm[1] += torque[i][1];
+      tcm[2] += torque[i][2];
+    }
+
+    if (vbodyflag) {
+      fmoment[0] += dx*f[i][0];
+      fmoment[1] += dy*f[i][1];
+      fmoment[2] += dz*f[i][2];
+      fmoment[3] += 0.5*(dx*f[i][1] + dy*f[i][0]);
+      fmoment[4] += 0.5*(dx*f[i][2] + dz*f[i][0]);
+      fmoment[5] += 0.5*(dy*f[i][2] + dz*f[i][1]);
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------
+   flag owned atoms farther than the ghost cutoff from all faces of my
+     subdomain, which have no ghost copies, so their forces are final
+     before reverse comm
+   borders() acquired ghosts with the current coords, so the flags hold
+     until the next reneighboring
+   with newton off, forces of ghost atoms are not communicated
+------------------------------------------------------------------------- */
+
+void FixRigidSmall::find_interior()
+{
+  if (!earlyflag) return;
+
+  if (atom->nmax > maxinterior) {
+    maxinterior = atom->nmax;
+    memory->destroy(interior);
+    memory->create(interior,maxinterior,"rigid/small:interior");
+  }
+
+  double **x = atom->x;
+  int nlocal = atom->nlocal;
+  int dim = domain->dimension;
+
+  if (!force->newton) {
+    for (int i = 0; i < nlocal; i++) interior[i] = 1;
+    return;
+  }
+
+  double *lo,*hi,*coord;
+  double lamda[3];
+  if (triclinic) {
+    lo = domain->sublo_lamda;
+    hi = domain->subhi_lamda;
+  } else {
+    lo = domain->sublo;
+    hi = domain->subhi;
+  }
+  double *cut = comm->cutghost;
+
+  for (int i = 0; i < nlocal; i++) {
+    if (triclinic) {
+      domain->x2lamda(x[i],lamda);
+      coord = lamda;
+    } else coord = x[i];
+    interior[i] = 1;
+    for (int k = 0; k < dim; k++)
+      if (coord[k] <= lo[k] + cut[k] || coord[k] >= hi[k] - cut[k])
+        interior[i] = 0;
+  }
+}
+
+/* ----------------------------------------------------------------------
+   after ghost bodies are acquired, find the owning proc and index of each
+   ghost body via forward comm, then expose the body array in a window
+   ghost copies of ghosts are resolved since comm proceeds swap by swap
+   the window is rebuilt after every reneighboring, since the body array
+     can only be reallocated when bodies migrate or are acquired
+   all procs hold a shared lock on the window for its lifetime (passive
+     target), so each transfer is synchronized only with the procs and
+     bodies it involves, see forward_bodies() and reverse_bodies_start()
+   ghost bodies are grouped by owning proc, so that each transfer moves
+     the bodies of one proc with a single call, see rma_types()
+------------------------------------------------------------------------- */
+
+void FixRigidSmall::rma_setup()
+{
+  if (!rmaflag) return;
+
+#ifdef LMP_RIGID_RMA
+  if (nmax_body > nmax_rma) {
+    nmax_rma = nmax_body;
+    memory->destroy(rmaproc);
+    memory->destroy(rmaindex);
+    memory->create(rmaproc,nmax_rma,"rigid/small:rmaproc");
+    memory->create(rmaindex,nmax_rma,"rigid/small:rmaindex");
+  }
+  for (int ibody = 0; ibody < nlocal_body; ibody++) {
+    rmaproc[ibody] = me;
+    rmaindex[ibody] = ibody;
+  }
+
+  commflag = BODYINDEX;
+  comm->forward_comm_fix(this,2);
+
+  if (winflag) {
+    MPI_Win_unlock_all(bodywin);
+    MPI_Win_free(&bodywin);
+  }
+  MPI_Win_create(body,(MPI_Aint) nmax_body*sizeof(Body),1,
+                 MPI_INFO_NULL,world,&bodywin);
+  MPI_Win_lock_all(MPI_MODE_NOCHECK,bodywin);
+
+  if (winflag) rma_types(0);
+  rma_types(1);
+  winflag = 1;
+#endif
+}
+
+/* ----------------------------------------------------------------------
+   flag = 1: build the datatypes of rma transfers of ghost bodies
+   flag = 0: free them
+   rmafield = the fields of a Body moved by each kind of transfer, with
+     the extent of a Body, so that bodies are indexed in units of Body
+   rmaorigin/rmatarget[k][m] = my ghost bodies owned by proc rmarank[m]
+     and their indices on that proc, for fields rmafield[k]
+------------------------------------------------------------------------- */
+
+void FixRigidSmall::rma_types(int flag)
+{
+#ifdef LMP_RIGID_RMA
+  if (!flag) {
+    for (int k = 0; k < 3; k++) {
+      MPI_Type_free(&rmafield[k]);
+      for (int m = 0; m < nrmarank; m++) {
+        MPI_Type_free(&rmaorigin[k][m]);
+        MPI_Type_free(&rmatarget[k][m]);
+      }
+    }
+    nrmarank = 0;
+    return;
+  }
+
+  // INITIAL = xcm,vcm + quat + ex,ey,ez_space + omega,conjqm
+  // FINAL = vcm + omega,conjqm
+  // FORCE_TORQUE = fcm,torque
+
+  int nfield[3] = {4,2,1};
+  int len[3][4] = {{6,4,9,7},{3,7},{6}};
+  MPI_Aint disp[3][4] = {{offsetof(Body,xcm),offsetof(Body,quat),
+                          offsetof(Body,ex_space),offsetof(Body,omega)},
+                         {offsetof(Body,vcm),offsetof(Body,omega)},
+                         {offsetof(Body,fcm)}};
+  MPI_Datatype field;
+  for (int k = 0; k < 3; k++) {
+    MPI_Type_create_hindexed(nfield[k],len[k],disp[k],MPI_DOUBLE,&field);
+    MPI_Type_create_resized(field,0,sizeof(Body),&rmafield[k]);
+    MPI_Type_free(&field);
+    MPI_Type_commit(&rmafield[k]);
+  }
+
+  // group ghost bodies by owning proc
+
+  int nall = nlocal_body + nghost_body;
+  int *which,*count;
+  memory->create(which,nghost_body+1,"rigid/small:which");
+  memory->create(count,nghost_body+1,"rigid/small:count");
+
+  int m;
+  nrmarank = 0;
+  for (int ibody = nlocal_body; ibody < nall; ibody++) {
+    for (m = 0; m < nrmarank; m++)
+      if (rmarank[m] == rmaproc[ibody]) break;
+    if (m == nrmarank) {
+      if (nrmarank == maxrmarank) {
+        maxrmarank += 8;
+        memory->grow(rmarank,maxrmarank,"rigid/small:rmarank");
+      }
+      rmarank[nrmarank] = rmaproc[ibody];
+      count[nrmarank++] = 0;
+    }
+    which[ibody-nlocal_body] = m;
+    count[m]++;
+  }
+
+  memory->destroy(rmaorigin);
+  memory->destroy(rmatarget);
+  memory->destroy(rmareq);
+  memory->create(rmaorigin,3,maxrmarank,"rigid/small:rmaorigin");
+  memory->create(rmatarget,3,maxrmarank,"rigid/small:rmatarget");
+  memory->create(rmareq,maxrmarank,"rigid/small:rmareq");
+
+  // indexed types over the bodies of each proc, in units of Body
+
+  int *origin,*target;
+  memory->create(origin,nghost_body+1,"rigid/small:origin");
+  memory->create(target,nghost_body+1,"rigid/small:target");
+
+  for (m = 0; m < nrmarank; m++) {
+    int n = 0;
+    for (int ibody = nlocal_body; ibody < nall; ibody++)
+      if (which[ibody-nlocal_body] == m) {
+        origin[n] = ibody;
+        target[n++] = rmaindex[ibody];
+      }
+    for (int k = 0; k < 3; k++) {
+      MPI_Type_create_indexed_block(n,1,origin,rmafield[k],
+                                    &rmaorigin[k][m]);
+      MPI_Type_create_indexed_block(n,1,target,rmafield[k],
+                                    &rmatarget[k][m]);
+      MPI_Type_commit(&rmaorigin[k][m]);
+      MPI_Type_commit(&rmatarget[k][m]);
+    }
+  }
+
+  memory->destroy(which);
+  memory->destroy(count);
+  memory->destroy(origin);
+  memory->destroy(target);
+#endif
+}
+
+/* ----------------------------------------------------------------------
+   forward communicate INITIAL or FINAL info of owned bodies to ghosts
+   with rma, ghost bodies get their fields directly from the owners,
+     with one get of all the bodies owned by each proc
+------------------------------------------------------------------------- */
+
+void FixRigidSmall::forward_bodies(int flag, int size)
+{
+  commflag = flag;
+  if (!rmaflag) {
+    comm->forward_comm_fix(this,size);
+    return;
+  }
+
+#ifdef LMP_RIGID_RMA
+
+  // owned bodies are final on all procs before any ghost reads them
+
+  int k = flag == INITIAL ? 0 : 1;
+  MPI_Win_sync(bodywin);
+  MPI_Barrier(world);
+  for (int m = 0; m < nrmarank; m++)
+    MPI_Get(body,1,rmaorigin[k][m],rmarank[m],0,1,rmatarget[k][m],bodywin);
+  MPI_Win_flush_all(bodywin);
+
+  // no owner changes its bodies until all ghosts have read them
+
+  MPI_Barrier(world);
+#endif
+}
+
+/* ----------------------------------------------------------------------
+   reverse communicate FORCE_TORQUE of ghost bodies to their owners
+   with rma, fcm and torque of each ghost body are summed directly into
+   the owned body, however many ghost hops separate them
+------------------------------------------------------------------------- */
+
+void FixRigidSmall::reverse_bodies(int flag, int size)
+{
+  commflag = flag;
+  if (!rmaflag) {
+    comm->reverse_comm_fix(this,size);
+    return;
+  }
+  reverse_bodies_start();
+  reverse_bodies_finish();
+}
+
+/* ----------------------------------------------------------------------
+   post the accumulation of fcm, torque of all ghost bodies into their
+     owners as requests, one per owning proc, which progress until
+     reverse_bodies_finish()
+   fcm, torque of owned bodies must not be accessed until then
+------------------------------------------------------------------------- */
+
+void FixRigidSmall::reverse_bodies_start()
+{
+#ifdef LMP_RIGID_RMA
+
+  // owners have zeroed fcm, torque of their bodies before any ghost adds
+
+  MPI_Win_sync(bodywin);
+  MPI_Barrier(world);
+  for (int m = 0; m < nrmarank; m++)
+    MPI_Raccumulate(body,1,rmaorigin[2][m],rmarank[m],0,1,rmatarget[2][m],
+                    MPI_SUM,bodywin,&rmareq[m]);
+  nrmareq = nrmarank;
+#endif
+}
+
+/* ----------------------------------------------------------------------
+   complete the accumulations of all procs, so that fcm, torque of owned
+     bodies include all ghost contributions
+------------------------------------------------------------------------- */
+
+void FixRigidSmall::reverse_bodies_finish()
+{
+#ifdef LMP_RIGID_RMA
+  MPI_Waitall(nrmareq,rmareq,MPI_STATUSES_IGNORE);
+  MPI_Win_flush_all(bodywin);
+  MPI_Barrier(world);
+  MPI_Win_sync(bodywin);
+#endif
+}
+
 /* ----------------------------------------------------------------------
    reset atom2body for all owned atoms
    do this via bodyown of atom that owns the body the owned atom is in
@@ -3295,8 +3966,7 @@ void FixRigidSmall::zero_momentum()
 
   // forward communicate of vcm to all ghost copies
 
-  commflag = FINAL;
-  comm->forward_comm_fix(this,10);
+  forward_bodies(FINAL,10);
 
   // set velocity of atoms in rigid bodues
 
@@ -3321,8 +3991,7 @@ void FixRigidSmall::zero_rotation()
 
   // forward communicate of omega to all ghost copies
 
-  commflag = FINAL;
-  comm->forward_comm_fix(this,10);
+  forward_bodies(FINAL,10);
 
   // set velocity of atoms in rigid bodues
 
@@ -3476,6 +4145,7 @@ double FixRigidSmall::memory_usage()
   double bytes = nmax*2 * sizeof(int);
   bytes += nmax * sizeof(imageint);
   bytes += nmax*3 * sizeof(double);
+  bytes += nmax * sizeof(double);           // weight
   bytes += maxvatom*6 * sizeof(double);     // vatom
   if (extended) {
     bytes += nmax * sizeof(int);
@@ -22,6 +22,12 @@ FixStyle(rigid/small,FixRigidSmall)
 
 #include "fix.h"
 
+// one-sided updates of ghost bodies need MPI-3 (not the STUBS library)
+
+#if defined(MPI_VERSION) && (MPI_VERSION >= 3)
+#define LMP_RIGID_RMA
+#endif
+
 // replace this later
 #include <map>
 
@@ -29,6 +35,8 @@ namespace LAMMPS_NS {
 
 class FixRigidSmall : public Fix {
   friend class ComputeRigidLocal;
+  friend class FixSoftcoreCheckpoint;
+  friend class FixSoftcoreGCMC;
 
  public:
   FixRigidSmall(class LAMMPS *, int, char **);
@@ -37,6 +45,7 @@ class FixRigidSmall : public Fix {
   virtual void init();
   virtual void setup(int);
   virtual void initial_integrate(int);
+  void pre_reverse(int, int);
   void post_force(int);
   virtual void final_integrate();
   void initial_integrate_respa(int, int, int);
@@ -98,6 +107,7 @@ class FixRigidSmall : public Fix {
     double angmom[3];         // space-frame angular momentum of body
     double omega[3];          // space-frame omega of body
     double conjqm[4];         // conjugate quaternion momentum
+    double cmom[3];           // 3 principal second moments of mass
     imageint image;           // image flags of xcm
     int remapflag[4];         // PBC remap flags
     int ilocal;               // index of owning atom
@@ -120,6 +130,7 @@ class FixRigidSmall : public Fix {
   imageint *xcmimage;   // internal image flags for atoms in rigid bodies
                         // set relative to in-box xcm of each body
   double **displace;    // displacement of each atom in body coords
+  double *weight;       // per-atom cost of rigid integration for balancing
   int *eflags;          // flags for extended particles
   double **orient;      // orientation vector of particle wrt rigid body
   double **dorient;     // orientation of dipole mu wrt rigid body
@@ -146,6 +157,51 @@ class FixRigidSmall : public Fix {
   double *mass_body;
   int nmax_mass;
 
+  int rotflag;                      // RICHARDSON or NO_SQUISH orientation update
+
+  // load-balancing cost weights
+
+  int weightflag;                   // 1 if per-atom cost weights are output
+  double weight_atom;               // cost of one body atom
+  double weight_body;               // cost of one owned or ghost body
+
+  // body-level virial
+
+  int vbodyflag;                    // 1 if global virial is computed per body
+  double fmoment[6];                // moment of atom forces about COMs
+
+  // one-sided (RMA) communication of ghost bodies
+
+  int rmaflag;                      // 1 if ghost bodies are updated by RMA
+  int *rmaproc;                     // owning proc of each body
+  int *rmaindex;                    // index of each body on its owning proc
+  int nmax_rma;                     // # of bodies that rma arrays can hold
+  double **bsum;                    // force, torque of owned bodies summed
+                                    //   while ghost bodies are in flight
+  int maxbsum;
+#ifdef LMP_RIGID_RMA
+  MPI_Win bodywin;                  // window exposing the body array,
+                                    //   locked (passive target) while it exists
+  int winflag;                      // 1 if bodywin has been created
+  int nrmarank;                     // # of procs owning my ghost bodies
+  int maxrmarank;
+  int *rmarank;                     // rank of each of these procs
+  MPI_Datatype rmafield[3];         // fields of one body moved by forward
+                                    //   INITIAL, FINAL and reverse comm
+  MPI_Datatype **rmaorigin;         // ghost bodies owned by each proc, and
+  MPI_Datatype **rmatarget;         //   their owned bodies, for each field
+  MPI_Request *rmareq;              // requests of posted accumulations
+  int nrmareq;
+#endif
+
+  // early summation of atoms whose forces get no ghost contributions
+
+  int earlyflag;                    // 1 if interior atoms are summed in
+                                    //   pre_reverse()
+  int *interior;                    // 1 if owned atom has no ghost copies
+  int maxinterior;
+  bigint prestep;                   // step of the latest early summation
+
   // Langevin thermostatting
 
   int langflag;                     // 0/1 = no/yes Langevin thermostat
@@ -185,12 +241,23 @@ class FixRigidSmall : public Fix {
   double rsqfar;
 
   void image_shift();
+  void set_weights();
   void set_xv();
   void set_v();
+  void body_virial();
   void create_bodies();
   void setup_bodies_static();
   void setup_bodies_dynamic();
   void readfile(int, double **, int *);
+  void pack_body_info(double **);
+  void rma_setup();
+  void rma_types(int);
+  void forward_bodies(int, int);
+  void reverse_bodies(int, int);
+  void reverse_bodies_start();
+  void reverse_bodies_finish();
+  void sum_body_forces(int, int, double **, int);
+  void find_interior();
   void grow_body();
   void reset_atom2body();
 
@@ -250,6 +317,17 @@ W: More than one fix rigid
 
 It is not efficient to use fix rigid more than once.
 
+E: Fix rigid/small virial body cannot be used with extended particles
+
+The body-level virial assumes point particles, whose second moments
+of mass follow from the principal moments of inertia.
+
+W: Fix rigid/small virial body omits Langevin forces
+
+The body-level virial is computed from the deterministic forces and
+torques only, so the virial of the Langevin forces is not included in
+the pressure.  Use virial atom if it is needed.
+
 E: Rigid fix must come before NPT/NPH fix
 
 NPT/NPH fix must be defined in input script after all rigid fixes,
@@ -313,6 +391,11 @@ E: Cannot open fix rigid restart file %s
 The specified file cannot be opened.  Check that the path and name are
 correct.
 
+E: Fix rigid/small rma requires MPI-3
+
+One-sided updates of ghost bodies are only available when LAMMPS is
+built with an MPI-3 library.
+
 E: Rigid body atoms %d %d missing on proc %d at step %ld
 
 This means that an atom cannot find the atom that owns the rigid body
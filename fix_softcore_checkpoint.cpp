@@ -0,0 +1,346 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------------
+   Contributing author: Charlles Abreu (abreu@eq.ufrj.br)
+                        Applied Thermodynamics & Molecular Simulation (ATOMS)
+                        Federal University of Rio de Janeiro / Brazil
+------------------------------------------------------------------------- */
+
+#include "mpi.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "fix_softcore_checkpoint.h"
+#include "fix_softcore_ee.h"
+#include "fix_rigid_small.h"
+#include "atom.h"
+#include "atom_vec.h"
+#include "comm.h"
+#include "domain.h"
+#include "force.h"
+#include "modify.h"
+#include "update.h"
+#include "memory.h"
+#include "error.h"
+
+using namespace LAMMPS_NS;
+using namespace FixConst;
+
+// sections of the checkpoint and the file each one belongs to
+
+enum{HEAD,ATOMS,VELOCITIES,BONDS,ANGLES,DIHEDRALS,IMPROPERS,BODIES,EESTATE};
+enum{DATA,RIGID,EE};
+
+static const int sectionfile[] =
+  {DATA,DATA,DATA,DATA,DATA,DATA,DATA,RIGID,EE};
+static const char *suffix[] = {"",".rigid",".ee"};
+
+/* ----------------------------------------------------------------------
+   fix ID all softcore/checkpoint N file
+   Every N steps, the state of the system is formatted into memory and
+   written with non-blocking MPI-IO while the run proceeds, as:
+     file        = data file for read_data (box, masses, atoms,
+                   velocities and topology, but no force field)
+     file.rigid  = bodies of fix rigid/small, for its infile keyword
+     file.ee     = walk of fix softcore/ee, for fix_modify ID state
+   A '*' in the file name is replaced by the timestep.
+------------------------------------------------------------------------- */
+
+FixSoftcoreCheckpoint::FixSoftcoreCheckpoint(LAMMPS *lmp, int narg,
+                                             char **arg) :
+  Fix(lmp, narg, arg)
+{
+  if (narg != 5)
+    error->all(FLERR,"Illegal fix softcore/checkpoint command");
+  if (igroup)
+    error->all(FLERR,"Fix softcore/checkpoint must use group all");
+
+  nevery = force->inumeric(FLERR,arg[3]);
+  if (nevery <= 0)
+    error->all(FLERR,"Illegal fix softcore/checkpoint command");
+
+  int n = strlen(arg[4]) + 1;
+  filename = new char[n];
+  strcpy(filename,arg[4]);
+
+  ee = NULL;
+  rigid = NULL;
+  for (int s = 0; s < NSECTIONS; s++) {
+    text[s] = NULL;
+    length[s] = 0;
+  }
+  pending = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+FixSoftcoreCheckpoint::~FixSoftcoreCheckpoint()
+{
+  finish_write();
+  delete [] filename;
+}
+
+/* ---------------------------------------------------------------------- */
+
+int FixSoftcoreCheckpoint::setmask()
+{
+  int mask = 0;
+  mask |= END_OF_STEP;
+  return mask;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixSoftcoreCheckpoint::init()
+{
+  ee = NULL;
+  rigid = NULL;
+  for (int i = 0; i < modify->nfix; i++) {
+    if (!ee) ee = dynamic_cast<FixSoftcoreEE*>(modify->fix[i]);
+    if (!rigid) rigid = dynamic_cast<FixRigidSmall*>(modify->fix[i]);
+  }
+}
+
+/* ----------------------------------------------------------------------
+   The previous checkpoint must be complete before its text is released
+------------------------------------------------------------------------- */
+
+void FixSoftcoreCheckpoint::end_of_step()
+{
+  finish_write();
+  snapshot();
+  start_write();
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixSoftcoreCheckpoint::post_run()
+{
+  finish_write();
+}
+
+/* ----------------------------------------------------------------------
+   Format my part of every section into memory streams, using the same
+   atom style routines as write_data. Proc 0 also writes the header of
+   each section, the data file header and the state of fix softcore/ee.
+------------------------------------------------------------------------- */
+
+void FixSoftcoreCheckpoint::snapshot()
+{
+  AtomVec *avec = atom->avec;
+  int nlocal = atom->nlocal;
+  int me = comm->me;
+  FILE *fp[NSECTIONS];
+  for (int s = 0; s < NSECTIONS; s++)
+    fp[s] = open_memstream(&text[s],&length[s]);
+
+  // topology counts, with global index offsets of my interactions
+
+  bigint ntopo[4],first[4],total[4];
+  ntopo[0] = atom->nbonds ? avec->pack_bond(NULL) : 0;
+  ntopo[1] = atom->nangles ? avec->pack_angle(NULL) : 0;
+  ntopo[2] = atom->ndihedrals ? avec->pack_dihedral(NULL) : 0;
+  ntopo[3] = atom->nimpropers ? avec->pack_improper(NULL) : 0;
+  MPI_Exscan(ntopo,first,4,MPI_LMP_BIGINT,MPI_SUM,world);
+  if (me == 0) first[0] = first[1] = first[2] = first[3] = 0;
+  MPI_Allreduce(ntopo,total,4,MPI_LMP_BIGINT,MPI_SUM,world);
+
+  if (me == 0) {
+    FILE *out = fp[HEAD];
+    fprintf(out,"LAMMPS data file via fix softcore/checkpoint, timestep = "
+            BIGINT_FORMAT "\n\n",update->ntimestep);
+    fprintf(out,BIGINT_FORMAT " atoms\n",atom->natoms);
+    fprintf(out,"%d atom types\n",atom->ntypes);
+    if (atom->molecular == 1) {
+      if (atom->nbondtypes) {
+        fprintf(out,BIGINT_FORMAT " bonds\n",total[0]);
+        fprintf(out,"%d bond types\n",atom->nbondtypes);
+      }
+      if (atom->nangletypes) {
+        fprintf(out,BIGINT_FORMAT " angles\n",total[1]);
+        fprintf(out,"%d angle types\n",atom->nangletypes);
+      }
+      if (atom->ndihedraltypes) {
+        fprintf(out,BIGINT_FORMAT " dihedrals\n",total[2]);
+        fprintf(out,"%d dihedral types\n",atom->ndihedraltypes);
+      }
+      if (atom->nimpropertypes) {
+        fprintf(out,BIGINT_FORMAT " impropers\n",total[3]);
+        fprintf(out,"%d improper types\n",atom->nimpropertypes);
+      }
+    }
+    fprintf(out,"\n%-1.16e %-1.16e xlo xhi\n",domain->boxlo[0],domain->boxhi[0]);
+    fprintf(out,"%-1.16e %-1.16e ylo yhi\n",domain->boxlo[1],domain->boxhi[1]);
+    fprintf(out,"%-1.16e %-1.16e zlo zhi\n",domain->boxlo[2],domain->boxhi[2]);
+    if (domain->triclinic)
+      fprintf(out,"%-1.16e %-1.16e %-1.16e xy xz yz\n",
+              domain->xy,domain->xz,domain->yz);
+    if (atom->mass) {
+      fprintf(out,"\nMasses\n\n");
+      for (int i = 1; i <= atom->ntypes; i++)
+        fprintf(out,"%d %-1.16e\n",i,atom->mass[i]);
+    }
+
+    fprintf(fp[ATOMS],"\nAtoms # %s\n\n",atom->atom_style);
+    fprintf(fp[VELOCITIES],"\nVelocities\n\n");
+    if (total[0]) fprintf(fp[BONDS],"\nBonds\n\n");
+    if (total[1]) fprintf(fp[ANGLES],"\nAngles\n\n");
+    if (total[2]) fprintf(fp[DIHEDRALS],"\nDihedrals\n\n");
+    if (total[3]) fprintf(fp[IMPROPERS],"\nImpropers\n\n");
+    if (rigid && rigid->setupflag)
+      fprintf(fp[BODIES],"# fix rigid mass, COM, inertia tensor info for "
+              "%d bodies on timestep " BIGINT_FORMAT "\n\n%d\n",
+              rigid->nbody,update->ntimestep,rigid->nbody);
+    if (ee) ee->write_state(fp[EESTATE]);
+  }
+
+  // atoms and velocities
+
+  double **dbuf;
+  memory->create(dbuf,MAX(1,nlocal),avec->size_data_atom+3,"checkpoint:dbuf");
+  avec->pack_data(dbuf);
+  avec->write_data(fp[ATOMS],nlocal,dbuf);
+  memory->destroy(dbuf);
+
+  memory->create(dbuf,MAX(1,nlocal),avec->size_data_vel,"checkpoint:dbuf");
+  avec->pack_vel(dbuf);
+  avec->write_vel(fp[VELOCITIES],nlocal,dbuf);
+  memory->destroy(dbuf);
+
+  // topology, numbered after the interactions of lower procs
+
+  tagint **tbuf;
+  if (ntopo[0]) {
+    memory->create(tbuf,ntopo[0],3,"checkpoint:tbuf");
+    avec->pack_bond(tbuf);
+    avec->write_bond(fp[BONDS],ntopo[0],tbuf,first[0]+1);
+    memory->destroy(tbuf);
+  }
+  if (ntopo[1]) {
+    memory->create(tbuf,ntopo[1],4,"checkpoint:tbuf");
+    avec->pack_angle(tbuf);
+    avec->write_angle(fp[ANGLES],ntopo[1],tbuf,first[1]+1);
+    memory->destroy(tbuf);
+  }
+  if (ntopo[2]) {
+    memory->create(tbuf,ntopo[2],5,"checkpoint:tbuf");
+    avec->pack_dihedral(tbuf);
+    avec->write_dihedral(fp[DIHEDRALS],ntopo[2],tbuf,first[2]+1);
+    memory->destroy(tbuf);
+  }
+  if (ntopo[3]) {
+    memory->create(tbuf,ntopo[3],5,"checkpoint:tbuf");
+    avec->pack_improper(tbuf);
+    avec->write_improper(fp[IMPROPERS],ntopo[3],tbuf,first[3]+1);
+    memory->destroy(tbuf);
+  }
+
+  // rigid bodies in the infile format of fix rigid/small
+
+  int nbody = (rigid && rigid->setupflag) ? rigid->nlocal_body : 0;
+  if (nbody) {
+    double **bbuf;
+    memory->create(bbuf,nbody,20,"checkpoint:bbuf");
+    rigid->pack_body_info(bbuf);
+    for (int i = 0; i < nbody; i++)
+      fprintf(fp[BODIES],"%d %-1.16e %-1.16e %-1.16e %-1.16e "
+              "%-1.16e %-1.16e %-1.16e %-1.16e %-1.16e %-1.16e "
+              "%-1.16e %-1.16e %-1.16e %-1.16e %-1.16e %-1.16e "
+              "%d %d %d\n",
+              static_cast<int> (bbuf[i][0]),bbuf[i][1],
+              bbuf[i][2],bbuf[i][3],bbuf[i][4],
+              bbuf[i][5],bbuf[i][6],bbuf[i][7],
+              bbuf[i][8],bbuf[i][9],bbuf[i][10],
+              bbuf[i][11],bbuf[i][12],bbuf[i][13],
+              bbuf[i][14],bbuf[i][15],bbuf[i][16],
+              static_cast<int> (bbuf[i][17]),
+              static_cast<int> (bbuf[i][18]),
+              static_cast<int> (bbuf[i][19]));
+    memory->destroy(bbuf);
+  }
+
+  for (int s = 0; s < NSECTIONS; s++)
+    fclose(fp[s]);
+}
+
+/* ----------------------------------------------------------------------
+   Open the files and post non-blocking writes of my part of every
+   section. Within a file, sections follow each other and the parts of
+   each section are ordered by proc.
+------------------------------------------------------------------------- */
+
+void FixSoftcoreCheckpoint::start_write()
+{
+  bigint mine[NSECTIONS],offset[NSECTIONS],total[NSECTIONS];
+  for (int s = 0; s < NSECTIONS; s++)
+    mine[s] = length[s];
+  MPI_Exscan(mine,offset,NSECTIONS,MPI_LMP_BIGINT,MPI_SUM,world);
+  if (comm->me == 0)
+    for (int s = 0; s < NSECTIONS; s++) offset[s] = 0;
+  MPI_Allreduce(mine,total,NSECTIONS,MPI_LMP_BIGINT,MPI_SUM,world);
+
+  bigint filesize[NFILES];
+  for (int f = 0; f < NFILES; f++)
+    filesize[f] = 0;
+  for (int s = 0; s < NSECTIONS; s++) {
+    offset[s] += filesize[sectionfile[s]];
+    filesize[sectionfile[s]] += total[s];
+  }
+
+  char *star = strchr(filename,'*');
+  char *fname = new char[strlen(filename) + 40];
+  for (int f = 0; f < NFILES; f++) {
+    opened[f] = f == DATA || filesize[f] > 0;
+    if (!opened[f]) continue;
+    if (star) {
+      *star = '\0';
+      sprintf(fname,"%s" BIGINT_FORMAT "%s%s",
+              filename,update->ntimestep,star+1,suffix[f]);
+      *star = '*';
+    } else sprintf(fname,"%s%s",filename,suffix[f]);
+
+    int err = MPI_File_open(world,fname,MPI_MODE_WRONLY | MPI_MODE_CREATE,
+                            MPI_INFO_NULL,&fh[f]);
+    if (err != MPI_SUCCESS) {
+      char str[128];
+      snprintf(str,128,"Cannot open fix softcore/checkpoint file %s",fname);
+      error->all(FLERR,str);
+    }
+    MPI_File_set_size(fh[f],0);
+  }
+  delete [] fname;
+
+  for (int s = 0; s < NSECTIONS; s++)
+    if (opened[sectionfile[s]])
+      MPI_File_iwrite_at(fh[sectionfile[s]],offset[s],text[s],length[s],
+                         MPI_CHAR,&request[s]);
+    else request[s] = MPI_REQUEST_NULL;
+  pending = 1;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixSoftcoreCheckpoint::finish_write()
+{
+  if (!pending) return;
+  MPI_Waitall(NSECTIONS,request,MPI_STATUSES_IGNORE);
+  for (int f = 0; f < NFILES; f++)
+    if (opened[f]) MPI_File_close(&fh[f]);
+  for (int s = 0; s < NSECTIONS; s++) {
+    free(text[s]);
+    text[s] = NULL;
+    length[s] = 0;
+  }
+  pending = 0;
+}
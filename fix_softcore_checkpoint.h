@@ -0,0 +1,81 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifdef FIX_CLASS
+
+FixStyle(softcore/checkpoint,FixSoftcoreCheckpoint)
+
+#else
+
+#ifndef LMP_FIX_SOFTCORE_CHECKPOINT_H
+#define LMP_FIX_SOFTCORE_CHECKPOINT_H
+
+#include "mpi.h"
+#include "stdio.h"
+#include "fix.h"
+
+namespace LAMMPS_NS {
+
+class FixSoftcoreCheckpoint : public Fix {
+ public:
+  FixSoftcoreCheckpoint(class LAMMPS *, int, char **);
+  ~FixSoftcoreCheckpoint();
+  int setmask();
+  void init();
+  void end_of_step();
+  void post_run();
+
+ private:
+  enum{NSECTIONS = 9, NFILES = 3};
+
+  char *filename;              // file name, '*' is replaced by timestep
+  class FixSoftcoreEE *ee;     // expanded-ensemble fix, if any
+  class FixRigidSmall *rigid;  // rigid/small fix, if any
+
+  char *text[NSECTIONS];       // my text of each section of the files
+  size_t length[NSECTIONS];
+
+  int pending;                 // 1 if a write is still in progress
+  int opened[NFILES];          // 1 if a file is part of the checkpoint
+  MPI_File fh[NFILES];
+  MPI_Request request[NSECTIONS];
+
+  void snapshot();
+  void start_write();
+  void finish_write();
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Fix softcore/checkpoint must use group all
+
+The data file must contain all atoms, since topology may refer to any
+of them.
+
+E: Cannot open fix softcore/checkpoint file %s
+
+The specified file cannot be opened.  Check that the path and name are
+correct.
+
+*/
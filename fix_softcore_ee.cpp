@@ -18,6 +18,7 @@
 
 #include "fix_softcore_ee.h"
 #include "pair_hybrid_softcore.h"
+#include "fix_softcore_restraint.h"
 #include "update.h"
 #include "force.h"
 #include "pair.h"
@@ -25,6 +26,7 @@
 #include "comm.h"
 #include "random_park.h"
 #include "string.h"
+#include "math.h"
 #include "atom.h"
 #include "atom_vec.h"
 #include "bond.h"
@@ -32,6 +34,7 @@
 #include "dihedral.h"
 #include "improper.h"
 #include "kspace.h"
+#include "domain.h"
 #include "modify.h"
 #include "compute.h"
 #include "timer.h"
@@ -47,7 +50,7 @@ FixSoftcoreEE::FixSoftcoreEE(LAMMPS *lmp, int narg, char **arg) :
   Fix(lmp, narg, arg)
 {
   // Retrieve fix softcore/ee command arguments:
-  if (narg < 6 || narg == 7)
+  if (narg < 6)
     error->all(FLERR,"Illegal fix softcore/ee command");
 
   nevery = force->numeric(FLERR,arg[3]);
@@ -59,16 +62,70 @@ FixSoftcoreEE::FixSoftcoreEE(LAMMPS *lmp, int narg, char **arg) :
     error->all(FLERR,"Illegal fix softcore/ee command");
   minus_beta = -1.0/(force->boltz*force->numeric(FLERR,arg[5]));
 
-  if (narg > 7) {
-    if (strcmp(arg[6],"weights") != 0)
+  // Optional keywords (weights must be the last one):
+  //   histogram Nbins dUmax Nreport = bin beta*dU in [-dUmax,dUmax] and
+  //                                   report overlaps every Nreport steps
+  //   histfile name = also write the full histograms to a file
+  //   warmup N = compute weights from N steps at each node before sampling
+  //   weights w1 ... wG = expanded ensemble weights of all nodes
+  weight = NULL;
+  nbins = 0;
+  histfp = NULL;
+  nwarmup = 0;
+  int iarg = 6;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"histogram") == 0) {
+      if (iarg+4 > narg)
+        error->all(FLERR,"Illegal fix softcore/ee command");
+      nbins = force->inumeric(FLERR,arg[iarg+1]);
+      dumax = force->numeric(FLERR,arg[iarg+2]);
+      nreport = force->inumeric(FLERR,arg[iarg+3]);
+      if (nbins < 2 || dumax <= 0.0 || nreport <= 0)
+        error->all(FLERR,"Illegal fix softcore/ee command");
+      if (nreport % nevery)
+        error->all(FLERR,"Fix softcore/ee report interval must be a multiple of nevery");
+      iarg += 4;
+    }
+    else if (strcmp(arg[iarg],"warmup") == 0) {
+      if (iarg+2 > narg)
+        error->all(FLERR,"Illegal fix softcore/ee command");
+      nwarmup = force->inumeric(FLERR,arg[iarg+1]);
+      if (nwarmup <= 0)
+        error->all(FLERR,"Illegal fix softcore/ee command");
+      if (nwarmup % nevery)
+        error->all(FLERR,"Fix softcore/ee warmup must be a multiple of nevery");
+      iarg += 2;
+    }
+    else if (strcmp(arg[iarg],"histfile") == 0) {
+      if (iarg+2 > narg)
+        error->all(FLERR,"Illegal fix softcore/ee command");
+      if (comm->me == 0 && !histfp) {
+        histfp = fopen(arg[iarg+1],"w");
+        if (!histfp) {
+          char str[128];
+          sprintf(str,"Cannot open fix softcore/ee histogram file %s",arg[iarg+1]);
+          error->one(FLERR,str);
+        }
+      }
+      iarg += 2;
+    }
+    else if (strcmp(arg[iarg],"weights") == 0) {
+      gridsize = narg - iarg - 1;
+      if (gridsize < 1)
+        error->all(FLERR,"Illegal fix softcore/ee command");
+      memory->create(weight,gridsize,"fix_softcore_ee::weight");
+      for (int i = 0; i < gridsize; i++)
+        weight[i] = force->numeric(FLERR,arg[iarg+1+i]);
+      iarg = narg;
+    }
+    else
       error->all(FLERR,"Illegal fix softcore/ee command");
-    gridsize = narg - 7;
-    memory->create(weight,gridsize,"fix_softcore_ee::weight");
-    for (int i = 0; i < gridsize; i++)
-      weight[i] = force->numeric(FLERR,arg[7+i]);
   }
-  else
-    weight = NULL;
+  hist = nvisit = sumacc = NULL;
+  if (nwarmup && weight)
+    error->all(FLERR,"Fix softcore/ee: warmup cannot be used with explicit weights");
+  warmup = nwarmup > 0;
+  started = resetflag = 0;
 
   // Check if this fix preceeds all fixes with initial_integrate:
   for (int i = 0; i < modify->nfix; i++)
@@ -80,18 +137,24 @@ FixSoftcoreEE::FixSoftcoreEE(LAMMPS *lmp, int narg, char **arg) :
   size_vector = 2;
   global_freq = 1;
 
-  // Certify the use of pair style hybrid:
+  // Look for lambda-related pair styles, either as sub-styles of pair
+  // style hybrid/softcore or as a standalone pair style:
   PairHybridSoftcore *hybrid = dynamic_cast<PairHybridSoftcore*>(force->pair);
-  if (!hybrid)
-    error->all(FLERR,"fix softcore/ee: use of pair style hybrid/softcore is mandatory");
-
-  // Look for lambda-related pair styles:
-  pair = new class PairSoftcore*[hybrid->nstyles];
-  npairs = 0;
-  for (int i = 0; i < hybrid->nstyles; i++) {
-    pair[npairs] = dynamic_cast<class PairSoftcore*>(hybrid->styles[i]);
-    if (pair[npairs])
-      npairs++;
+  if (hybrid) {
+    standalone = 0;
+    pair = new class PairSoftcore*[hybrid->nstyles];
+    npairs = 0;
+    for (int i = 0; i < hybrid->nstyles; i++) {
+      pair[npairs] = dynamic_cast<class PairSoftcore*>(hybrid->styles[i]);
+      if (pair[npairs])
+        npairs++;
+    }
+  }
+  else {
+    standalone = 1;
+    pair = new class PairSoftcore*[1];
+    pair[0] = dynamic_cast<class PairSoftcore*>(force->pair);
+    npairs = pair[0] ? 1 : 0;
   }
   if (npairs == 0)
     error->all(FLERR,"fix softcore/ee: no pair styles associated to coupling parameter lambda");
@@ -99,10 +162,13 @@ FixSoftcoreEE::FixSoftcoreEE(LAMMPS *lmp, int narg, char **arg) :
   // Allocate array for storing compute flags of softcore pair styles:
   compute_flag = new int[npairs];
 
-  // Allocate force buffer:
+  // Restraints are retrieved at init, since they may be defined later:
+  nrestraints = 0;
+  restraint = NULL;
+
+  // Allocate buffers for lambda-free properties:
   nmax = atom->nlocal;
   if (force->newton_pair) nmax += atom->nghost;
-  memory->create(f_soft,nmax,3,"fix_softcore_ee::f_soft");
   memory->create(f,nmax,3,"fix_softcore_ee::f");
   memory->create(eatom,nmax,"fix_softcore_ee::eatom");
   memory->create(vatom,nmax,6,"fix_softcore_ee::vatom");
@@ -115,13 +181,17 @@ FixSoftcoreEE::FixSoftcoreEE(LAMMPS *lmp, int narg, char **arg) :
 
 FixSoftcoreEE::~FixSoftcoreEE()
 {
-  memory->destroy(f_soft);
   memory->destroy(f);
   memory->destroy(eatom);
   memory->destroy(vatom);
   if (weight) memory->destroy(weight);
+  memory->destroy(hist);
+  memory->destroy(nvisit);
+  memory->destroy(sumacc);
+  if (histfp) fclose(histfp);
   delete [] pair;
   delete [] compute_flag;
+  delete [] restraint;
   delete random;
 }
 
@@ -129,15 +199,19 @@ FixSoftcoreEE::~FixSoftcoreEE()
 
 int FixSoftcoreEE::setmask()
 {
-  return INITIAL_INTEGRATE | PRE_REVERSE | END_OF_STEP;
+  return INITIAL_INTEGRATE | PRE_FORCE | PRE_REVERSE | END_OF_STEP;
 }
 
 /* ----------------------------------------------------------------------
    Before starting a run, certify that all softcore pair styles have
    equally sized lambda grids. Then, check if the corresponding number
    of weights has been specified. If there are no weights at all, specify
-   all weights as zero. Finally, call change_node(0) so that the all pair
-   styles are reinitialized with the corresponding lambda value.
+   all weights as zero. In the first run (or after fix_modify reset), call
+   change_node(0) so that the all pair styles are reinitialized with the
+   corresponding lambda value. In subsequent runs, the walk continues from
+   the current node, with weights, warm-start and histograms preserved, and
+   a node change decided at the last step of the previous run is enacted
+   before setup computes the forces.
 ------------------------------------------------------------------------- */
 
 void FixSoftcoreEE::init()
@@ -152,6 +226,32 @@ void FixSoftcoreEE::init()
   if (nodes == 0)
     error->all(FLERR,"fix softcore/ee: no lambda grid has been defined");
 
+  // Retrieve lambda-coupled restraints, which are switched along with
+  // the pair styles and whose node energies are included:
+  delete [] restraint;
+  restraint = new class FixSoftcoreRestraint*[modify->nfix];
+  nrestraints = 0;
+  for (int i = 0; i < modify->nfix; i++)
+    if ((restraint[nrestraints] = dynamic_cast<class FixSoftcoreRestraint*>(modify->fix[i])))
+      nrestraints++;
+  for (int i = 0; i < nrestraints; i++)
+    if (restraint[i]->grid_size() != nodes)
+      error->all(FLERR,"Fix softcore/ee: restraint and lambda grids have different numbers of nodes");
+
+  // Continue the walk of a previous run, enacting any pending node change:
+  if (started && !resetflag) {
+    if (gridsize != nodes)
+      error->all(FLERR,"fix softcore/ee: numbers of weights and lambda nodes are different");
+    for (int i = 0; i < npairs; i++)
+      compute_flag[i] = pair[i]->compute_flag;
+    change_node(must_change_node ? new_node : current_node);
+    must_change_node = 0;
+    return;
+  }
+  warmup = nwarmup > 0;
+  started = 1;
+  resetflag = 0;
+
   // Check if weights were specified in the required amount:
   if (!weight) {
     gridsize = nodes;
@@ -162,16 +262,28 @@ void FixSoftcoreEE::init()
   else if (gridsize != nodes)
     error->all(FLERR,"fix softcore/ee: numbers of weights and lambda nodes are different");
 
-  // Print the weights:
-  if (comm->me == 0) {
-    FILE* unit[2] = {screen,logfile};
-    for (int i = 0; i < 2; i++)
-      if (unit[i]) {
-        fprintf(unit[i],"Expanded ensemble weights: (");
-        for (int k = 0; k < gridsize-1; k++)
-          fprintf(unit[i],"%g; ",weight[k]);
-        fprintf(unit[i],"%g)\n",weight[gridsize-1]);
-      }
+  // Print the weights, unless they are still to be computed:
+  if (warmup && gridsize > 1)
+    nwarm = 0;
+  else {
+    warmup = 0;
+    print_weights();
+  }
+
+  // Allocate and clear the histograms (only the root process needs them):
+  if (nbins && comm->me == 0) {
+    memory->destroy(hist);
+    memory->destroy(nvisit);
+    memory->destroy(sumacc);
+    memory->create(hist,gridsize*gridsize*nbins,"fix_softcore_ee::hist");
+    memory->create(nvisit,gridsize,"fix_softcore_ee::nvisit");
+    memory->create(sumacc,gridsize*gridsize,"fix_softcore_ee::sumacc");
+    for (int i = 0; i < gridsize*gridsize*nbins; i++)
+      hist[i] = 0.0;
+    for (int k = 0; k < gridsize; k++)
+      nvisit[k] = 0.0;
+    for (int i = 0; i < gridsize*gridsize; i++)
+      sumacc[i] = 0.0;
   }
 
   // Store compute flags of lambda-related pair styles:
@@ -184,6 +296,144 @@ void FixSoftcoreEE::init()
   must_change_node = 0;
 }
 
+/* ----------------------------------------------------------------------
+   fix_modify ID reset = restart the walk at node 0 in the next run
+   fix_modify ID state file = continue the walk saved in file by
+                              fix softcore/checkpoint in the next run
+------------------------------------------------------------------------- */
+
+int FixSoftcoreEE::modify_param(int narg, char **arg)
+{
+  if (strcmp(arg[0],"reset") == 0) {
+    resetflag = 1;
+    return 1;
+  }
+  if (strcmp(arg[0],"state") == 0) {
+    if (narg < 2) error->all(FLERR,"Illegal fix_modify command");
+    read_state(arg[1]);
+    return 2;
+  }
+  return 0;
+}
+
+/* ----------------------------------------------------------------------
+   Write the state of the walk (called by proc 0 only): node and pending
+   change, weights, warm-start progress and histograms. The random number
+   generator is not included, so a continued walk is statistically but
+   not bitwise equivalent.
+------------------------------------------------------------------------- */
+
+void FixSoftcoreEE::write_state(FILE *fp)
+{
+  fprintf(fp,"# fix softcore/ee state on timestep " BIGINT_FORMAT "\n",
+          update->ntimestep);
+  fprintf(fp,"%d %d %d %d %d\n",started ? gridsize : 0,current_node,
+          must_change_node,new_node,downhill);
+  if (!started) return;
+  fprintf(fp,"%d %d %-1.16e\n",warmup,nwarm,warmup ? lnsum : 0.0);
+  for (int k = 0; k < gridsize; k++)
+    fprintf(fp,"%-1.16e%s",weight[k],k < gridsize-1 ? " " : "\n");
+
+  int nh = hist ? nbins : 0;
+  fprintf(fp,"%d %-1.16e\n",nh,nh ? dumax : 0.0);
+  if (nh == 0) return;
+  for (int k = 0; k < gridsize; k++)
+    fprintf(fp,"%-1.16e%s",nvisit[k],k < gridsize-1 ? " " : "\n");
+  for (int i = 0; i < gridsize*gridsize; i++)
+    fprintf(fp,"%-1.16e%s",sumacc[i],(i+1) % gridsize ? " " : "\n");
+  for (int i = 0; i < gridsize*gridsize*nbins; i++)
+    fprintf(fp,"%-1.16e%s",hist[i],(i+1) % nbins ? " " : "\n");
+}
+
+/* ----------------------------------------------------------------------
+   Read a state written by write_state(), so that the next run continues
+   the walk as if it were a subsequent run. Histograms are restored only
+   if their bins are the same as those of the histogram keyword.
+------------------------------------------------------------------------- */
+
+void FixSoftcoreEE::read_state(char *file)
+{
+  FILE *fp = NULL;
+  int ivalue[8];
+  double dvalue[2];
+  int ok = 1;
+
+  if (comm->me == 0) {
+    fp = fopen(file,"r");
+    if (fp == NULL) {
+      char str[128];
+      snprintf(str,128,"Cannot open fix softcore/ee state file %s",file);
+      error->one(FLERR,str);
+    }
+    ok = fscanf(fp,"%*[^\n]") == 0 &&
+      fscanf(fp,"%d %d %d %d %d",&ivalue[0],&ivalue[1],&ivalue[2],
+             &ivalue[3],&ivalue[4]) == 5 && ivalue[0] > 0 &&
+      fscanf(fp,"%d %d %lg",&ivalue[5],&ivalue[6],&dvalue[0]) == 3;
+  }
+  MPI_Bcast(&ok,1,MPI_INT,0,world);
+  if (!ok) error->all(FLERR,"Invalid fix softcore/ee state file");
+  MPI_Bcast(ivalue,7,MPI_INT,0,world);
+  MPI_Bcast(dvalue,1,MPI_DOUBLE,0,world);
+
+  gridsize = ivalue[0];
+  current_node = ivalue[1];
+  must_change_node = ivalue[2];
+  new_node = ivalue[3];
+  downhill = ivalue[4];
+  warmup = ivalue[5];
+  nwarm = ivalue[6];
+  lnsum = dvalue[0];
+  if (current_node < 0 || current_node >= gridsize ||
+      new_node < 0 || new_node >= gridsize)
+    error->all(FLERR,"Invalid fix softcore/ee state file");
+
+  if (weight) memory->destroy(weight);
+  memory->create(weight,gridsize,"fix_softcore_ee::weight");
+  if (comm->me == 0)
+    for (int k = 0; k < gridsize && ok; k++)
+      ok = fscanf(fp,"%lg",&weight[k]) == 1;
+  MPI_Bcast(&ok,1,MPI_INT,0,world);
+  if (!ok) error->all(FLERR,"Invalid fix softcore/ee state file");
+  MPI_Bcast(weight,gridsize,MPI_DOUBLE,0,world);
+
+  // histograms live on proc 0 only:
+  if (comm->me == 0) {
+    int nh = 0;
+    ok = fscanf(fp,"%d %lg",&nh,&dvalue[1]) == 2;
+    memory->destroy(hist);
+    memory->destroy(nvisit);
+    memory->destroy(sumacc);
+    if (ok && nbins) {
+      memory->create(hist,gridsize*gridsize*nbins,"fix_softcore_ee::hist");
+      memory->create(nvisit,gridsize,"fix_softcore_ee::nvisit");
+      memory->create(sumacc,gridsize*gridsize,"fix_softcore_ee::sumacc");
+      int n = nh == nbins && dvalue[1] == dumax ? gridsize*gridsize*nbins : 0;
+      for (int k = 0; k < gridsize; k++)
+        nvisit[k] = 0.0;
+      for (int i = 0; i < gridsize*gridsize; i++)
+        sumacc[i] = 0.0;
+      for (int i = 0; i < gridsize*gridsize*nbins; i++)
+        hist[i] = 0.0;
+      if (n) {
+        for (int k = 0; k < gridsize && ok; k++)
+          ok = fscanf(fp,"%lg",&nvisit[k]) == 1;
+        for (int i = 0; i < gridsize*gridsize && ok; i++)
+          ok = fscanf(fp,"%lg",&sumacc[i]) == 1;
+        for (int i = 0; i < n && ok; i++)
+          ok = fscanf(fp,"%lg",&hist[i]) == 1;
+      }
+      else if (nh) error->warning(FLERR,"Fix softcore/ee state file histograms "
+                                  "do not match the histogram keyword");
+    }
+    fclose(fp);
+  }
+  MPI_Bcast(&ok,1,MPI_INT,0,world);
+  if (!ok) error->all(FLERR,"Invalid fix softcore/ee state file");
+
+  started = 1;
+  resetflag = 0;
+}
+
 /* ----------------------------------------------------------------------
    Enact node changing if this was decided in the previous time step.
    This is done before the initial_integrate routines of integration
@@ -205,44 +455,49 @@ void FixSoftcoreEE::initial_integrate(int vflag)
       atom->f[i][1] = this->f[i][1];
       atom->f[i][2] = this->f[i][2];
     }
-    if (hybrid->eflag_global) {
-      hybrid->eng_vdwl = this->eng_vdwl;
-      hybrid->eng_coul = this->eng_coul;
-    }
-    if (hybrid->vflag_global)
-      for (int k = 0; k < 6; k++)
-        hybrid->virial[k] = this->virial[k];
-    if (hybrid->eflag_atom)
-      for (int j = 0; j < n; j++)
-        hybrid->eatom[j] = this->eatom[j];
-    if (hybrid->vflag_atom)
-      for (int j = 0; j < n; j++)
-        for (int k = 0; k < 6; k++)
-          hybrid->vatom[j][k] = this->vatom[j][k];
 
     // Change to the new node:
     change_node(new_node);
 
-    // Compute and add pair interactions using the new lambda value:
-    for (int i = 0; i < npairs; i++) {
-      class PairSoftcore *ipair = pair[i];
-      ipair->gridflag = 0;
-      ipair->compute(this->eflag,this->vflag);
-      ipair->uptodate = 1;
-      if (ipair->eflag_global) {
-        hybrid->eng_vdwl += ipair->eng_vdwl;
-        hybrid->eng_coul += ipair->eng_coul;
+    // A standalone style recomputes all its energies and virials:
+    if (standalone) {
+      pair[0]->compute_softcore(atom->f,NULL,NULL,this->eflag,this->vflag);
+      pair[0]->uptodate = 1;
+    }
+
+    // Otherwise, restore lambda-free energies and virials of the other
+    // sub-styles and add pair interactions using the new lambda value:
+    else {
+      if (hybrid->eflag_global) {
+        hybrid->eng_vdwl = this->eng_vdwl;
+        hybrid->eng_coul = this->eng_coul;
       }
-      if (ipair->vflag_global)
+      if (hybrid->vflag_global)
         for (int k = 0; k < 6; k++)
-          hybrid->virial[k] += ipair->virial[k];
-      if (ipair->eflag_atom)
+          hybrid->virial[k] = this->virial[k];
+      if (hybrid->eflag_atom)
         for (int j = 0; j < n; j++)
-          hybrid->eatom[j] += ipair->eatom[j];
-      if (ipair->vflag_atom)
+          hybrid->eatom[j] = this->eatom[j];
+      if (hybrid->vflag_atom)
         for (int j = 0; j < n; j++)
           for (int k = 0; k < 6; k++)
-            hybrid->vatom[j][k] += ipair->vatom[j][k];
+            hybrid->vatom[j][k] = this->vatom[j][k];
+      for (int i = 0; i < npairs; i++) {
+        class PairSoftcore *ipair = pair[i];
+        ipair->compute_softcore(atom->f,NULL,hybrid->virial,this->eflag,this->vflag);
+        ipair->uptodate = 1;
+        if (ipair->eflag_global) {
+          hybrid->eng_vdwl += ipair->eng_vdwl;
+          hybrid->eng_coul += ipair->eng_coul;
+        }
+        if (ipair->eflag_atom)
+          for (int j = 0; j < n; j++)
+            hybrid->eatom[j] += ipair->eatom[j];
+        if (ipair->vflag_atom)
+          for (int j = 0; j < n; j++)
+            for (int k = 0; k < 6; k++)
+              hybrid->vatom[j][k] += ipair->vatom[j][k];
+      }
     }
 
     // Reverse communicate forces:
@@ -253,11 +508,25 @@ void FixSoftcoreEE::initial_integrate(int vflag)
     if (modify->n_post_force)
       modify->post_force(this->vflag);
   }
-  else if (cycle == 0) // Node change will be tested at this step
+  else if (cycle == 0 && !standalone) // Node change will be tested at this step
     for (int i = 0; i < npairs; i++)
       pair[i]->compute_flag = 0;
 }
 
+/* ----------------------------------------------------------------------
+   A standalone softcore pair style cannot be skipped by the force
+   computation. At the steps of node selection, it computes the lambda
+   grid along with its forces, which are written to its scratch buffer
+   so that they can be kept apart from the lambda-free forces.
+------------------------------------------------------------------------- */
+
+void FixSoftcoreEE::pre_force(int vflag)
+{
+  if (!standalone || update->ntimestep % nevery) return;
+  pair[0]->fdest = pair[0]->scratch_forces();
+  pair[0]->gridflag = 1;
+}
+
 /* ----------------------------------------------------------------------
    After lambda-free forces, energies, and virials have been computed,
    compute the softcore pair interactions with the current lambda value
@@ -270,34 +539,66 @@ void FixSoftcoreEE::pre_reverse(int eflag, int vflag)
   if (update->ntimestep % nevery) return;
 
   int n = number_of_atoms();
-  PairHybridSoftcore *hybrid = (PairHybridSoftcore *) force->pair;
-
-  // Compute and store pair interactions using the current lambda value:
-  for (int i = 0; i < n; i++)
-    f_soft[i][0] = f_soft[i][1] = f_soft[i][2] = 0.0;
-  std::swap(atom->f,f_soft);
-  for (int i = 0; i < npairs; i++) {
-    pair[i]->gridflag = 1;
-    pair[i]->compute(eflag,vflag);
+  class Pair *hybrid = force->pair;
+
+  // Compute and store pair interactions using the current lambda value,
+  // unless a standalone style has already done so in the force computation:
+  double **f_soft;
+  double local[gridsize];
+  if (standalone) {
+    f_soft = pair[0]->fdest;
+    pair[0]->fdest = NULL;
+    for (int j = 0; j < gridsize; j++)
+      local[j] = pair[0]->evdwlnode[j];
+  }
+  else {
+    f_soft = pair[0]->scratch_forces();
+    for (int j = 0; j < gridsize; j++)
+      local[j] = 0.0;
+    for (int i = 0; i < npairs; i++)
+      pair[i]->compute_softcore(f_soft,local,NULL,eflag,vflag);
   }
-  std::swap(f_soft,atom->f);
 
-  // Compute lambda-related energy at every grid node:
-  double energy[gridsize] = {0.0};
-  for (int i = 0; i < npairs; i++) {
-    double node_energy[gridsize];
-    MPI_Allreduce(pair[i]->evdwlnode,&node_energy[0],gridsize,MPI_DOUBLE,MPI_SUM,world);
-    if (pair[i]->tail_flag) {
-      double volume = domain->xprd*domain->yprd*domain->zprd;
+  // Restraint energies at every node are summed into proc 0:
+  double erest[gridsize];
+  for (int j = 0; j < gridsize; j++)
+    erest[j] = 0.0;
+  for (int i = 0; i < nrestraints; i++)
+    restraint[i]->node_energies(erest);
+
+  // Sum lambda-related energy at every grid node into proc 0, only over
+  // the procs holding softcore pairs:
+  MPI_Comm gridcomm = pair[0]->grid_comm(pair,npairs);
+  if (gridcomm != MPI_COMM_NULL) {
+    double energy[gridsize];
+    MPI_Reduce(local,energy,gridsize,MPI_DOUBLE,MPI_SUM,0,gridcomm);
+
+    if (comm->me == 0) {
       for (int j = 0; j < gridsize; j++)
-        node_energy[j] += pair[i]->etailnode[j]/volume;
+        energy[j] += erest[j];
+      double volume = domain->xprd*domain->yprd*domain->zprd;
+      for (int i = 0; i < npairs; i++)
+        if (pair[i]->tail_flag)
+          for (int j = 0; j < gridsize; j++)
+            energy[j] += pair[i]->etailnode[j]/volume;
+
+      // Update energy-difference histograms and report overlaps:
+      if (nbins) {
+        accumulate(energy);
+        if (update->ntimestep % nreport == 0)
+          report();
+      }
+
+      // Select a node from the expanded ensemble (or march across the grid):
+      if (warmup)
+        new_node = warm_start( energy );
+      else
+        new_node = select_node( energy );
     }
-    for (int j = 0; j < gridsize; j++)
-      energy[j] += node_energy[j];
   }
 
-  // Select a node from the expanded ensemble:
-  new_node = select_node( energy );
+  // Let all procs know the selected node:
+  MPI_Bcast(&new_node,1,MPI_INT,0,world);
 
   // Change node if necessary:
   must_change_node = new_node != current_node;
@@ -309,20 +610,22 @@ void FixSoftcoreEE::pre_reverse(int eflag, int vflag)
       this->f[i][1] = atom->f[i][1];
       this->f[i][2] = atom->f[i][2];
     }
-    if (hybrid->eflag_global) {
-      this->eng_vdwl = hybrid->eng_vdwl;
-      this->eng_coul = hybrid->eng_coul;
-    }
-    if (hybrid->vflag_global)
-      for (int k = 0; k < 6; k++)
-        this->virial[k] = hybrid->virial[k];
-    if (hybrid->eflag_atom)
-      for (int j = 0; j < n; j++)
-        this->eatom[j] = hybrid->eatom[j];
-    if (hybrid->vflag_atom)
-      for (int j = 0; j < n; j++)
+    if (!standalone) {
+      if (hybrid->eflag_global) {
+        this->eng_vdwl = hybrid->eng_vdwl;
+        this->eng_coul = hybrid->eng_coul;
+      }
+      if (hybrid->vflag_global)
         for (int k = 0; k < 6; k++)
-          this->vatom[j][k] = hybrid->vatom[j][k];
+          this->virial[k] = hybrid->virial[k];
+      if (hybrid->eflag_atom)
+        for (int j = 0; j < n; j++)
+          this->eatom[j] = hybrid->eatom[j];
+      if (hybrid->vflag_atom)
+        for (int j = 0; j < n; j++)
+          for (int k = 0; k < 6; k++)
+            this->vatom[j][k] = hybrid->vatom[j][k];
+    }
 
     this->eflag = eflag;
     this->vflag = vflag;
@@ -334,7 +637,7 @@ void FixSoftcoreEE::pre_reverse(int eflag, int vflag)
     atom->f[i][1] += f_soft[i][1];
     atom->f[i][2] += f_soft[i][2];
   }
-  for (int i = 0; i < npairs; i++) {
+  for (int i = 0; i < npairs && !standalone; i++) {
     class PairSoftcore *ipair = pair[i];
     if (ipair->eflag_global) {
       hybrid->eng_vdwl += ipair->eng_vdwl;
@@ -357,7 +660,10 @@ void FixSoftcoreEE::pre_reverse(int eflag, int vflag)
     pair[i]->compute_flag = compute_flag[i];
 }
 
-/*----------------------------------------------------------------------------*/
+/* ----------------------------------------------------------------------
+   Sample a node from the expanded ensemble distribution. Only proc 0
+   holds the node energies, so the result is broadcast by the caller.
+------------------------------------------------------------------------- */
 
 int FixSoftcoreEE::select_node(double *energy)
 {
@@ -387,11 +693,133 @@ int FixSoftcoreEE::select_node(double *energy)
     node++;
     acc += P[node];
   }
-  MPI_Bcast(&node,1,MPI_INT,0,world);
 
   return node;
 }
 
+/* ----------------------------------------------------------------------
+   Warm-start: stay at node k for nwarmup steps while accumulating the
+   exponential average <exp(-beta*(U[k+1] - U[k]))>_k, then set
+   weight[k+1] = weight[k] + beta*dF(k -> k+1) and move to node k+1.
+   Like select_node(), this is only invoked by proc 0.
+------------------------------------------------------------------------- */
+
+int FixSoftcoreEE::warm_start(double *energy)
+{
+  int k = current_node;
+  double a = minus_beta*(energy[k+1] - energy[k]);
+  if (nwarm == 0)
+    lnsum = a;
+  else
+    lnsum = MAX(lnsum,a) + log1p(exp(-fabs(lnsum - a)));
+  nwarm++;
+  if (nwarm*nevery < nwarmup)
+    return k;
+
+  weight[k+1] = weight[k] - lnsum + log(nwarm);
+  nwarm = 0;
+  if (k+1 == gridsize-1) {
+    warmup = 0;
+    print_weights();
+  }
+  return k+1;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixSoftcoreEE::print_weights()
+{
+  if (comm->me == 0) {
+    FILE* unit[2] = {screen,logfile};
+    for (int i = 0; i < 2; i++)
+      if (unit[i]) {
+        fprintf(unit[i],"Expanded ensemble weights: (");
+        for (int k = 0; k < gridsize-1; k++)
+          fprintf(unit[i],"%g; ",weight[k]);
+        fprintf(unit[i],"%g)\n",weight[gridsize-1]);
+      }
+  }
+}
+
+/* ----------------------------------------------------------------------
+   Bin beta*(U[m] - U[k]) for every node m, with k being the current node,
+   and accumulate the Metropolis acceptance probability of a k -> m move.
+   Values beyond the histogram range are counted in the end bins.
+------------------------------------------------------------------------- */
+
+void FixSoftcoreEE::accumulate(double *energy)
+{
+  int k = current_node;
+  double width = 2.0*dumax/nbins;
+  double *h = hist + k*gridsize*nbins;
+  double *acc = sumacc + k*gridsize;
+
+  nvisit[k] += 1.0;
+  for (int m = 0; m < gridsize; m++) {
+    double du = minus_beta*(energy[k] - energy[m]);
+    int bin = static_cast<int>(floor((du + dumax)/width));
+    bin = MAX(0,MIN(nbins-1,bin));
+    h[m*nbins + bin] += 1.0;
+    double arg = weight[m] - weight[k] - du;
+    acc[m] += arg < 0.0 ? exp(arg) : 1.0;
+  }
+}
+
+/* ----------------------------------------------------------------------
+   Print, for every pair of adjacent nodes, the overlap coefficient of
+   the distributions of beta*(U[k+1] - U[k]) sampled at nodes k and k+1,
+   and the predicted acceptance probabilities of k -> k+1 and k+1 -> k
+   moves. A histogram of beta*(U[k] - U[k+1]) is mirrored onto one of
+   beta*(U[k+1] - U[k]) by reversing its bins, since the range is
+   symmetric. Optionally, write all normalized histograms to a file.
+------------------------------------------------------------------------- */
+
+void FixSoftcoreEE::report()
+{
+  FILE* unit[2] = {screen,logfile};
+  for (int i = 0; i < 2; i++)
+    if (unit[i])
+      fprintf(unit[i],"Expanded ensemble overlaps at step " BIGINT_FORMAT
+              " (nodes, overlap, acceptance forward/backward):\n",
+              update->ntimestep);
+
+  for (int k = 0; k < gridsize-1; k++) {
+    double nk = nvisit[k];
+    double nl = nvisit[k+1];
+    double overlap = 0.0;
+    if (nk > 0.0 && nl > 0.0) {
+      double *hfw = hist + (k*gridsize + k+1)*nbins;
+      double *hbw = hist + ((k+1)*gridsize + k)*nbins;
+      for (int b = 0; b < nbins; b++)
+        overlap += MIN(hfw[b]/nk,hbw[nbins-1-b]/nl);
+    }
+    double accfw = nk > 0.0 ? sumacc[k*gridsize + k+1]/nk : 0.0;
+    double accbw = nl > 0.0 ? sumacc[(k+1)*gridsize + k]/nl : 0.0;
+    for (int i = 0; i < 2; i++)
+      if (unit[i])
+        fprintf(unit[i],"  %d-%d: %g %g %g%s\n",k,k+1,overlap,accfw,accbw,
+                nk > 0.0 && nl > 0.0 ? "" : " (not sampled)");
+  }
+
+  if (histfp) {
+    double width = 2.0*dumax/nbins;
+    fprintf(histfp,"# Step " BIGINT_FORMAT "\n",update->ntimestep);
+    fprintf(histfp,"# node target beta*dU probability\n");
+    for (int k = 0; k < gridsize; k++) {
+      if (nvisit[k] == 0.0) continue;
+      for (int m = 0; m < gridsize; m++) {
+        if (m == k) continue;
+        double *h = hist + (k*gridsize + m)*nbins;
+        for (int b = 0; b < nbins; b++)
+          fprintf(histfp,"%d %d %g %g\n",k,m,-dumax + (b + 0.5)*width,
+                  h[b]/nvisit[k]);
+      }
+    }
+    fprintf(histfp,"\n");
+    fflush(histfp);
+  }
+}
+
 /* ----------------------------------------------------------------------
    Perform lambda node changing
 ------------------------------------------------------------------------- */
@@ -403,6 +831,8 @@ void FixSoftcoreEE::change_node(int node)
     pair[i]->lambda = pair[i]->lambdanode[node];
     pair[i]->reinit();
   }
+  for (int i = 0; i < nrestraints; i++)
+    restraint[i]->change_node(node);
   if (downhill)
     downhill = current_node != 0;
   else
@@ -420,7 +850,6 @@ int FixSoftcoreEE::number_of_atoms()
     n += atom->nghost;
   if (n > nmax) {
     nmax = n;
-    memory->grow(f_soft,nmax,3,"fix_softcore_ee::f_soft");
     memory->grow(f,nmax,3,"fix_softcore_ee::f");
     memory->grow(eatom,nmax,"fix_softcore_ee::eatom");
     memory->grow(vatom,nmax,6,"fix_softcore_ee::vatom");
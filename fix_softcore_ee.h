@@ -32,14 +32,19 @@ class FixSoftcoreEE : public Fix {
   ~FixSoftcoreEE();
   int setmask();
   void init();
+  int modify_param(int, char **);
   void initial_integrate(int);
+  void pre_force(int);
   void pre_reverse(int,int);
   double compute_vector(int);
+  void write_state(FILE *);
 
  private:
   int current_node;
   int new_node;
   int must_change_node;
+  int started;          // 1 after the first run has been initialized
+  int resetflag;        // 1 if the walk must restart at the next run
   int seed;
   double minus_beta;
 
@@ -51,13 +56,36 @@ class FixSoftcoreEE : public Fix {
   void change_node(int);
   int select_node(double*);
   int number_of_atoms();
+  void read_state(char *);
+
+  // streaming histograms of beta*(U[m] - U[k]) sampled at node k:
+  int nbins;
+  double dumax;
+  int nreport;
+  FILE *histfp;
+  double *hist;
+  double *nvisit;
+  double *sumacc;
+  void accumulate(double*);
+  void report();
+
+  // warm-start of weights by exponential averaging, node after node:
+  int nwarmup;
+  int warmup;
+  int nwarm;
+  double lnsum;
+  int warm_start(double*);
+  void print_weights();
 
   int npairs;
+  int standalone;       // 1 if the softcore style is not a hybrid sub-style
   int *compute_flag;
   class PairSoftcore **pair;
 
+  int nrestraints;      // lambda-coupled restraints on the same grid
+  class FixSoftcoreRestraint **restraint;
+
   int nmax;
-  double **f_soft;
 
   int eflag;
   int vflag;
@@ -80,6 +108,42 @@ Self-explanatory.  Check the input script syntax and compare to the
 documentation for the command.  You can use -echo screen as a
 command-line option when running LAMMPS to see the offending line.
 
+E: Fix softcore/ee report interval must be a multiple of nevery
+
+Self-explanatory.
+
+E: Fix softcore/ee warmup must be a multiple of nevery
+
+Self-explanatory.
+
+E: Fix softcore/ee: warmup cannot be used with explicit weights
+
+The warm-start computes the weights, which therefore must not be
+specified.
+
+E: Cannot open fix softcore/ee histogram file %s
+
+The specified file cannot be opened.  Check that the path and name are
+correct.
+
+E: Fix softcore/ee: restraint and lambda grids have different numbers of nodes
+
+Every fix softcore/restraint must have as many nodes as the softcore
+pair styles.
+
+E: Cannot open fix softcore/ee state file %s
+
+The specified file cannot be opened.  Check that the path and name are
+correct.
+
+E: Invalid fix softcore/ee state file
+
+The file was not written by fix softcore/checkpoint or is truncated.
+
+W: Fix softcore/ee state file histograms do not match the histogram keyword
+
+The walk continues with empty histograms.
+
 E: Variable name for fix adapt does not exist
 
 Self-explanatory.
@@ -0,0 +1,641 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------------
+   Contributing author: Charlles Abreu (abreu@eq.ufrj.br)
+                        Applied Thermodynamics & Molecular Simulation (ATOMS)
+                        Federal University of Rio de Janeiro / Brazil
+------------------------------------------------------------------------- */
+
+#include "mpi.h"
+#include "math.h"
+#include "stdio.h"
+#include "string.h"
+#include "fix_softcore_gcmc.h"
+#include "fix_rigid_small.h"
+#include "pair_hybrid_softcore.h"
+#include "atom.h"
+#include "atom_vec.h"
+#include "molecule.h"
+#include "comm.h"
+#include "domain.h"
+#include "force.h"
+#include "group.h"
+#include "modify.h"
+#include "neighbor.h"
+#include "update.h"
+#include "random_park.h"
+#include "math_extra.h"
+#include "math_const.h"
+#include "memory.h"
+#include "error.h"
+
+using namespace LAMMPS_NS;
+using namespace FixConst;
+using namespace MathConst;
+
+/* ----------------------------------------------------------------------
+   fix ID group-ID softcore/gcmc N M T mu seed mol template-ID
+       rigid fix-ID [weights w1 ... wG]
+   Every N steps, M Monte Carlo moves of a single fractional molecule of
+   template-ID are attempted. The fractional molecule is the one in the
+   decoupling group of the softcore pair styles and walks through their
+   lambda grid as in an expanded ensemble. Above the last node (lambda =
+   1), it becomes whole and a new fractional molecule is inserted at a
+   random position at the first node (lambda = 0). Below the first node,
+   it is deleted and a randomly chosen whole molecule becomes fractional
+   at the last node. Inserted molecules join group-ID, which must contain
+   all molecules of the species, and become rigid bodies of fix-ID.
+   The species must be neutral and interact only through lambda-linked
+   softcore styles, without kspace, so that exchanges at lambda = 0 and 1
+   do not change the energy.
+------------------------------------------------------------------------- */
+
+FixSoftcoreGCMC::FixSoftcoreGCMC(LAMMPS *lmp, int narg, char **arg) :
+  Fix(lmp, narg, arg)
+{
+  if (narg < 12) error->all(FLERR,"Illegal fix softcore/gcmc command");
+
+  nevery = force->inumeric(FLERR,arg[3]);
+  ncycles = force->inumeric(FLERR,arg[4]);
+  double temperature = force->numeric(FLERR,arg[5]);
+  double mu = force->numeric(FLERR,arg[6]);
+  seed = force->inumeric(FLERR,arg[7]);
+  if (nevery <= 0 || ncycles <= 0 || temperature <= 0.0 || seed <= 0)
+    error->all(FLERR,"Illegal fix softcore/gcmc command");
+  kT = force->boltz*temperature;
+
+  onemol = NULL;
+  idrigid = NULL;
+  weight = NULL;
+  gridsize = 0;
+  int iarg = 8;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"mol") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix softcore/gcmc command");
+      int index = atom->find_molecule(arg[iarg+1]);
+      if (index == -1)
+        error->all(FLERR,"Molecule template ID for fix softcore/gcmc does not exist");
+      onemol = atom->molecules[index];
+      iarg += 2;
+    }
+    else if (strcmp(arg[iarg],"rigid") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix softcore/gcmc command");
+      delete [] idrigid;
+      int n = strlen(arg[iarg+1]) + 1;
+      idrigid = new char[n];
+      strcpy(idrigid,arg[iarg+1]);
+      iarg += 2;
+    }
+    else if (strcmp(arg[iarg],"weights") == 0) {
+      gridsize = narg - iarg - 1;
+      if (gridsize < 2) error->all(FLERR,"Illegal fix softcore/gcmc command");
+      memory->create(weight,gridsize,"fix_softcore_gcmc:weight");
+      for (int i = 0; i < gridsize; i++)
+        weight[i] = force->numeric(FLERR,arg[iarg+1+i]);
+      iarg = narg;
+    }
+    else error->all(FLERR,"Illegal fix softcore/gcmc command");
+  }
+  if (!onemol || !idrigid)
+    error->all(FLERR,"Illegal fix softcore/gcmc command");
+
+  if (!atom->molecule_flag || !atom->tag_enable)
+    error->all(FLERR,"Fix softcore/gcmc requires atom attributes molecule and atom IDs");
+  if (atom->molecular == 2)
+    error->all(FLERR,"Fix softcore/gcmc does not support template-based molecular systems");
+
+  // activity and velocity spread from the thermal de Broglie wavelength
+
+  onemol->compute_center();
+  onemol->compute_mass();
+  double mass = onemol->masstotal;
+  double debroglie = sqrt(force->hplanck*force->hplanck/
+                          (2.0*MY_PI*mass*force->mvv2e*kT));
+  zz = exp(mu/kT)/(debroglie*debroglie*debroglie);
+  sigma = sqrt(kT/mass/force->mvv2e);
+
+  // same seed on all procs, so that all decisions are made in unison
+
+  random_equal = new RanPark(lmp,seed);
+
+  vector_flag = 1;
+  size_vector = 8;
+  global_freq = 1;
+  extvector = 0;
+  restart_global = 1;
+
+  force_reneighbor = 1;
+  next_reneighbor = update->ntimestep + 1;
+
+  pair = NULL;
+  energy = NULL;
+  node = -1;
+  fracmol = 0;
+  nwhole = 0;
+  nlambda[0] = nlambda[1] = 0.0;
+  ninsert[0] = ninsert[1] = ndelete[0] = ndelete[1] = 0.0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+FixSoftcoreGCMC::~FixSoftcoreGCMC()
+{
+  delete random_equal;
+  delete [] idrigid;
+  delete [] pair;
+  memory->destroy(weight);
+  memory->destroy(energy);
+}
+
+/* ---------------------------------------------------------------------- */
+
+int FixSoftcoreGCMC::setmask()
+{
+  int mask = 0;
+  mask |= PRE_EXCHANGE;
+  return mask;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixSoftcoreGCMC::init()
+{
+  // Retrieve all lambda-related pair styles:
+  delete [] pair;
+  PairHybridSoftcore *hybrid = dynamic_cast<PairHybridSoftcore*>(force->pair);
+  if (hybrid) {
+    pair = new class PairSoftcore*[hybrid->nstyles];
+    npairs = 0;
+    for (int i = 0; i < hybrid->nstyles; i++)
+      if ((pair[npairs] = dynamic_cast<class PairSoftcore*>(hybrid->styles[i])))
+        npairs++;
+  }
+  else {
+    pair = new class PairSoftcore*[1];
+    pair[0] = dynamic_cast<class PairSoftcore*>(force->pair);
+    npairs = pair[0] ? 1 : 0;
+  }
+  if (npairs == 0)
+    error->all(FLERR,"Fix softcore/gcmc requires a softcore-type pair style");
+
+  // The fractional molecule is the decoupling group of all pair styles:
+  for (int i = 0; i < npairs; i++)
+    if (pair[i]->decouple != PairSoftcore::GROUP ||
+        strcmp(pair[i]->decouple_id,pair[0]->decouple_id) != 0)
+      error->all(FLERR,"Fix softcore/gcmc requires pair softcore decouple group");
+  int igroup = group->find(pair[0]->decouple_id);
+  if (igroup == -1)
+    error->all(FLERR,"Fix softcore/gcmc requires pair softcore decouple group");
+  fracbit = group->bitmask[igroup];
+
+  // All pair styles share a grid that goes from lambda = 0 to lambda = 1:
+  int nodes = pair[0]->gridsize;
+  for (int i = 1; i < npairs; i++)
+    if (pair[i]->gridsize != nodes)
+      error->all(FLERR,"Fix softcore/gcmc: pair styles have different numbers of nodes");
+  if (nodes < 2 || pair[0]->lambdanode[0] != 0.0 ||
+      pair[0]->lambdanode[nodes-1] != 1.0)
+    error->all(FLERR,"Fix softcore/gcmc: lambda grid must start at 0 and end at 1");
+  for (int i = 0; i < npairs; i++)
+    if (pair[i]->exponent_n <= 0.0)
+      error->all(FLERR,"Fix softcore/gcmc requires pair softcore exponent n > 0");
+
+  // The acceptance rules assume that the fractional molecule does not
+  // interact at lambda = 0, so no other interaction may involve it:
+  if (force->kspace)
+    error->all(FLERR,"Fix softcore/gcmc does not support kspace");
+  for (int i = 0; i < npairs; i++)
+    if (pair[i]->tail_flag)
+      error->all(FLERR,"Fix softcore/gcmc does not support tail corrections");
+  if (atom->q_flag && onemol->qflag)
+    for (int m = 0; m < onemol->natoms; m++)
+      if (onemol->q[m] != 0.0)
+        error->all(FLERR,"Fix softcore/gcmc does not support charged molecules");
+  int ntypes = atom->ntypes;
+  for (int m = 0; m < onemol->natoms; m++) {
+    int itype = onemol->type[m];
+    for (int jtype = 1; jtype <= ntypes; jtype++) {
+      int linked = 1;
+      if (hybrid) {
+        for (int k = 0; k < hybrid->nmap[itype][jtype]; k++) {
+          PairSoftcore *style = dynamic_cast<PairSoftcore*>
+            (hybrid->styles[hybrid->map[itype][jtype][k]]);
+          if (!style || (style->unlinked && !style->linkflag[itype][jtype]))
+            linked = 0;
+        }
+      }
+      else if (pair[0]->unlinked && !pair[0]->linkflag[itype][jtype])
+        linked = 0;
+      if (!linked)
+        error->all(FLERR,"Fix softcore/gcmc molecule types must interact "
+                   "only through lambda-linked softcore styles");
+    }
+  }
+
+  if (!weight) {
+    gridsize = nodes;
+    memory->create(weight,gridsize,"fix_softcore_gcmc:weight");
+    for (int i = 0; i < gridsize; i++)
+      weight[i] = 0.0;
+  }
+  else if (gridsize != nodes)
+    error->all(FLERR,"Fix softcore/gcmc: numbers of weights and lambda nodes are different");
+  memory->destroy(energy);
+  memory->create(energy,gridsize,"fix_softcore_gcmc:energy");
+
+  // Inserted molecules become rigid bodies of fix rigid/small:
+  int ifix = modify->find_fix(idrigid);
+  if (ifix < 0)
+    error->all(FLERR,"Fix rigid/small ID for fix softcore/gcmc does not exist");
+  fixrigid = dynamic_cast<FixRigidSmall*>(modify->fix[ifix]);
+  if (!fixrigid)
+    error->all(FLERR,"Fix softcore/gcmc molecule template is not used by fix rigid/small");
+  for (imol = 0; imol < fixrigid->nmol; imol++)
+    if (fixrigid->onemols[imol] == onemol) break;
+  if (imol == fixrigid->nmol)
+    error->all(FLERR,"Fix softcore/gcmc molecule template is not used by fix rigid/small");
+
+  // Identify the fractional molecule, if any, and start it at the last
+  // node, unless its node was restored from a restart file:
+  int *mask = atom->mask;
+  tagint *molecule = atom->molecule;
+  tagint mine = 0;
+  for (int i = 0; i < atom->nlocal; i++)
+    if (mask[i] & fracbit) mine = MAX(mine,molecule[i]);
+  MPI_Allreduce(&mine,&fracmol,1,MPI_LMP_TAGINT,MPI_MAX,world);
+  if (fracmol == 0) node = -1;
+  else if (node < 0) node = gridsize - 1;
+  if (node >= 0) change_node(node);
+}
+
+/* ----------------------------------------------------------------------
+   Monte Carlo moves of the fractional molecule. Lambda moves reuse the
+   grid energies until the configuration changes by an exchange.
+------------------------------------------------------------------------- */
+
+void FixSoftcoreGCMC::pre_exchange()
+{
+  if (next_reneighbor != update->ntimestep) return;
+
+  rebuild();
+  count_whole();
+
+  // without a fractional molecule, insert one unconditionally:
+  if (node < 0) {
+    insert_fractional();
+    change_node(0);
+    rebuild();
+  }
+
+  int valid = 0;
+  for (int m = 0; m < ncycles; m++) {
+    int up = random_equal->uniform() < 0.5;
+    if (up && node == gridsize-1) {
+      if (attempt_insertion()) valid = 0;
+    }
+    else if (!up && node == 0) {
+      if (attempt_deletion()) valid = 0;
+    }
+    else {
+      if (!valid) grid_energy();
+      valid = 1;
+      attempt_lambda(up ? node+1 : node-1);
+    }
+  }
+
+  next_reneighbor = update->ntimestep + nevery;
+}
+
+/* ----------------------------------------------------------------------
+   Move the fractional molecule to a neighbor node of the lambda grid
+------------------------------------------------------------------------- */
+
+int FixSoftcoreGCMC::attempt_lambda(int newnode)
+{
+  nlambda[0] += 1.0;
+  double arg = -(energy[newnode] - energy[node])/kT +
+    weight[newnode] - weight[node];
+  if (arg < 0.0 && random_equal->uniform() >= exp(arg)) return 0;
+  change_node(newnode);
+  nlambda[1] += 1.0;
+  return 1;
+}
+
+/* ----------------------------------------------------------------------
+   Make the fractional molecule whole and insert a new one at lambda = 0.
+   At the end nodes, the energy does not change, so only the ideal and
+   weight terms enter the acceptance.
+------------------------------------------------------------------------- */
+
+int FixSoftcoreGCMC::attempt_insertion()
+{
+  ninsert[0] += 1.0;
+  double volume = domain->xprd*domain->yprd*domain->zprd;
+  double prob = zz*volume/(nwhole + 1)*exp(weight[0] - weight[gridsize-1]);
+  if (random_equal->uniform() >= prob) return 0;
+
+  set_fractional(fracmol,0);
+  nwhole++;
+  insert_fractional();
+  change_node(0);
+  rebuild();
+  ninsert[1] += 1.0;
+  return 1;
+}
+
+/* ----------------------------------------------------------------------
+   Delete the fractional molecule at lambda = 0 and make a whole molecule
+   fractional at lambda = 1
+------------------------------------------------------------------------- */
+
+int FixSoftcoreGCMC::attempt_deletion()
+{
+  if (nwhole == 0) return 0;
+  ndelete[0] += 1.0;
+  double volume = domain->xprd*domain->yprd*domain->zprd;
+  double prob = nwhole/(zz*volume)*exp(weight[gridsize-1] - weight[0]);
+  if (random_equal->uniform() >= prob) return 0;
+
+  delete_fractional();
+  fracmol = pick_whole();
+  set_fractional(fracmol,1);
+  nwhole--;
+  change_node(gridsize-1);
+  rebuild();
+  ndelete[1] += 1.0;
+  return 1;
+}
+
+/* ----------------------------------------------------------------------
+   Create a new molecule with random position, orientation and velocity,
+   add it to this group, to the rigid fix and to the fractional group
+------------------------------------------------------------------------- */
+
+void FixSoftcoreGCMC::insert_fractional()
+{
+  double xgeom[3],lamda[3],coord[3],vcm[3],quat[4],rotmat[3][3];
+
+  if (domain->triclinic) {
+    for (int k = 0; k < 3; k++) lamda[k] = random_equal->uniform();
+    domain->lamda2x(lamda,xgeom);
+  }
+  else
+    for (int k = 0; k < 3; k++)
+      xgeom[k] = domain->boxlo[k] + random_equal->uniform()*domain->prd[k];
+
+  // uniform random rotation (Shoemake's method)
+  double u1 = random_equal->uniform();
+  double u2 = MY_2PI*random_equal->uniform();
+  double u3 = MY_2PI*random_equal->uniform();
+  quat[0] = sqrt(1.0-u1)*sin(u2);
+  quat[1] = sqrt(1.0-u1)*cos(u2);
+  quat[2] = sqrt(u1)*sin(u3);
+  quat[3] = sqrt(u1)*cos(u3);
+  MathExtra::quat_to_mat(quat,rotmat);
+
+  for (int k = 0; k < 3; k++) vcm[k] = sigma*random_equal->gaussian();
+
+  tagint maxtag = 0;
+  tagint maxmol = 0;
+  for (int i = 0; i < atom->nlocal; i++) {
+    maxtag = MAX(maxtag,atom->tag[i]);
+    maxmol = MAX(maxmol,atom->molecule[i]);
+  }
+  tagint maxtag_all,maxmol_all;
+  MPI_Allreduce(&maxtag,&maxtag_all,1,MPI_LMP_TAGINT,MPI_MAX,world);
+  MPI_Allreduce(&maxmol,&maxmol_all,1,MPI_LMP_TAGINT,MPI_MAX,world);
+
+  double *sublo = domain->triclinic ? domain->sublo_lamda : domain->sublo;
+  double *subhi = domain->triclinic ? domain->subhi_lamda : domain->subhi;
+
+  int nlocalprev = atom->nlocal;
+  for (int m = 0; m < onemol->natoms; m++) {
+    MathExtra::matvec(rotmat,onemol->dx[m],coord);
+    MathExtra::add3(coord,xgeom,coord);
+    imageint image = ((imageint) IMGMAX << IMG2BITS) |
+      ((imageint) IMGMAX << IMGBITS) | IMGMAX;
+    domain->remap(coord,image);
+
+    double *s = coord;
+    if (domain->triclinic) {
+      domain->x2lamda(coord,lamda);
+      s = lamda;
+    }
+    if (s[0] < sublo[0] || s[0] >= subhi[0] ||
+        s[1] < sublo[1] || s[1] >= subhi[1] ||
+        s[2] < sublo[2] || s[2] >= subhi[2]) continue;
+
+    atom->avec->create_atom(onemol->type[m],coord);
+    int n = atom->nlocal - 1;
+    atom->tag[n] = maxtag_all + m + 1;
+    atom->molecule[n] = maxmol_all + 1;
+    atom->mask[n] = 1 | groupbit | fracbit | fixrigid->groupbit;
+    atom->image[n] = image;
+    atom->v[n][0] = vcm[0];
+    atom->v[n][1] = vcm[1];
+    atom->v[n][2] = vcm[2];
+    if (onemol->qflag && atom->q_flag) atom->q[n] = onemol->q[m];
+    modify->create_attribute(n);
+  }
+
+  fixrigid->set_molecule(nlocalprev,maxtag_all,imol,xgeom,vcm,quat);
+  fracmol = maxmol_all + 1;
+
+  atom->natoms += onemol->natoms;
+  if (atom->map_style) {
+    atom->nghost = 0;
+    atom->map_init();
+    atom->map_set();
+  }
+}
+
+/* ----------------------------------------------------------------------
+   Delete all atoms of the fractional molecule and its rigid body
+------------------------------------------------------------------------- */
+
+void FixSoftcoreGCMC::delete_fractional()
+{
+  int i = 0;
+  while (i < atom->nlocal)
+    if (atom->molecule[i] == fracmol) {
+      atom->avec->copy(atom->nlocal-1,i,1);
+      atom->nlocal--;
+    }
+    else i++;
+
+  fixrigid->nbody--;
+  atom->natoms -= onemol->natoms;
+  if (atom->map_style) {
+    atom->nghost = 0;
+    atom->map_init();
+    atom->map_set();
+  }
+  fracmol = 0;
+}
+
+/* ----------------------------------------------------------------------
+   Add (flag = 1) or remove (flag = 0) molecule molid from the fractional
+   group
+------------------------------------------------------------------------- */
+
+void FixSoftcoreGCMC::set_fractional(tagint molid, int flag)
+{
+  int *mask = atom->mask;
+  tagint *molecule = atom->molecule;
+  for (int i = 0; i < atom->nlocal; i++)
+    if (molecule[i] == molid) {
+      if (flag) mask[i] |= fracbit;
+      else mask[i] &= ~fracbit;
+    }
+}
+
+/* ----------------------------------------------------------------------
+   Molecule ID of a whole molecule of this group chosen at random
+------------------------------------------------------------------------- */
+
+tagint FixSoftcoreGCMC::pick_whole()
+{
+  int *mask = atom->mask;
+  int nlocal = atom->nlocal;
+
+  int nmine = 0;
+  for (int i = 0; i < nlocal; i++)
+    if ((mask[i] & groupbit) && !(mask[i] & fracbit)) nmine++;
+  int first,total;
+  MPI_Scan(&nmine,&first,1,MPI_INT,MPI_SUM,world);
+  MPI_Allreduce(&nmine,&total,1,MPI_INT,MPI_SUM,world);
+  first -= nmine;
+
+  int ipick = static_cast<int>(total*random_equal->uniform());
+  tagint mine = 0;
+  if (ipick >= first && ipick < first + nmine) {
+    int k = first;
+    for (int i = 0; i < nlocal; i++)
+      if ((mask[i] & groupbit) && !(mask[i] & fracbit) && k++ == ipick) {
+        mine = atom->molecule[i];
+        break;
+      }
+  }
+  tagint molid;
+  MPI_Allreduce(&mine,&molid,1,MPI_LMP_TAGINT,MPI_MAX,world);
+  return molid;
+}
+
+/* ----------------------------------------------------------------------
+   Count the whole molecules of this group
+------------------------------------------------------------------------- */
+
+void FixSoftcoreGCMC::count_whole()
+{
+  int *mask = atom->mask;
+  bigint nmine = 0;
+  for (int i = 0; i < atom->nlocal; i++)
+    if ((mask[i] & groupbit) && !(mask[i] & fracbit)) nmine++;
+  bigint total;
+  MPI_Allreduce(&nmine,&total,1,MPI_LMP_BIGINT,MPI_SUM,world);
+  nwhole = total/onemol->natoms;
+}
+
+/* ----------------------------------------------------------------------
+   Move the fractional molecule to a node of the lambda grid
+------------------------------------------------------------------------- */
+
+void FixSoftcoreGCMC::change_node(int newnode)
+{
+  node = newnode;
+  for (int i = 0; i < npairs; i++) {
+    pair[i]->lambda = pair[i]->lambdanode[node];
+    pair[i]->reinit();
+  }
+}
+
+/* ----------------------------------------------------------------------
+   Total softcore energy at every node of the lambda grid, on all procs
+------------------------------------------------------------------------- */
+
+void FixSoftcoreGCMC::grid_energy()
+{
+  double local[gridsize];
+  for (int k = 0; k < gridsize; k++)
+    local[k] = 0.0;
+  for (int i = 0; i < npairs; i++)
+    pair[i]->compute_softcore(pair[0]->scratch_forces(),local,NULL,0,0);
+  MPI_Allreduce(local,energy,gridsize,MPI_DOUBLE,MPI_SUM,world);
+}
+
+/* ----------------------------------------------------------------------
+   Bring atoms, ghosts, rigid bodies and neighbor lists up to date after
+   atoms have been created, deleted, or changed groups
+------------------------------------------------------------------------- */
+
+void FixSoftcoreGCMC::rebuild()
+{
+  if (domain->triclinic) domain->x2lamda(atom->nlocal);
+  domain->pbc();
+  comm->exchange();
+  atom->nghost = 0;
+  comm->borders();
+  if (domain->triclinic) domain->lamda2x(atom->nlocal+atom->nghost);
+  if (modify->n_pre_neighbor) modify->pre_neighbor();
+  neighbor->build();
+}
+
+/* ----------------------------------------------------------------------
+   0 = current node (-1 if none), 1 = # of whole molecules,
+   2-7 = attempted and accepted lambda moves, insertions and deletions
+------------------------------------------------------------------------- */
+
+double FixSoftcoreGCMC::compute_vector(int i)
+{
+  if (i == 0) return node;
+  if (i == 1) return nwhole;
+  if (i == 2) return nlambda[0];
+  if (i == 3) return nlambda[1];
+  if (i == 4) return ninsert[0];
+  if (i == 5) return ninsert[1];
+  if (i == 6) return ndelete[0];
+  return ndelete[1];
+}
+
+/* ----------------------------------------------------------------------
+   pack node of the fractional molecule and random state into restart file
+------------------------------------------------------------------------- */
+
+void FixSoftcoreGCMC::write_restart(FILE *fp)
+{
+  int n = 0;
+  double list[3];
+  list[n++] = node;
+  list[n++] = random_equal->state();
+  list[n++] = next_reneighbor;
+
+  if (comm->me == 0) {
+    int size = n * sizeof(double);
+    fwrite(&size,sizeof(int),1,fp);
+    fwrite(list,sizeof(double),n,fp);
+  }
+}
+
+/* ----------------------------------------------------------------------
+   use state info from restart file to restart the fix
+------------------------------------------------------------------------- */
+
+void FixSoftcoreGCMC::restart(char *buf)
+{
+  double *list = (double *) buf;
+  node = static_cast<int> (list[0]);
+  seed = static_cast<int> (list[1]);
+  random_equal->reset(seed);
+  next_reneighbor = static_cast<bigint> (list[2]);
+}
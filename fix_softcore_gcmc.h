@@ -0,0 +1,164 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifdef FIX_CLASS
+
+FixStyle(softcore/gcmc,FixSoftcoreGCMC)
+
+#else
+
+#ifndef LMP_FIX_SOFTCORE_GCMC_H
+#define LMP_FIX_SOFTCORE_GCMC_H
+
+#include "fix.h"
+#include "pair_softcore.h"
+
+namespace LAMMPS_NS {
+
+class FixSoftcoreGCMC : public Fix {
+ public:
+  FixSoftcoreGCMC(class LAMMPS *, int, char **);
+  ~FixSoftcoreGCMC();
+  int setmask();
+  void init();
+  void pre_exchange();
+  double compute_vector(int);
+  void write_restart(FILE *);
+  void restart(char *);
+
+ private:
+  int ncycles;          // MC moves per invocation
+  double kT;            // thermal energy
+  double zz;            // activity: exp(mu/kT)/Lambda^3
+  double sigma;         // std deviation of COM velocity components
+  int seed;
+  class RanPark *random_equal;
+
+  char *idrigid;
+  class FixRigidSmall *fixrigid;
+  class Molecule *onemol;
+  int imol;             // index of the template in fix rigid/small
+
+  int npairs;
+  class PairSoftcore **pair;
+
+  int gridsize;
+  double *weight;       // expanded ensemble weights of all nodes
+  double *energy;       // coupling energy of the fractional molecule
+  int node;             // current node of the fractional molecule (-1 = none)
+  int fracbit;          // groupbit of the decoupling group of the pairs
+  tagint fracmol;       // molecule ID of the fractional molecule (0 = none)
+  int nwhole;           // # of whole molecules of the species
+
+  double nlambda[2];    // attempted and accepted lambda moves
+  double ninsert[2];    // attempted and accepted insertions
+  double ndelete[2];    // attempted and accepted deletions
+
+  void change_node(int);
+  void grid_energy();
+  int attempt_lambda(int);
+  int attempt_insertion();
+  int attempt_deletion();
+  void insert_fractional();
+  void delete_fractional();
+  void set_fractional(tagint, int);
+  tagint pick_whole();
+  void count_whole();
+  void rebuild();
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Molecule template ID for fix softcore/gcmc does not exist
+
+Self-explanatory.
+
+E: Fix softcore/gcmc requires atom attributes molecule and atom IDs
+
+Molecules are inserted and deleted as a whole and identified by their
+molecule IDs.
+
+E: Fix softcore/gcmc does not support template-based molecular systems
+
+Inserted molecules are not registered in the molecule template of the
+atom style.
+
+E: Fix softcore/gcmc requires a softcore-type pair style
+
+No pair style derived from PairSoftcore is defined.
+
+E: Fix softcore/gcmc requires pair softcore decouple group
+
+The fractional molecule is identified by the decoupling group of the
+softcore pair styles, which must be the same for all of them.
+
+E: Fix softcore/gcmc: pair styles have different numbers of nodes
+
+All softcore sub-styles must share the same lambda grid.
+
+E: Fix softcore/gcmc: lambda grid must start at 0 and end at 1
+
+The fractional molecule is exchanged with a whole molecule at lambda = 1
+and inserted or deleted at lambda = 0.
+
+E: Fix softcore/gcmc requires pair softcore exponent n > 0
+
+The fractional molecule must not interact at lambda = 0.
+
+E: Fix softcore/gcmc does not support kspace
+
+Long-range Coulomb energies of the fractional molecule do not vanish at
+lambda = 0 and are not included in the acceptance rules.
+
+E: Fix softcore/gcmc does not support charged molecules
+
+The Coulomb energy of inserted and deleted molecules is not included in
+the acceptance rules.
+
+E: Fix softcore/gcmc does not support tail corrections
+
+Tail corrections scale all pairs of the molecule types with lambda,
+including those kept at full strength, and use atom counts that change
+with each insertion or deletion.  Use pair_modify tail no.
+
+E: Fix softcore/gcmc molecule types must interact only through lambda-linked softcore styles
+
+Interactions of other sub-styles or of pairs of types unlinked from
+lambda do not vanish at lambda = 0 and are not included in the
+acceptance rules.
+
+E: Fix softcore/gcmc: numbers of weights and lambda nodes are different
+
+Self-explanatory.
+
+E: Fix rigid/small ID for fix softcore/gcmc does not exist
+
+Self-explanatory.
+
+E: Fix softcore/gcmc molecule template is not used by fix rigid/small
+
+The rigid/small fix must be defined with the same template via its mol
+keyword, so that inserted molecules become rigid bodies.
+
+*/
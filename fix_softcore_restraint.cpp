@@ -0,0 +1,404 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------------
+   Contributing author: Charlles Abreu (abreu@eq.ufrj.br)
+                        Applied Thermodynamics & Molecular Simulation (ATOMS)
+                        Federal University of Rio de Janeiro / Brazil
+------------------------------------------------------------------------- */
+
+#include "mpi.h"
+#include "math.h"
+#include "stdio.h"
+#include "string.h"
+#include "fix_softcore_restraint.h"
+#include "pair_hybrid_softcore.h"
+#include "atom.h"
+#include "comm.h"
+#include "domain.h"
+#include "force.h"
+#include "math_const.h"
+#include "memory.h"
+#include "error.h"
+
+using namespace LAMMPS_NS;
+using namespace FixConst;
+using namespace MathConst;
+
+#define SMALL 0.001
+
+/* ----------------------------------------------------------------------
+   fix ID group softcore/restraint keyword args ... [nodes l1 ... lG]
+     bond i j K r0              = K*(r - r0)^2
+     angle i j k K theta0       = K*(theta - theta0)^2, vertex j
+     dihedral i j k l K phi0    = K*(phi - phi0)^2, phi in (-180,180]
+
+   Harmonic restraints on atoms given by their IDs (e.g. the distance,
+   two angles, and three dihedrals of a Boresch restraint), scaled by a
+   coupling parameter: U = lambda*sum(terms). By default, lambda is that
+   of the softcore pair styles and so are its values at the nodes of the
+   lambda grid. With the nodes keyword (which must be the last one), the
+   restraints have their own coupling at each node of the same grid, so
+   that they can be switched on along lambda while the softcore styles
+   decouple a solute, in the same expanded ensemble. Node energies are
+   consumed by fix softcore/ee and compute softcore/grid.
+   The restraint forces contribute to the virial (see fix_modify virial).
+------------------------------------------------------------------------- */
+
+FixSoftcoreRestraint::FixSoftcoreRestraint(LAMMPS *lmp, int narg, char **arg) :
+  Fix(lmp, narg, arg)
+{
+  if (narg < 4)
+    error->all(FLERR,"Illegal fix softcore/restraint command");
+
+  // count terms and nodes before storing them
+  nterms = 0;
+  gridsize = 0;
+  int iarg = 3;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"bond") == 0) iarg += 5;
+    else if (strcmp(arg[iarg],"angle") == 0) iarg += 6;
+    else if (strcmp(arg[iarg],"dihedral") == 0) iarg += 7;
+    else if (strcmp(arg[iarg],"nodes") == 0) {
+      gridsize = narg - iarg - 1;
+      if (gridsize < 1)
+        error->all(FLERR,"Illegal fix softcore/restraint command");
+      break;
+    }
+    else error->all(FLERR,"Illegal fix softcore/restraint command");
+    if (iarg > narg)
+      error->all(FLERR,"Illegal fix softcore/restraint command");
+    nterms++;
+  }
+  if (nterms == 0)
+    error->all(FLERR,"Illegal fix softcore/restraint command");
+
+  memory->create(kind,nterms,"softcore/restraint:kind");
+  memory->create(ids,nterms,4,"softcore/restraint:ids");
+  memory->create(kconst,nterms,"softcore/restraint:kconst");
+  memory->create(target,nterms,"softcore/restraint:target");
+  lambdanode = NULL;
+  if (gridsize)
+    memory->create(lambdanode,gridsize,"softcore/restraint:lambdanode");
+
+  iarg = 3;
+  for (int m = 0; m < nterms; m++) {
+    int natoms;
+    if (strcmp(arg[iarg],"bond") == 0) { kind[m] = BOND; natoms = 2; }
+    else if (strcmp(arg[iarg],"angle") == 0) { kind[m] = ANGLE; natoms = 3; }
+    else { kind[m] = DIHEDRAL; natoms = 4; }
+    for (int k = 0; k < 4; k++)
+      ids[m][k] = k < natoms ? force->tnumeric(FLERR,arg[iarg+1+k]) : 0;
+    kconst[m] = force->numeric(FLERR,arg[iarg+1+natoms]);
+    target[m] = force->numeric(FLERR,arg[iarg+2+natoms]);
+    if (kind[m] != BOND) target[m] *= MY_PI/180.0;
+    if (kind[m] == DIHEDRAL) target[m] -= MY_2PI*floor(target[m]/MY_2PI + 0.5);
+    iarg += 3 + natoms;
+  }
+  if (gridsize) {
+    for (int k = 0; k < gridsize; k++)
+      lambdanode[k] = force->numeric(FLERR,arg[iarg+1+k]);
+    lambda = lambdanode[0];
+  }
+
+  // Without own nodes, follow the lambda of the softcore pair styles:
+  pair = NULL;
+  if (!gridsize) {
+    PairHybridSoftcore *hybrid = dynamic_cast<PairHybridSoftcore*>(force->pair);
+    if (hybrid) {
+      for (int i = 0; i < hybrid->nstyles && !pair; i++)
+        pair = dynamic_cast<class PairSoftcore*>(hybrid->styles[i]);
+    }
+    else pair = dynamic_cast<class PairSoftcore*>(force->pair);
+    if (!pair)
+      error->all(FLERR,"Fix softcore/restraint requires a softcore-type pair style");
+  }
+
+  scalar_flag = 1;
+  vector_flag = 1;
+  size_vector = 1;
+  global_freq = 1;
+  extscalar = 1;
+  extvector = 1;
+  virial_flag = 1;
+  thermo_virial = 1;
+
+  force_flag = 0;
+  energy = energy_all = 0.0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+FixSoftcoreRestraint::~FixSoftcoreRestraint()
+{
+  memory->destroy(kind);
+  memory->destroy(ids);
+  memory->destroy(kconst);
+  memory->destroy(target);
+  memory->destroy(lambdanode);
+}
+
+/* ---------------------------------------------------------------------- */
+
+int FixSoftcoreRestraint::setmask()
+{
+  return POST_FORCE | MIN_POST_FORCE;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixSoftcoreRestraint::init()
+{
+  if (atom->map_style == 0)
+    error->all(FLERR,"Fix softcore/restraint requires an atom map, see atom_modify");
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixSoftcoreRestraint::setup(int vflag)
+{
+  post_force(vflag);
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixSoftcoreRestraint::min_setup(int vflag)
+{
+  post_force(vflag);
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixSoftcoreRestraint::post_force(int vflag)
+{
+  if (vflag) v_setup(vflag);
+  else evflag = 0;
+
+  energy = restrain(coupling());
+  force_flag = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixSoftcoreRestraint::min_post_force(int vflag)
+{
+  post_force(vflag);
+}
+
+/* ----------------------------------------------------------------------
+   Evaluate all terms at full strength and add their forces, multiplied
+   by scale, to the owned atoms. Every proc owning an atom of a term
+   evaluates the whole term from minimum-image displacements along the
+   chain of its atoms, but only the owner of the first atom counts its
+   energy, which is returned (local sum). If forces are added, each proc
+   also tallies the virial share of its owned atoms of every term.
+------------------------------------------------------------------------- */
+
+double FixSoftcoreRestraint::restrain(double scale)
+{
+  double **x = atom->x;
+  double **f = atom->f;
+  int nlocal = atom->nlocal;
+
+  int idx[4],list[4];
+  double r[4][3],g[4][3],v[6];
+  double local = 0.0;
+
+  for (int m = 0; m < nterms; m++) {
+    int natoms = kind[m] + 2;
+    int owned = 0;
+    for (int k = 0; k < natoms; k++) {
+      idx[k] = atom->map(ids[m][k]);
+      if (idx[k] >= 0 && idx[k] < nlocal) owned = 1;
+    }
+    if (!owned) continue;
+    for (int k = 0; k < natoms; k++)
+      if (idx[k] == -1) {
+        char str[128];
+        sprintf(str,"Fix softcore/restraint atoms "
+                TAGINT_FORMAT " " TAGINT_FORMAT " missing",
+                ids[m][0],ids[m][k]);
+        error->one(FLERR,str);
+      }
+
+    r[0][0] = x[idx[0]][0];
+    r[0][1] = x[idx[0]][1];
+    r[0][2] = x[idx[0]][2];
+    for (int k = 1; k < natoms; k++) {
+      double del[3];
+      del[0] = x[idx[k]][0] - x[idx[k-1]][0];
+      del[1] = x[idx[k]][1] - x[idx[k-1]][1];
+      del[2] = x[idx[k]][2] - x[idx[k-1]][2];
+      domain->minimum_image(del);
+      r[k][0] = r[k-1][0] + del[0];
+      r[k][1] = r[k-1][1] + del[1];
+      r[k][2] = r[k-1][2] + del[2];
+    }
+
+    // value of the restrained coordinate and its gradient:
+    double value;
+    if (kind[m] == BOND) {
+      double d[3];
+      for (int c = 0; c < 3; c++) d[c] = r[1][c] - r[0][c];
+      value = sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+      for (int c = 0; c < 3; c++) {
+        g[1][c] = d[c]/value;
+        g[0][c] = -g[1][c];
+      }
+    }
+    else if (kind[m] == ANGLE) {
+      double d1[3],d2[3];
+      for (int c = 0; c < 3; c++) {
+        d1[c] = r[0][c] - r[1][c];
+        d2[c] = r[2][c] - r[1][c];
+      }
+      double r1 = sqrt(d1[0]*d1[0] + d1[1]*d1[1] + d1[2]*d1[2]);
+      double r2 = sqrt(d2[0]*d2[0] + d2[1]*d2[1] + d2[2]*d2[2]);
+      double cs = (d1[0]*d2[0] + d1[1]*d2[1] + d1[2]*d2[2])/(r1*r2);
+      if (cs > 1.0) cs = 1.0;
+      if (cs < -1.0) cs = -1.0;
+      double sn = sqrt(1.0 - cs*cs);
+      if (sn < SMALL) sn = SMALL;
+      value = acos(cs);
+      for (int c = 0; c < 3; c++) {
+        g[0][c] = -(d2[c]/(r1*r2) - cs*d1[c]/(r1*r1))/sn;
+        g[2][c] = -(d1[c]/(r1*r2) - cs*d2[c]/(r2*r2))/sn;
+        g[1][c] = -g[0][c] - g[2][c];
+      }
+    }
+    else {
+      double vf[3],vg[3],vh[3],a[3],b[3];
+      for (int c = 0; c < 3; c++) {
+        vf[c] = r[0][c] - r[1][c];
+        vg[c] = r[1][c] - r[2][c];
+        vh[c] = r[3][c] - r[2][c];
+      }
+      a[0] = vf[1]*vg[2] - vf[2]*vg[1];
+      a[1] = vf[2]*vg[0] - vf[0]*vg[2];
+      a[2] = vf[0]*vg[1] - vf[1]*vg[0];
+      b[0] = vh[1]*vg[2] - vh[2]*vg[1];
+      b[1] = vh[2]*vg[0] - vh[0]*vg[2];
+      b[2] = vh[0]*vg[1] - vh[1]*vg[0];
+      double asq = a[0]*a[0] + a[1]*a[1] + a[2]*a[2];
+      double bsq = b[0]*b[0] + b[1]*b[1] + b[2]*b[2];
+      double rg = sqrt(vg[0]*vg[0] + vg[1]*vg[1] + vg[2]*vg[2]);
+      if (asq < SMALL*SMALL) asq = SMALL*SMALL;
+      if (bsq < SMALL*SMALL) bsq = SMALL*SMALL;
+      double fg = vf[0]*vg[0] + vf[1]*vg[1] + vf[2]*vg[2];
+      double hg = vh[0]*vg[0] + vh[1]*vg[1] + vh[2]*vg[2];
+      double sn = ((b[1]*a[2] - b[2]*a[1])*vg[0] +
+                   (b[2]*a[0] - b[0]*a[2])*vg[1] +
+                   (b[0]*a[1] - b[1]*a[0])*vg[2])/rg;
+      value = atan2(sn,a[0]*b[0] + a[1]*b[1] + a[2]*b[2]);
+      for (int c = 0; c < 3; c++) {
+        g[0][c] = -rg/asq*a[c];
+        g[3][c] = rg/bsq*b[c];
+        g[1][c] = (rg + fg/rg)/asq*a[c] - hg/(rg*bsq)*b[c];
+        g[2][c] = -g[0][c] - g[1][c] - g[3][c];
+      }
+    }
+
+    double dev = value - target[m];
+    if (kind[m] == DIHEDRAL) dev -= MY_2PI*floor(dev/MY_2PI + 0.5);
+    if (idx[0] < nlocal) local += kconst[m]*dev*dev;
+
+    if (scale != 0.0) {
+      double dedx = 2.0*scale*kconst[m]*dev;
+      for (int k = 0; k < natoms; k++)
+        if (idx[k] < nlocal) {
+          f[idx[k]][0] -= dedx*g[k][0];
+          f[idx[k]][1] -= dedx*g[k][1];
+          f[idx[k]][2] -= dedx*g[k][2];
+        }
+
+      // the forces of a term sum to zero, so its virial does not depend
+      // on the origin of the unwrapped chain:
+
+      if (evflag) {
+        int n = 0;
+        for (int c = 0; c < 6; c++) v[c] = 0.0;
+        for (int k = 0; k < natoms; k++) {
+          v[0] -= dedx*r[k][0]*g[k][0];
+          v[1] -= dedx*r[k][1]*g[k][1];
+          v[2] -= dedx*r[k][2]*g[k][2];
+          v[3] -= dedx*r[k][0]*g[k][1];
+          v[4] -= dedx*r[k][0]*g[k][2];
+          v[5] -= dedx*r[k][1]*g[k][2];
+          if (idx[k] < nlocal) list[n++] = idx[k];
+        }
+        v_tally(n,list,(double) natoms,v);
+      }
+    }
+  }
+  return local;
+}
+
+/* ---------------------------------------------------------------------- */
+
+double FixSoftcoreRestraint::coupling()
+{
+  return gridsize ? lambda : pair->lambda;
+}
+
+/* ---------------------------------------------------------------------- */
+
+int FixSoftcoreRestraint::grid_size()
+{
+  return gridsize ? gridsize : pair->gridsize;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixSoftcoreRestraint::change_node(int node)
+{
+  if (gridsize) lambda = lambdanode[node];
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixSoftcoreRestraint::node_energies(double *e)
+{
+  double local = restrain(0.0);
+  double full;
+  MPI_Reduce(&local,&full,1,MPI_DOUBLE,MPI_SUM,0,world);
+  if (comm->me) return;
+  double *node = gridsize ? lambdanode : pair->lambdanode;
+  for (int k = 0; k < grid_size(); k++)
+    e[k] += node[k]*full;
+}
+
+/* ----------------------------------------------------------------------
+   restraint energy at the current coupling
+------------------------------------------------------------------------- */
+
+double FixSoftcoreRestraint::compute_scalar()
+{
+  if (force_flag == 0) {
+    MPI_Allreduce(&energy,&energy_all,1,MPI_DOUBLE,MPI_SUM,world);
+    force_flag = 1;
+  }
+  return coupling()*energy_all;
+}
+
+/* ----------------------------------------------------------------------
+   derivative of the restraint energy with respect to the coupling
+------------------------------------------------------------------------- */
+
+double FixSoftcoreRestraint::compute_vector(int n)
+{
+  if (force_flag == 0) {
+    MPI_Allreduce(&energy,&energy_all,1,MPI_DOUBLE,MPI_SUM,world);
+    force_flag = 1;
+  }
+  return energy_all;
+}
@@ -0,0 +1,98 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifdef FIX_CLASS
+
+FixStyle(softcore/restraint,FixSoftcoreRestraint)
+
+#else
+
+#ifndef LMP_FIX_SOFTCORE_RESTRAINT_H
+#define LMP_FIX_SOFTCORE_RESTRAINT_H
+
+#include "fix.h"
+#include "pair_softcore.h"
+
+namespace LAMMPS_NS {
+
+class FixSoftcoreRestraint : public Fix {
+ public:
+  FixSoftcoreRestraint(class LAMMPS *, int, char **);
+  ~FixSoftcoreRestraint();
+  int setmask();
+  void init();
+  void setup(int);
+  void min_setup(int);
+  void post_force(int);
+  void min_post_force(int);
+  double compute_scalar();
+  double compute_vector(int);
+
+  // lambda grid shared with the softcore pair styles: number of nodes,
+  // node change, and restraint energy at each node (added to the array
+  // on proc 0 only, must be called by all procs)
+
+  int grid_size();
+  void change_node(int);
+  void node_energies(double *);
+
+ private:
+  enum {BOND,ANGLE,DIHEDRAL};
+  int nterms;
+  int *kind;            // BOND, ANGLE or DIHEDRAL
+  tagint **ids;         // atom IDs of each term
+  double *kconst;       // energy = kconst*(value - target)^2
+  double *target;       // distance or angle (radians)
+
+  double lambda;        // current coupling of the restraints
+  int gridsize;         // number of own nodes (0 = follow the pair grid)
+  double *lambdanode;   // coupling at each own node
+  class PairSoftcore *pair;
+
+  double coupling();
+  double restrain(double);
+
+  int force_flag;
+  double energy;        // local restraint energy at full strength
+  double energy_all;
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Fix softcore/restraint requires a softcore-type pair style
+
+Without the nodes keyword, the restraints follow the lambda of a pair
+style derived from PairSoftcore, which must be defined.
+
+E: Fix softcore/restraint requires an atom map, see atom_modify
+
+Self-explanatory.
+
+E: Fix softcore/restraint atoms %d %d missing
+
+The atoms of a restraint term must be owned or ghost atoms of every
+proc that owns any of them.  Increase the ghost cutoff with comm_modify
+cutoff.
+
+*/
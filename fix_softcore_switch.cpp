@@ -0,0 +1,400 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------------
+   Contributing authors: Ana J. Silveira (asilveira@plapiqui.edu.ar)
+                         Charlles R. A. Abreu (abreu@eq.ufrj.br)
+------------------------------------------------------------------------- */
+
+#include "math.h"
+#include "string.h"
+#include "fix_softcore_switch.h"
+#include "pair_hybrid_softcore.h"
+#include "universe.h"
+#include "update.h"
+#include "force.h"
+#include "domain.h"
+#include "comm.h"
+#include "memory.h"
+#include "error.h"
+
+using namespace LAMMPS_NS;
+using namespace FixConst;
+
+/* ----------------------------------------------------------------------
+   fix ID group softcore/switch Nswitch Nrelax T [from A] [to B]
+                                [ramp linear|smooth]
+
+   Nonequilibrium fast-growth switching. Each cycle consists of Nrelax
+   steps at lambda = A, a forward switch from A to B in Nswitch steps,
+   Nrelax steps at lambda = B, and a reverse switch back to A. The work
+   of each switch is accumulated from the analytic dU/dlambda computed
+   by the softcore kernels. Each partition runs an independent sequence
+   of switches (the user must assign distinct velocity seeds), and the
+   works of all partitions are combined into Jarzynski and Bennett
+   (Crooks) estimates of the free energy F(B) - F(A).
+------------------------------------------------------------------------- */
+
+FixSoftcoreSwitch::FixSoftcoreSwitch(LAMMPS *lmp, int narg, char **arg) :
+  Fix(lmp, narg, arg)
+{
+  if (narg < 6)
+    error->all(FLERR,"Illegal fix softcore/switch command");
+
+  nswitch = force->inumeric(FLERR,arg[3]);
+  nrelax = force->inumeric(FLERR,arg[4]);
+  if (nswitch <= 0 || nrelax < 0)
+    error->all(FLERR,"Illegal fix softcore/switch command");
+  kT = force->boltz*force->numeric(FLERR,arg[5]);
+  if (kT <= 0.0)
+    error->all(FLERR,"Illegal fix softcore/switch command");
+
+  lambda_a = 0.0;
+  lambda_b = 1.0;
+  smooth = 0;
+  int iarg = 6;
+  while (iarg < narg) {
+    if (iarg+2 > narg)
+      error->all(FLERR,"Illegal fix softcore/switch command");
+    if (strcmp(arg[iarg],"from") == 0)
+      lambda_a = force->numeric(FLERR,arg[iarg+1]);
+    else if (strcmp(arg[iarg],"to") == 0)
+      lambda_b = force->numeric(FLERR,arg[iarg+1]);
+    else if (strcmp(arg[iarg],"ramp") == 0) {
+      if (strcmp(arg[iarg+1],"linear") == 0) smooth = 0;
+      else if (strcmp(arg[iarg+1],"smooth") == 0) smooth = 1;
+      else error->all(FLERR,"Illegal fix softcore/switch command");
+    }
+    else
+      error->all(FLERR,"Illegal fix softcore/switch command");
+    iarg += 2;
+  }
+  if (lambda_a < 0.0 || lambda_a > 1.0 || lambda_b < 0.0 || lambda_b > 1.0 ||
+      lambda_a == lambda_b)
+    error->all(FLERR,"Illegal fix softcore/switch command");
+
+  vector_flag = 1;
+  size_vector = 5;
+  global_freq = 1;
+  extvector = 0;
+
+  // Retrieve all lambda-related pair styles:
+  PairHybridSoftcore *hybrid = dynamic_cast<PairHybridSoftcore*>(force->pair);
+  if (hybrid) {
+    pair = new class PairSoftcore*[hybrid->nstyles];
+    npairs = 0;
+    for (int i = 0; i < hybrid->nstyles; i++)
+      if ((pair[npairs] = dynamic_cast<class PairSoftcore*>(hybrid->styles[i])))
+        npairs++;
+  }
+  else {
+    pair = new class PairSoftcore*[1];
+    npairs = (pair[0] = dynamic_cast<class PairSoftcore*>(force->pair)) != NULL;
+  }
+  if (npairs == 0)
+    error->all(FLERR,"Fix softcore/switch requires a softcore-type pair style");
+
+  nworlds = universe->nworlds;
+  iworld = universe->iworld;
+
+  phase = nrelax ? RELAX_A : FORWARD;
+  count = 0;
+  lambda = lambda_a;
+  work = 0.0;
+  etail0 = 0.0;
+
+  nfw = nbw = maxfw = maxbw = 0;
+  wfw = wbw = NULL;
+  dFfw = dFbw = dFbar = 0.0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+FixSoftcoreSwitch::~FixSoftcoreSwitch()
+{
+  delete [] pair;
+  memory->destroy(wfw);
+  memory->destroy(wbw);
+}
+
+/* ---------------------------------------------------------------------- */
+
+int FixSoftcoreSwitch::setmask()
+{
+  return PRE_FORCE | END_OF_STEP;
+}
+
+/* ----------------------------------------------------------------------
+   The switching cycle and all collected works are kept across runs
+------------------------------------------------------------------------- */
+
+void FixSoftcoreSwitch::init()
+{
+  for (int i = 0; i < npairs; i++)
+    if (!pair[i]->dudl_enable)
+      error->all(FLERR,"Fix softcore/switch: pair style cannot compute dU/dlambda");
+  if (strstr(update->integrate_style,"respa"))
+    error->all(FLERR,"Fix softcore/switch does not support rRESPA");
+
+  // a run starting in the middle of a switch adds the tail change of the
+  // steps already made to the work of that switch:
+
+  reinit_pairs();
+  if ((phase == FORWARD || phase == REVERSE) && count > 0)
+    work += (tail_energy() - etail0)/(domain->xprd*domain->yprd*domain->zprd);
+  etail0 = tail_energy();
+}
+
+/* ----------------------------------------------------------------------
+   Request dU/dlambda in the regular force computation of switching steps
+------------------------------------------------------------------------- */
+
+void FixSoftcoreSwitch::pre_force(int vflag)
+{
+  if (phase == FORWARD || phase == REVERSE)
+    for (int i = 0; i < npairs; i++)
+      pair[i]->dudlflag = 1;
+}
+
+/* ----------------------------------------------------------------------
+   Accumulate the work of the lambda increment that follows the current
+   configuration and advance the switching cycle
+------------------------------------------------------------------------- */
+
+void FixSoftcoreSwitch::end_of_step()
+{
+  if (phase == RELAX_A || phase == RELAX_B) {
+    if (++count >= nrelax) {
+      phase = phase == RELAX_A ? FORWARD : REVERSE;
+      count = 0;
+      work = 0.0;
+    }
+    return;
+  }
+
+  double local = 0.0;
+  for (int i = 0; i < npairs; i++)
+    local += pair[i]->edudl;
+  double dudl;
+  MPI_Allreduce(&local,&dudl,1,MPI_DOUBLE,MPI_SUM,world);
+
+  double next = ramp(++count);
+  work += dudl*(next - lambda);
+  set_lambda(next);
+
+  if (count == nswitch) {
+
+    // tail corrections are refreshed only at the end of each switch, and
+    // their change is added to its work at the current volume:
+
+    reinit_pairs();
+    double etail = tail_energy();
+    work += (etail - etail0)/(domain->xprd*domain->yprd*domain->zprd);
+    etail0 = etail;
+
+    store_work();
+    estimate();
+    phase = phase == FORWARD ? RELAX_B : RELAX_A;
+    count = 0;
+    if (nrelax == 0) {
+      phase = phase == RELAX_A ? FORWARD : REVERSE;
+      work = 0.0;
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------
+   Lambda value after a given step of the current switch
+------------------------------------------------------------------------- */
+
+double FixSoftcoreSwitch::ramp(int step)
+{
+  double s = (double)step/nswitch;
+  if (smooth) s = s*s*(3.0 - 2.0*s);
+  if (phase == FORWARD)
+    return lambda_a + (lambda_b - lambda_a)*s;
+  else
+    return lambda_b + (lambda_a - lambda_b)*s;
+}
+
+/* ----------------------------------------------------------------------
+   Change the coupling parameter of all softcore styles. Only the
+   lambda-dependent coefficients are updated, so the tail corrections
+   reported by thermo keep the values of the latest reinit_pairs() until
+   the switch ends.
+------------------------------------------------------------------------- */
+
+void FixSoftcoreSwitch::set_lambda(double value)
+{
+  lambda = value;
+  for (int i = 0; i < npairs; i++)
+    pair[i]->update_lambda(value);
+}
+
+/* ----------------------------------------------------------------------
+   Full reinitialization of all softcore styles at the current lambda
+------------------------------------------------------------------------- */
+
+void FixSoftcoreSwitch::reinit_pairs()
+{
+  for (int i = 0; i < npairs; i++) {
+    pair[i]->lambda = lambda;
+    pair[i]->reinit();
+  }
+}
+
+/* ----------------------------------------------------------------------
+   Total tail correction energy (times volume) of all softcore styles
+------------------------------------------------------------------------- */
+
+double FixSoftcoreSwitch::tail_energy()
+{
+  double etail = 0.0;
+  for (int i = 0; i < npairs; i++)
+    if (pair[i]->tail_flag) etail += pair[i]->etail;
+  return etail;
+}
+
+/* ----------------------------------------------------------------------
+   Gather the works of the switch just finished by all partitions
+------------------------------------------------------------------------- */
+
+void FixSoftcoreSwitch::store_work()
+{
+  double mine[nworlds];
+  double all[nworlds];
+  for (int p = 0; p < nworlds; p++)
+    mine[p] = comm->me == 0 && p == iworld ? work : 0.0;
+  MPI_Allreduce(mine,all,nworlds,MPI_DOUBLE,MPI_SUM,universe->uworld);
+
+  if (phase == FORWARD) {
+    if (nfw + nworlds > maxfw) {
+      maxfw += nworlds*16;
+      memory->grow(wfw,maxfw,"fix_softcore_switch::wfw");
+    }
+    for (int p = 0; p < nworlds; p++)
+      wfw[nfw++] = all[p];
+  }
+  else {
+    if (nbw + nworlds > maxbw) {
+      maxbw += nworlds*16;
+      memory->grow(wbw,maxbw,"fix_softcore_switch::wbw");
+    }
+    for (int p = 0; p < nworlds; p++)
+      wbw[nbw++] = all[p];
+  }
+}
+
+/* ----------------------------------------------------------------------
+   Free-energy estimates from all collected works: Jarzynski averages of
+   forward and reverse switches, and the Bennett acceptance ratio, which
+   is the maximum-likelihood solution of the Crooks fluctuation theorem
+------------------------------------------------------------------------- */
+
+void FixSoftcoreSwitch::estimate()
+{
+  if (nfw > 0) dFfw = -kT*log_mean_exp(nfw,wfw,-1.0/kT);
+  if (nbw > 0) dFbw = kT*log_mean_exp(nbw,wbw,-1.0/kT);
+
+  if (nfw > 0 && nbw > 0) {
+
+    // the BAR residual increases monotonically with dF, from -nbw to nfw:
+
+    double lo = dFfw;
+    double hi = dFbw;
+    if (lo > hi) {
+      lo = dFbw;
+      hi = dFfw;
+    }
+    lo -= kT;
+    hi += kT;
+    while (bar_residual(lo) > 0.0) lo -= hi - lo;
+    while (bar_residual(hi) < 0.0) hi += hi - lo;
+    for (int iter = 0; iter < 200 && hi - lo > 1.e-10*kT; iter++) {
+      double dF = 0.5*(lo + hi);
+      if (bar_residual(dF) > 0.0) hi = dF;
+      else lo = dF;
+    }
+    dFbar = 0.5*(lo + hi);
+  }
+
+  if (universe->me == 0) {
+    FILE* unit[2] = {universe->uscreen,universe->ulogfile};
+    for (int i = 0; i < 2; i++)
+      if (unit[i]) {
+        fprintf(unit[i],BIGINT_FORMAT " softcore/switch: %s W = (",
+                update->ntimestep,phase == FORWARD ? "forward" : "reverse");
+        double *w = phase == FORWARD ? wfw + nfw : wbw + nbw;
+        for (int p = -nworlds; p < -1; p++)
+          fprintf(unit[i],"%g; ",w[p]);
+        fprintf(unit[i],"%g);",w[-1]);
+        if (nfw > 0) fprintf(unit[i]," dF(fw) = %g;",dFfw);
+        if (nbw > 0) fprintf(unit[i]," dF(rev) = %g;",dFbw);
+        if (nfw > 0 && nbw > 0)
+          fprintf(unit[i]," dF(BAR) = %g (%d/%d switches)",dFbar,nfw,nbw);
+        fprintf(unit[i],"\n");
+        fflush(unit[i]);
+      }
+  }
+}
+
+/* ----------------------------------------------------------------------
+   Difference between the forward and reverse sums of Fermi functions
+   whose zero is the BAR estimate of the free energy
+------------------------------------------------------------------------- */
+
+double FixSoftcoreSwitch::bar_residual(double dF)
+{
+  double M = kT*log((double)nfw/nbw);
+  double sum = 0.0;
+  for (int i = 0; i < nfw; i++)
+    sum += 1.0/(1.0 + exp((M + wfw[i] - dF)/kT));
+  for (int i = 0; i < nbw; i++)
+    sum -= 1.0/(1.0 + exp((wbw[i] + dF - M)/kT));
+  return sum;
+}
+
+/* ----------------------------------------------------------------------
+   Logarithm of the average of exp(beta*w) over n values, computed
+   without overflow
+------------------------------------------------------------------------- */
+
+double FixSoftcoreSwitch::log_mean_exp(int n, double *w, double beta)
+{
+  double xmax = beta*w[0];
+  for (int i = 1; i < n; i++)
+    xmax = MAX(xmax,beta*w[i]);
+  double sum = 0.0;
+  for (int i = 0; i < n; i++)
+    sum += exp(beta*w[i] - xmax);
+  return xmax + log(sum/n);
+}
+
+/* ----------------------------------------------------------------------
+   Return current lambda, work of the current switch, or the forward
+   Jarzynski, reverse Jarzynski, and BAR free-energy estimates
+------------------------------------------------------------------------- */
+
+double FixSoftcoreSwitch::compute_vector(int i)
+{
+  if (i == 0)
+    return lambda;
+  else if (i == 1)
+    return work;
+  else if (i == 2)
+    return dFfw;
+  else if (i == 3)
+    return dFbw;
+  else
+    return dFbar;
+}
@@ -0,0 +1,98 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifdef FIX_CLASS
+
+FixStyle(softcore/switch,FixSoftcoreSwitch)
+
+#else
+
+#ifndef LMP_FIX_SOFTCORE_SWITCH_H
+#define LMP_FIX_SOFTCORE_SWITCH_H
+
+#include "fix.h"
+#include "pair_softcore.h"
+
+namespace LAMMPS_NS {
+
+class FixSoftcoreSwitch : public Fix {
+ public:
+  FixSoftcoreSwitch(class LAMMPS *, int, char **);
+  ~FixSoftcoreSwitch();
+  int setmask();
+  void init();
+  void pre_force(int);
+  void end_of_step();
+  double compute_vector(int);
+
+ private:
+  int nswitch;          // steps of each switching trajectory
+  int nrelax;           // equilibration steps at each end state
+  double kT;            // thermal energy
+  double lambda_a;      // initial state of forward switches
+  double lambda_b;      // final state of forward switches
+  int smooth;           // 1 = smoothstep ramp, 0 = linear ramp
+
+  int npairs;
+  class PairSoftcore **pair;
+
+  enum {RELAX_A,FORWARD,RELAX_B,REVERSE};
+  int phase;            // current stage of the switching cycle
+  int count;            // steps completed in the current stage
+  double lambda;        // current coupling parameter value
+  double work;          // work accumulated in the current switch
+  double etail0;        // tail energy already accounted for in work
+
+  int nworlds,iworld;   // # of partitions and index of this partition
+  int nfw,nbw;          // # of completed forward and reverse switches
+  int maxfw,maxbw;      // sizes of work arrays
+  double *wfw,*wbw;     // work of all forward and reverse switches
+  double dFfw,dFbw,dFbar;
+
+  double ramp(int);
+  void set_lambda(double);
+  void reinit_pairs();
+  double tail_energy();
+  void store_work();
+  void estimate();
+  double bar_residual(double);
+  double log_mean_exp(int, double *, double);
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Fix softcore/switch requires a softcore-type pair style
+
+No pair style derived from PairSoftcore is defined.
+
+E: Fix softcore/switch: pair style cannot compute dU/dlambda
+
+All softcore sub-styles must provide the analytic derivative of their
+energy with respect to lambda.
+
+E: Fix softcore/switch does not support rRESPA
+
+The derivative dU/dlambda is only evaluated by the regular kernels.
+
+*/
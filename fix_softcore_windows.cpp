@@ -0,0 +1,387 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------------
+   Contributing authors: Ana J. Silveira (asilveira@plapiqui.edu.ar)
+                         Charlles R. A. Abreu (abreu@eq.ufrj.br)
+------------------------------------------------------------------------- */
+
+#include "math.h"
+#include "string.h"
+#include "fix_softcore_windows.h"
+#include "pair_hybrid_softcore.h"
+#include "universe.h"
+#include "update.h"
+#include "force.h"
+#include "domain.h"
+#include "comm.h"
+#include "timer.h"
+#include "memory.h"
+#include "error.h"
+
+using namespace LAMMPS_NS;
+using namespace FixConst;
+
+/* ----------------------------------------------------------------------
+   fix ID group softcore/windows Nevery Nalloc T [equil N] [tol value]
+
+   Each partition samples one node of the lambda grid at a time. Every
+   Nevery steps, the grid energies are used to accumulate exponential
+   averages towards the neighbor nodes. Every Nalloc steps, statistics
+   from all partitions are combined and partitions are redistributed
+   among the nodes so that the number of samples of each node becomes
+   proportional to its contribution to the free-energy uncertainty.
+------------------------------------------------------------------------- */
+
+FixSoftcoreWindows::FixSoftcoreWindows(LAMMPS *lmp, int narg, char **arg) :
+  Fix(lmp, narg, arg)
+{
+  if (narg < 6)
+    error->all(FLERR,"Illegal fix softcore/windows command");
+
+  nevery = force->inumeric(FLERR,arg[3]);
+  nalloc = force->inumeric(FLERR,arg[4]);
+  if (nevery <= 0 || nalloc <= 0)
+    error->all(FLERR,"Illegal fix softcore/windows command");
+  if (nalloc % nevery)
+    error->all(FLERR,"Fix softcore/windows allocation interval must be a multiple of nevery");
+  kT = force->boltz*force->numeric(FLERR,arg[5]);
+  if (kT <= 0.0)
+    error->all(FLERR,"Illegal fix softcore/windows command");
+
+  nequil = 0;
+  tolerance = 0.0;
+  int iarg = 6;
+  while (iarg < narg) {
+    if (iarg+2 > narg)
+      error->all(FLERR,"Illegal fix softcore/windows command");
+    if (strcmp(arg[iarg],"equil") == 0)
+      nequil = force->inumeric(FLERR,arg[iarg+1]);
+    else if (strcmp(arg[iarg],"tol") == 0)
+      tolerance = force->numeric(FLERR,arg[iarg+1]);
+    else
+      error->all(FLERR,"Illegal fix softcore/windows command");
+    if (nequil < 0 || tolerance < 0.0)
+      error->all(FLERR,"Illegal fix softcore/windows command");
+    iarg += 2;
+  }
+
+  vector_flag = 1;
+  size_vector = 3;
+  global_freq = 1;
+  extvector = 0;
+
+  // Retrieve all lambda-related pair styles:
+  PairHybridSoftcore *hybrid = dynamic_cast<PairHybridSoftcore*>(force->pair);
+  if (hybrid) {
+    pair = new class PairSoftcore*[hybrid->nstyles];
+    npairs = 0;
+    for (int i = 0; i < hybrid->nstyles; i++)
+      if ((pair[npairs] = dynamic_cast<class PairSoftcore*>(hybrid->styles[i])))
+        npairs++;
+  }
+  else {
+    pair = new class PairSoftcore*[1];
+    npairs = (pair[0] = dynamic_cast<class PairSoftcore*>(force->pair)) != NULL;
+  }
+  if (npairs == 0)
+    error->all(FLERR,"Fix softcore/windows requires a softcore-type pair style");
+
+  nworlds = universe->nworlds;
+  iworld = universe->iworld;
+  assigned = new int[nworlds];
+
+  gridsize = 0;
+  nsample = sumfw = sumfw2 = sumbw = sumbw2 = NULL;
+  all = share = NULL;
+  window = -1;
+  equilstep = 0;
+  dF = 0.0;
+  dFvar = -1.0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+FixSoftcoreWindows::~FixSoftcoreWindows()
+{
+  delete [] pair;
+  delete [] assigned;
+  memory->destroy(nsample);
+  memory->destroy(all);
+  memory->destroy(share);
+}
+
+/* ---------------------------------------------------------------------- */
+
+int FixSoftcoreWindows::setmask()
+{
+  return PRE_FORCE | END_OF_STEP;
+}
+
+/* ----------------------------------------------------------------------
+   At the first run, distribute partitions evenly along the grid. In
+   subsequent runs, statistics and assignments are kept.
+------------------------------------------------------------------------- */
+
+void FixSoftcoreWindows::init()
+{
+  int nodes = pair[0]->gridsize;
+  int all_equal = 1;
+  for (int i = 1; i < npairs; i++)
+    all_equal &= pair[i]->gridsize == nodes;
+  if (!all_equal)
+    error->all(FLERR,"Fix softcore/windows: pair styles have different numbers of nodes");
+  if (nodes == 0)
+    error->all(FLERR,"Fix softcore/windows: no lambda grid has been defined");
+
+  if (nodes != gridsize) {
+    gridsize = nodes;
+
+    // one contiguous block for the five statistics arrays:
+    memory->destroy(nsample);
+    memory->create(nsample,5*gridsize,"fix_softcore_windows::stats");
+    sumfw = nsample + gridsize;
+    sumfw2 = sumfw + gridsize;
+    sumbw = sumfw2 + gridsize;
+    sumbw2 = sumbw + gridsize;
+    for (int k = 0; k < 5*gridsize; k++)
+      nsample[k] = 0.0;
+    memory->destroy(all);
+    memory->create(all,5*gridsize,"fix_softcore_windows::all");
+    memory->destroy(share);
+    memory->create(share,gridsize,"fix_softcore_windows::share");
+
+    for (int p = 0; p < nworlds; p++)
+      if (nworlds == 1)
+        assigned[p] = 0;
+      else
+        assigned[p] = static_cast<int>((double)p*(gridsize-1)/(nworlds-1) + 0.5);
+    window = -1;
+  }
+
+  change_window(assigned[iworld]);
+}
+
+/* ----------------------------------------------------------------------
+   Request grid energies in the regular force computation of sampling
+   steps, so that no additional pair evaluation is needed
+------------------------------------------------------------------------- */
+
+void FixSoftcoreWindows::pre_force(int vflag)
+{
+  if (update->ntimestep % nevery) return;
+  for (int i = 0; i < npairs; i++)
+    pair[i]->gridflag = 1;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixSoftcoreWindows::end_of_step()
+{
+  bigint ntimestep = update->ntimestep;
+
+  if (ntimestep >= equilstep) {
+    double energy[gridsize];
+    double node_energy[gridsize];
+    for (int k = 0; k < gridsize; k++)
+      energy[k] = 0.0;
+    for (int i = 0; i < npairs; i++) {
+      MPI_Allreduce(pair[i]->evdwlnode,&node_energy[0],gridsize,MPI_DOUBLE,MPI_SUM,world);
+      if (pair[i]->tail_flag) {
+        double volume = domain->xprd*domain->yprd*domain->zprd;
+        for (int k = 0; k < gridsize; k++)
+          node_energy[k] += pair[i]->etailnode[k]/volume;
+      }
+      for (int k = 0; k < gridsize; k++)
+        energy[k] += node_energy[k];
+    }
+
+    int k = window;
+    nsample[k] += 1.0;
+    if (k < gridsize-1) {
+      double w = exp(-(energy[k+1] - energy[k])/kT);
+      sumfw[k] += w;
+      sumfw2[k] += w*w;
+    }
+    if (k > 0) {
+      double w = exp(-(energy[k-1] - energy[k])/kT);
+      sumbw[k] += w;
+      sumbw2[k] += w*w;
+    }
+  }
+
+  if (ntimestep % nalloc == 0) reallocate();
+}
+
+/* ----------------------------------------------------------------------
+   Combine the statistics of all partitions, estimate the free energy
+   and its variance, and redistribute partitions among nodes (Neyman
+   allocation: samples of each node proportional to the standard
+   deviation of its contribution)
+------------------------------------------------------------------------- */
+
+void FixSoftcoreWindows::reallocate()
+{
+  int k,p;
+  int G = gridsize;
+
+  // sum statistics and assignments over partitions (one root per world):
+
+  double mine[5*G];
+  for (k = 0; k < 5*G; k++)
+    mine[k] = comm->me == 0 ? nsample[k] : 0.0;
+  MPI_Allreduce(mine,all,5*G,MPI_DOUBLE,MPI_SUM,universe->uworld);
+  double *n = all;
+  double *fw = all + G;
+  double *fw2 = fw + G;
+  double *bw = fw2 + G;
+  double *bw2 = bw + G;
+
+  // one-sided free energy estimates and their variances (delta method):
+
+  double dFfw[G],varfw[G],dFbw[G],varbw[G];
+  for (k = 0; k < G; k++) {
+    varfw[k] = varbw[k] = -1.0;
+    if (n[k] < 2.0) continue;
+    if (k < G-1 && fw[k] > 0.0) {
+      double m = fw[k]/n[k];
+      dFfw[k] = -kT*log(m);
+      varfw[k] = kT*kT*MAX(fw2[k]/n[k] - m*m,0.0)/(n[k]*m*m);
+    }
+    if (k > 0 && bw[k] > 0.0) {
+      double m = bw[k]/n[k];
+      dFbw[k] = kT*log(m);
+      varbw[k] = kT*kT*MAX(bw2[k]/n[k] - m*m,0.0)/(n[k]*m*m);
+    }
+  }
+
+  // combine forward and backward estimates of each interval:
+
+  dF = 0.0;
+  dFvar = 0.0;
+  for (k = 0; k < G-1; k++) {
+    double a = varfw[k];
+    double b = varbw[k+1];
+    if (a < 0.0 && b < 0.0) {
+      dFvar = -1.0;
+      break;
+    }
+    else if (b < 0.0 || a == 0.0) {
+      dF += dFfw[k];
+      dFvar += a;
+    }
+    else if (a < 0.0 || b == 0.0) {
+      dF += dFbw[k+1];
+      dFvar += b;
+    }
+    else {
+      dF += (dFfw[k]/a + dFbw[k+1]/b)/(1.0/a + 1.0/b);
+      dFvar += 1.0/(1.0/a + 1.0/b);
+    }
+  }
+
+  // target shares are proportional to per-sample standard deviations:
+
+  double sigmax = 0.0;
+  for (k = 0; k < G; k++) {
+    double var = MAX(varfw[k],0.0) + MAX(varbw[k],0.0);
+    share[k] = n[k] < 2.0 ? -1.0 : sqrt(n[k]*var);
+    sigmax = MAX(sigmax,share[k]);
+  }
+  if (sigmax == 0.0) sigmax = 1.0;
+  double total = 0.0;
+  double ntotal = 0.0;
+  for (k = 0; k < G; k++) {
+    if (share[k] < 0.0) share[k] = sigmax;
+    total += share[k];
+    ntotal += n[k];
+  }
+
+  double q = nalloc/nevery;
+  ntotal += nworlds*q;
+  double deficit[G];
+  for (k = 0; k < G; k++)
+    deficit[k] = ntotal*share[k]/total - n[k];
+
+  // keep partitions whose nodes still lack samples, move the others
+  // to the nodes with largest deficits:
+
+  int current[nworlds];
+  int moved[nworlds];
+  for (p = 0; p < nworlds; p++)
+    current[p] = comm->me == 0 && p == iworld ? window : 0;
+  MPI_Allreduce(current,assigned,nworlds,MPI_INT,MPI_SUM,universe->uworld);
+  for (p = 0; p < nworlds; p++) {
+    moved[p] = deficit[assigned[p]] <= 0.0;
+    if (!moved[p]) deficit[assigned[p]] -= q;
+  }
+  for (p = 0; p < nworlds; p++)
+    if (moved[p]) {
+      int kmax = 0;
+      for (k = 1; k < G; k++)
+        if (deficit[k] > deficit[kmax]) kmax = k;
+      assigned[p] = kmax;
+      deficit[kmax] -= q;
+    }
+
+  if (universe->me == 0) {
+    FILE* unit[2] = {universe->uscreen,universe->ulogfile};
+    for (int i = 0; i < 2; i++)
+      if (unit[i]) {
+        fprintf(unit[i],BIGINT_FORMAT " softcore/windows: ",update->ntimestep);
+        if (dFvar < 0.0)
+          fprintf(unit[i],"dF = n/a;");
+        else
+          fprintf(unit[i],"dF = %g +/- %g;",dF,sqrt(dFvar));
+        fprintf(unit[i]," nodes (");
+        for (p = 0; p < nworlds-1; p++)
+          fprintf(unit[i],"%d; ",assigned[p]);
+        fprintf(unit[i],"%d)\n",assigned[nworlds-1]);
+        fflush(unit[i]);
+      }
+  }
+
+  change_window(assigned[iworld]);
+
+  if (tolerance > 0.0 && dFvar >= 0.0 && dFvar < tolerance*tolerance)
+    timer->force_timeout();
+}
+
+/* ----------------------------------------------------------------------
+   Move this partition to another node of the lambda grid
+------------------------------------------------------------------------- */
+
+void FixSoftcoreWindows::change_window(int node)
+{
+  if (node == window) return;
+  window = node;
+  for (int i = 0; i < npairs; i++) {
+    pair[i]->lambda = pair[i]->lambdanode[node];
+    pair[i]->reinit();
+  }
+  equilstep = update->ntimestep + nequil;
+}
+
+/* ----------------------------------------------------------------------
+   Return current node, total free energy, or its uncertainty
+------------------------------------------------------------------------- */
+
+double FixSoftcoreWindows::compute_vector(int i)
+{
+  if (i == 0)
+    return window;
+  else if (i == 1)
+    return dF;
+  else
+    return dFvar < 0.0 ? 0.0 : sqrt(dFvar);
+}
@@ -0,0 +1,95 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifdef FIX_CLASS
+
+FixStyle(softcore/windows,FixSoftcoreWindows)
+
+#else
+
+#ifndef LMP_FIX_SOFTCORE_WINDOWS_H
+#define LMP_FIX_SOFTCORE_WINDOWS_H
+
+#include "fix.h"
+#include "pair_softcore.h"
+
+namespace LAMMPS_NS {
+
+class FixSoftcoreWindows : public Fix {
+ public:
+  FixSoftcoreWindows(class LAMMPS *, int, char **);
+  ~FixSoftcoreWindows();
+  int setmask();
+  void init();
+  void pre_force(int);
+  void end_of_step();
+  double compute_vector(int);
+
+ private:
+  int nalloc;          // steps between reallocations of windows
+  int nequil;          // steps discarded after a window change
+  double kT;           // thermal energy
+  double tolerance;    // target uncertainty of total free energy (0 = none)
+
+  int npairs;
+  class PairSoftcore **pair;
+
+  int gridsize;
+  int nworlds,iworld;  // # of partitions and index of this partition
+  int window;          // node currently sampled by this partition
+  int *assigned;       // node sampled by each partition
+  bigint equilstep;    // first step whose samples are accumulated
+
+  // per-node statistics of this partition and of all partitions:
+  // forward (k -> k+1) and backward (k -> k-1) exponential averages
+
+  double *nsample,*sumfw,*sumfw2,*sumbw,*sumbw2;
+  double *all;
+
+  double dF,dFvar;     // latest estimate of free energy and its variance
+  double *share;       // relative sample allocation of each node
+
+  void change_window(int);
+  void reallocate();
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Fix softcore/windows requires a softcore-type pair style
+
+No pair style derived from PairSoftcore is defined.
+
+E: Fix softcore/windows allocation interval must be a multiple of nevery
+
+Self-explanatory.
+
+E: Fix softcore/windows: pair styles have different numbers of nodes
+
+All softcore sub-styles must share the same lambda grid.
+
+E: Fix softcore/windows: no lambda grid has been defined
+
+Use pair_modify set_grid or add_node to define the windows.
+
+*/
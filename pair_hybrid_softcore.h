@@ -28,6 +28,11 @@ namespace LAMMPS_NS {
 class PairHybridSoftcore : public PairHybrid {
  friend class FixSoftcoreEE;
  friend class ComputeSoftcoreGrid;
+ friend class FixSoftcoreWindows;
+ friend class DumpSoftcore;
+ friend class ComputeSoftcoreWidom;
+ friend class FixSoftcoreGCMC;
+ friend class PairSoftcore;
 
  public:
   PairHybridSoftcore(class LAMMPS *);
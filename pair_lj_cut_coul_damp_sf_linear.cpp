@@ -31,6 +31,7 @@ PairLJCutCoulDampSFLinear::PairLJCutCoulDampSFLinear(LAMMPS *lmp) : PairSoftcore
 {
   single_enable = 1;
   self_flag = 0;
+  dudl_enable = 1;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -59,19 +60,21 @@ PairLJCutCoulDampSFLinear::~PairLJCutCoulDampSFLinear()
 
 void PairLJCutCoulDampSFLinear::compute(int eflag, int vflag)
 {
-  int i,j,ii,jj,inum,jnum,itype,jtype,intra;
-  double qtmp,xtmp,ytmp,ztmp,delx,dely,delz,vr,fr,evdwl,ecoul,fpair;
+  int i,j,ii,jj,inum,jnum,itype,jtype,intra,full;
+  double qtmp,xtmp,ytmp,ztmp,delx,dely,delz,vr,fr,evdwl,ecoul,fpair,lam;
   double r,rsq,r2inv,r6inv,forcelj,prefactor,forcecoul,factor_lj,factor_coul;
+  double gshare;
   int *ilist,*jlist,*numneigh,**firstneigh;
 
   if (gridflag) for (i = 0; i < gridsize; i++) evdwlnode[i] = ecoulnode[i] = 0.0;
+  if (dudlflag) edudl = 0.0;
 
   evdwl = ecoul = 0.0;
   if (eflag || vflag) ev_setup(eflag,vflag);
   else evflag = vflag_fdotr = 0;
 
   double **x = atom->x;
-  double **f = atom->f;
+  double **f = force_target();
   double *q = atom->q;
   int *type = atom->type;
   int nlocal = atom->nlocal;
@@ -79,16 +82,19 @@ void PairLJCutCoulDampSFLinear::compute(int eflag, int vflag)
   double *special_coul = force->special_coul;
   int newton_pair = force->newton_pair;
   double qqrd2e = force->qqrd2e;
+  tagint *molecule = atom->molecule;
+  tagint *tag = atom->tag;
+  int *mask = atom->mask;
 
-  inum = list->inum;
-  ilist = list->ilist;
-  numneigh = list->numneigh;
-  firstneigh = list->firstneigh;
+  neighbors(inum,ilist,numneigh,firstneigh);
 
   // Compute self energy:
   if (eflag && self_flag)
     for (i = 0; i < nlocal; i++)
       ev_tally(i,i,nlocal,0,0.0,e_self*q[i]*q[i],0.0,0.0,0.0,0.0);
+  if (dudlflag && self_flag)
+    for (i = 0; i < nlocal; i++)
+      edudl -= (e_shift/2.0 + alpha/sqrt(MY_PI))*qqrd2e*q[i]*q[i];
 
   // loop over neighbors of my atoms
 
@@ -108,12 +114,14 @@ void PairLJCutCoulDampSFLinear::compute(int eflag, int vflag)
       factor_lj = special_lj[intra];
       factor_coul = special_coul[intra];
       j &= NEIGHMASK;
+      jtype = type[j];
+      full = full_strength(i,j,itype,jtype,molecule,mask);
+      lam = full ? 1.0 : lambda;
 
       delx = xtmp - x[j][0];
       dely = ytmp - x[j][1];
       delz = ztmp - x[j][2];
       rsq = delx*delx + dely*dely + delz*delz;
-      jtype = type[j];
 
       if (rsq < cutsq[itype][jtype]) {
         r2inv = 1.0/rsq;
@@ -140,7 +148,10 @@ void PairLJCutCoulDampSFLinear::compute(int eflag, int vflag)
         else
           forcecoul = 0.0;
 
-        fpair = lambda*(forcelj + forcecoul)*r2inv;
+        // only the Coulomb term is coupled to lambda, as in the energy,
+        // dU/dlambda and grid energies below:
+
+        fpair = (forcelj + lam*forcecoul)*r2inv;
         f[i][0] += delx*fpair;
         f[i][1] += dely*fpair;
         f[i][2] += delz*fpair;
@@ -159,9 +170,9 @@ void PairLJCutCoulDampSFLinear::compute(int eflag, int vflag)
 
           if (rsq < cut_coulsq)
             if (intra)
-              ecoul = lambda*vr;
+              ecoul = lam*vr;
             else
-              ecoul = lambda*prefactor*(vr + r*f_shift - e_shift);
+              ecoul = lam*prefactor*(vr + r*f_shift - e_shift);
           else
             ecoul = 0.0;
         }
@@ -169,16 +180,29 @@ void PairLJCutCoulDampSFLinear::compute(int eflag, int vflag)
         if (evflag) ev_tally(i,j,nlocal,newton_pair,
                              evdwl,ecoul,fpair,delx,dely,delz);
 
-        if (gridflag && rsq < cut_coulsq) {
+        // Coulomb energy is linear in lambda, van der Waals energy is not:
+        if (dudlflag && !full && rsq < cut_coulsq) {
           if (intra)
             ecoul = vr;
           else
             ecoul = prefactor*(vr + r*f_shift - e_shift);
-          for (int k = 0; k < gridsize; k++)
-            if (newton_pair || j < nlocal)
-              ecoulnode[k] += lambdanode[k]*ecoul;
-            else
-              ecoulnode[k] += 0.5*lambdanode[k]*ecoul;
+          if (newton_pair || j < nlocal)
+            edudl += ecoul;
+          else
+            edudl += 0.5*ecoul;
+        }
+
+        gshare = gridflag ? grid_share(i,j,nlocal,newton_pair,tag) : 0.0;
+        if (gshare > 0.0 && rsq < cut_coulsq) {
+          if (intra)
+            ecoul = vr;
+          else
+            ecoul = prefactor*(vr + r*f_shift - e_shift);
+          ecoul *= gshare;
+          for (int k = 0; k < gridsize; k++) {
+            lam = full ? 1.0 : lambdanode[k];
+            ecoulnode[k] += lam*ecoul;
+          }
         }
       }
     }
@@ -188,6 +212,7 @@ void PairLJCutCoulDampSFLinear::compute(int eflag, int vflag)
 
   uptodate = gridflag;
   gridflag = 0;
+  dudlflag = 0;
 }
 
 /* ----------------------------------------------------------------------
@@ -287,7 +312,12 @@ void PairLJCutCoulDampSFLinear::init_style()
   if (!atom->q_flag)
     error->all(FLERR,"Pair style lj/cut/coul/dsf requires atom charges");
 
-  neighbor->request(this,instance_me);
+  double cutmax = cut_coul;
+  for (int i = 1; i <= atom->ntypes; i++)
+    for (int j = i; j <= atom->ntypes; j++)
+      if (setflag[i][j]) cutmax = MAX(cutmax,cut_lj[i][j]);
+
+  if (!allpairs_mode(cutmax)) neighbor->request(this,instance_me);
 
   PairSoftcore::init_style();
 
@@ -338,28 +368,19 @@ double PairLJCutCoulDampSFLinear::init_one(int i, int j)
   offset[j][i] = offset[i][j];
 
   // compute I,J contribution to long-range tail correction
-  // count total # of atoms of type I and J via Allreduce
+  // total # of atoms of each type was counted in init_style()
 
   if (tail_flag) {
-    int *type = atom->type;
-    int nlocal = atom->nlocal;
-
-    double count[2],all[2];
-    count[0] = count[1] = 0.0;
-    for (int k = 0; k < nlocal; k++) {
-      if (type[k] == i) count[0] += 1.0;
-      if (type[k] == j) count[1] += 1.0;
-    }
-    MPI_Allreduce(count,all,2,MPI_DOUBLE,MPI_SUM,world);
+    double *all = typecount;
 
     double sig2 = sigma[i][j]*sigma[i][j];
     double sig6 = sig2*sig2*sig2;
     double rc3 = cut_lj[i][j]*cut_lj[i][j]*cut_lj[i][j];
     double rc6 = rc3*rc3;
     double rc9 = rc3*rc6;
-    etail_ij = 8.0*MY_PI*all[0]*all[1]*epsilon[i][j] * 
+    etail_ij = 8.0*MY_PI*all[i]*all[j]*epsilon[i][j] * 
                sig6 * (sig6 - 3.0*rc6) / (9.0*rc9); 
-    ptail_ij = 16.0*MY_PI*all[0]*all[1]*epsilon[i][j] * 
+    ptail_ij = 16.0*MY_PI*all[i]*all[j]*epsilon[i][j] * 
                sig6 * (2.0*sig6 - 3.0*rc6) / (9.0*rc9); 
   } 
 
@@ -494,6 +515,8 @@ double PairLJCutCoulDampSFLinear::single(int i, int j, int itype, int jtype, dou
                                 double &fforce)
 {
   double r2inv,r6inv,r,vr,fr,prefactor;
+  double lam = full_strength(i,j,itype,jtype,atom->molecule,atom->mask) ?
+    1.0 : lambda;
 
   r2inv = 1.0/rsq;
   fforce = 0.0;
@@ -504,7 +527,7 @@ double PairLJCutCoulDampSFLinear::single(int i, int j, int itype, int jtype, dou
   if (rsq < cut_coulsq) {
     r = sqrt(rsq);
     unshifted( r, vr, fr );
-    prefactor = factor_coul * force->qqrd2e * atom->q[i] * atom->q[j];
+    prefactor = lam * factor_coul * force->qqrd2e * atom->q[i] * atom->q[j];
     fforce += prefactor*(fr-f_shift)*r;
   }
   fforce *= r2inv;
@@ -28,6 +28,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "pair_lj_cut_softcore.h"
+#include "pair_softcore_kernel.h"
 #include "atom.h"
 #include "comm.h"
 #include "force.h"
@@ -50,6 +51,17 @@ PairLJCutSoftcore::PairLJCutSoftcore(LAMMPS *lmp) : PairSoftcore(lmp)
 {
   respa_enable = 1;
   writedata = 1;
+  dudl_enable = 1;
+  test_enable = 1;
+  lambda_enable = 1;
+
+  npentry = 0;
+  pentry = NULL;
+  pvalue = NULL;
+  epsp = sigp = NULL;
+  lj3p = lj4p = asqp = offsetp = NULL;
+  lj3pf = lj4pf = offsetpf = NULL;
+  etailp = NULL;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -70,370 +82,165 @@ PairLJCutSoftcore::~PairLJCutSoftcore()
     memory->destroy(offset);
 
     memory->destroy(asq);
+    memory->destroy(lj1f);
+    memory->destroy(lj2f);
+    memory->destroy(lj3f);
+    memory->destroy(lj4f);
+    memory->destroy(offsetf);
+    memory->destroy(asqf);
+
+    memory->destroy(dlj3);
+    memory->destroy(dlj4);
+    memory->destroy(dasq);
+    memory->destroy(doffset);
   }
-}
 
-/* ---------------------------------------------------------------------- */
+  memory->destroy(pentry);
+  memory->destroy(pvalue);
+  memory->destroy(epsp);
+  memory->destroy(sigp);
+  memory->destroy(lj3p);
+  memory->destroy(lj4p);
+  memory->destroy(asqp);
+  memory->destroy(offsetp);
+  memory->destroy(lj3pf);
+  memory->destroy(lj4pf);
+  memory->destroy(offsetpf);
+  memory->destroy(etailp);
+}
 
-void PairLJCutSoftcore::compute(int eflag, int vflag)
-{
-  int i,j,k,ii,jj,inum,jnum,itype,jtype;
-  double xtmp,ytmp,ztmp,delx,dely,delz,evdwl,fpair;
-  double rsq,r6,sinv,forcelj,factor_lj;
-  int *ilist,*jlist,*numneigh,**firstneigh;
+/* ----------------------------------------------------------------------
+   Lennard-Jones softcore policy of the shared kernels
+   (see pair_softcore_kernel.h)
+------------------------------------------------------------------------- */
 
-  if (gridflag) for (i = 0; i < gridsize; i++) evdwlnode[i] = 0.0;
+namespace LAMMPS_NS {
+
+struct LJCutSoftcorePolicy {
+  enum {NP = 3};
+  int gridsize,npert;
+  double **lj1c[2],**lj2c[2],**lj3c[2],**lj4c[2],**asqc[2],**offsetc[2];
+  double **lj3,**lj4,**dlj3,**dlj4,**dasq,**doffset;
+  double ***lj3n,***lj4n,***asqn,***offsetn;
+  double ***lj3p,***lj4p,***asqp,***offsetp,***lj3pf,***lj4pf,***offsetpf;
+
+  LJCutSoftcorePolicy(PairLJCutSoftcore *pair) {
+    gridsize = pair->gridsize;
+    npert = pair->npert;
+    lj1c[0] = pair->lj1; lj1c[1] = pair->lj1f;
+    lj2c[0] = pair->lj2; lj2c[1] = pair->lj2f;
+    lj3c[0] = pair->lj3; lj3c[1] = pair->lj3f;
+    lj4c[0] = pair->lj4; lj4c[1] = pair->lj4f;
+    asqc[0] = pair->asq; asqc[1] = pair->asqf;
+    offsetc[0] = pair->offset; offsetc[1] = pair->offsetf;
+    lj3 = pair->lj3; lj4 = pair->lj4;
+    dlj3 = pair->dlj3; dlj4 = pair->dlj4;
+    dasq = pair->dasq; doffset = pair->doffset;
+    lj3n = pair->lj3n; lj4n = pair->lj4n;
+    asqn = pair->asqn; offsetn = pair->offsetn;
+    lj3p = pair->lj3p; lj4p = pair->lj4p;
+    asqp = pair->asqp; offsetp = pair->offsetp;
+    lj3pf = pair->lj3pf; lj4pf = pair->lj4pf; offsetpf = pair->offsetpf;
+  }
 
-  evdwl = 0.0;
-  if (eflag || vflag) ev_setup(eflag,vflag);
-  else evflag = vflag_fdotr = 0;
+  double eval(int itype, int jtype, int c, double rsq, int eflag,
+              double &evdwl) const {
+    double r6 = rsq*rsq*rsq;
+    double sinv = 1.0/(r6 + asqc[c][itype][jtype]);
+    if (eflag)
+      evdwl = sinv*(lj3c[c][itype][jtype]*sinv - lj4c[c][itype][jtype]) -
+        offsetc[c][itype][jtype];
+    return r6*sinv*sinv*(lj1c[c][itype][jtype]*sinv -
+                         lj2c[c][itype][jtype])/rsq;
+  }
 
-  double **x = atom->x;
-  double **f = atom->f;
-  int *type = atom->type;
-  int nlocal = atom->nlocal;
-  double *special_lj = force->special_lj;
-  int newton_pair = force->newton_pair;
-
-  inum = list->inum;
-  ilist = list->ilist;
-  numneigh = list->numneigh;
-  firstneigh = list->firstneigh;
-
-  // loop over neighbors of my atoms
-
-  for (ii = 0; ii < inum; ii++) {
-    i = ilist[ii];
-    xtmp = x[i][0];
-    ytmp = x[i][1];
-    ztmp = x[i][2];
-    itype = type[i];
-    jlist = firstneigh[i];
-    jnum = numneigh[i];
-
-    for (jj = 0; jj < jnum; jj++) {
-      j = jlist[jj];
-      factor_lj = special_lj[sbmask(j)];
-      j &= NEIGHMASK;
-
-      delx = xtmp - x[j][0];
-      dely = ytmp - x[j][1];
-      delz = ztmp - x[j][2];
-      rsq = delx*delx + dely*dely + delz*delz;
-      jtype = type[j];
-
-      if (rsq < cutsq[itype][jtype]) {
-        r6 = rsq*rsq*rsq;
-        sinv = 1.0/(r6 + asq[itype][jtype]);
-        forcelj = r6*sinv*sinv*(lj1[itype][jtype]*sinv - lj2[itype][jtype]);
-        fpair = factor_lj*forcelj/rsq;
-
-        f[i][0] += delx*fpair;
-        f[i][1] += dely*fpair;
-        f[i][2] += delz*fpair;
-        if (newton_pair || j < nlocal) {
-          f[j][0] -= delx*fpair;
-          f[j][1] -= dely*fpair;
-          f[j][2] -= delz*fpair;
-        }
+  double dudl(int itype, int jtype, double rsq) const {
+    double r6 = rsq*rsq*rsq;
+    double sinv = 1.0/(r6 + asqc[0][itype][jtype]);
+    return sinv*(dlj3[itype][jtype]*sinv - dlj4[itype][jtype]) -
+      sinv*sinv*(2.0*lj3[itype][jtype]*sinv - lj4[itype][jtype])*
+      dasq[itype][jtype] - doffset[itype][jtype];
+  }
 
-        if (eflag) {
-          evdwl = sinv*(lj3[itype][jtype]*sinv-lj4[itype][jtype]) -
-            offset[itype][jtype];
-          evdwl *= factor_lj;
-        }
+  void nodes(int itype, int jtype, int c, double rsq, double w,
+             double *e) const {
+    double r6 = rsq*rsq*rsq;
+    if (c) {
+      double sinv = 1.0/r6;
+      double evdwl = w*(sinv*(lj3c[1][itype][jtype]*sinv -
+                              lj4c[1][itype][jtype]) - offsetc[1][itype][jtype]);
+      for (int k = 0; k < gridsize; k++) e[k] += evdwl;
+      return;
+    }
+    double *lj3k = lj3n[itype][jtype], *lj4k = lj4n[itype][jtype];
+    double *asqk = asqn[itype][jtype], *offsetk = offsetn[itype][jtype];
+    for (int k = 0; k < gridsize; k++) {
+      double sinv = 1.0/(r6 + asqk[k]);
+      e[k] += w*(sinv*(lj3k[k]*sinv - lj4k[k]) - offsetk[k]);
+    }
+  }
 
-        if (evflag) ev_tally(i,j,nlocal,newton_pair,
-                             evdwl,0.0,fpair,delx,dely,delz);
-
-        if (gridflag)
-          for (int k = 0; k < gridsize; k++) {
-            sinv = 1.0/(r6 + asqn[itype][jtype][k]);
-            evdwl = sinv*(lj3n[itype][jtype][k]*sinv-lj4n[itype][jtype][k]) -
-              offsetn[itype][jtype][k];
-            evdwl *= factor_lj;
-            if (newton_pair || j < nlocal)
-              evdwlnode[k] += evdwl;
-            else
-              evdwlnode[k] += 0.5*evdwl;
-          }
-      }
+  void pert(int itype, int jtype, int c, double rsq, double w,
+            double *e) const {
+    double r6 = rsq*rsq*rsq;
+    if (c) {
+      double sinv = 1.0/r6;
+      for (int k = 0; k < npert; k++)
+        e[k] += w*(sinv*(lj3pf[itype][jtype][k]*sinv -
+                         lj4pf[itype][jtype][k]) - offsetpf[itype][jtype][k]);
+      return;
+    }
+    for (int k = 0; k < npert; k++) {
+      double sinv = 1.0/(r6 + asqp[itype][jtype][k]);
+      e[k] += w*(sinv*(lj3p[itype][jtype][k]*sinv -
+                       lj4p[itype][jtype][k]) - offsetp[itype][jtype][k]);
     }
   }
 
-  if (vflag_fdotr) virial_fdotr_compute();
+  void gather(int itype, int jtype, int c, double **p, int n) const {
+    p[0][n] = lj1c[c][itype][jtype];
+    p[1][n] = lj2c[c][itype][jtype];
+    p[2][n] = asqc[c][itype][jtype];
+  }
+
+  void fpair(int n, double *rsq, double *fc, double **p) const {
+    double *lj1 = p[0], *lj2 = p[1], *asq = p[2];
+    for (int k = 0; k < n; k++) {
+      double r6 = rsq[k]*rsq[k]*rsq[k];
+      double sinv = 1.0/(r6 + asq[k]);
+      rsq[k] = fc[k]*r6*sinv*sinv*(lj1[k]*sinv - lj2[k])/rsq[k];
+    }
+  }
+};
 
-  uptodate = gridflag;
-  gridflag = 0;
 }
 
 /* ---------------------------------------------------------------------- */
 
-void PairLJCutSoftcore::compute_inner()
+void PairLJCutSoftcore::compute(int eflag, int vflag)
 {
-  int i,j,ii,jj,inum,jnum,itype,jtype;
-  double xtmp,ytmp,ztmp,delx,dely,delz,fpair;
-  double rsq,r6,sinv,forcelj,factor_lj,rsw;
-  int *ilist,*jlist,*numneigh,**firstneigh;
+  compute_policy(LJCutSoftcorePolicy(this),eflag,vflag,NORESPA,NULL);
+}
 
-  double **x = atom->x;
-  double **f = atom->f;
-  int *type = atom->type;
-  int nlocal = atom->nlocal;
-  double *special_lj = force->special_lj;
-  int newton_pair = force->newton_pair;
-
-  inum = listinner->inum;
-  ilist = listinner->ilist;
-  numneigh = listinner->numneigh;
-  firstneigh = listinner->firstneigh;
-
-  double cut_out_on = cut_respa[0];
-  double cut_out_off = cut_respa[1];
-
-  double cut_out_diff = cut_out_off - cut_out_on;
-  double cut_out_on_sq = cut_out_on*cut_out_on;
-  double cut_out_off_sq = cut_out_off*cut_out_off;
-
-  // loop over neighbors of my atoms
-
-  for (ii = 0; ii < inum; ii++) {
-    i = ilist[ii];
-    xtmp = x[i][0];
-    ytmp = x[i][1];
-    ztmp = x[i][2];
-    itype = type[i];
-    jlist = firstneigh[i];
-    jnum = numneigh[i];
-
-    for (jj = 0; jj < jnum; jj++) {
-      j = jlist[jj];
-      factor_lj = special_lj[sbmask(j)];
-      j &= NEIGHMASK;
-
-      delx = xtmp - x[j][0];
-      dely = ytmp - x[j][1];
-      delz = ztmp - x[j][2];
-      rsq = delx*delx + dely*dely + delz*delz;
-
-      if (rsq < cut_out_off_sq) {
-        r6 = rsq*rsq*rsq;
-        sinv = 1.0/(r6 + asq[itype][jtype]);
-        jtype = type[j];
-        forcelj = r6*sinv*sinv*(lj1[itype][jtype]*sinv - lj2[itype][jtype]);
-        fpair = factor_lj*forcelj/rsq;
-        if (rsq > cut_out_on_sq) {
-          rsw = (sqrt(rsq) - cut_out_on)/cut_out_diff;
-          fpair *= 1.0 - rsw*rsw*(3.0 - 2.0*rsw);
-        }
+/* ---------------------------------------------------------------------- */
 
-        f[i][0] += delx*fpair;
-        f[i][1] += dely*fpair;
-        f[i][2] += delz*fpair;
-        if (newton_pair || j < nlocal) {
-          f[j][0] -= delx*fpair;
-          f[j][1] -= dely*fpair;
-          f[j][2] -= delz*fpair;
-        }
-      }
-    }
-  }
+void PairLJCutSoftcore::compute_inner()
+{
+  compute_policy(LJCutSoftcorePolicy(this),0,0,INNER,cut_respa);
 }
 
 /* ---------------------------------------------------------------------- */
 
 void PairLJCutSoftcore::compute_middle()
 {
-  int i,j,ii,jj,inum,jnum,itype,jtype;
-  double xtmp,ytmp,ztmp,delx,dely,delz,fpair;
-  double rsq,r6,sinv,forcelj,factor_lj,rsw;
-  int *ilist,*jlist,*numneigh,**firstneigh;
-
-  double **x = atom->x;
-  double **f = atom->f;
-  int *type = atom->type;
-  int nlocal = atom->nlocal;
-  double *special_lj = force->special_lj;
-  int newton_pair = force->newton_pair;
-
-  inum = listmiddle->inum;
-  ilist = listmiddle->ilist;
-  numneigh = listmiddle->numneigh;
-  firstneigh = listmiddle->firstneigh;
-
-  double cut_in_off = cut_respa[0];
-  double cut_in_on = cut_respa[1];
-  double cut_out_on = cut_respa[2];
-  double cut_out_off = cut_respa[3];
-
-  double cut_in_diff = cut_in_on - cut_in_off;
-  double cut_out_diff = cut_out_off - cut_out_on;
-  double cut_in_off_sq = cut_in_off*cut_in_off;
-  double cut_in_on_sq = cut_in_on*cut_in_on;
-  double cut_out_on_sq = cut_out_on*cut_out_on;
-  double cut_out_off_sq = cut_out_off*cut_out_off;
-
-  // loop over neighbors of my atoms
-
-  for (ii = 0; ii < inum; ii++) {
-    i = ilist[ii];
-    xtmp = x[i][0];
-    ytmp = x[i][1];
-    ztmp = x[i][2];
-    itype = type[i];
-    jlist = firstneigh[i];
-    jnum = numneigh[i];
-
-    for (jj = 0; jj < jnum; jj++) {
-      j = jlist[jj];
-      factor_lj = special_lj[sbmask(j)];
-      j &= NEIGHMASK;
-
-      delx = xtmp - x[j][0];
-      dely = ytmp - x[j][1];
-      delz = ztmp - x[j][2];
-      rsq = delx*delx + dely*dely + delz*delz;
-
-      if (rsq < cut_out_off_sq && rsq > cut_in_off_sq) {
-        r6 = rsq*rsq*rsq;
-        sinv = 1.0/(r6 + asq[itype][jtype]);
-        jtype = type[j];
-        forcelj = r6*sinv*sinv*(lj1[itype][jtype]*sinv - lj2[itype][jtype]);
-        fpair = factor_lj*forcelj/rsq;
-        if (rsq < cut_in_on_sq) {
-          rsw = (sqrt(rsq) - cut_in_off)/cut_in_diff;
-          fpair *= rsw*rsw*(3.0 - 2.0*rsw);
-        }
-        if (rsq > cut_out_on_sq) {
-          rsw = (sqrt(rsq) - cut_out_on)/cut_out_diff;
-          fpair *= 1.0 + rsw*rsw*(2.0*rsw - 3.0);
-        }
-
-        f[i][0] += delx*fpair;
-        f[i][1] += dely*fpair;
-        f[i][2] += delz*fpair;
-        if (newton_pair || j < nlocal) {
-          f[j][0] -= delx*fpair;
-          f[j][1] -= dely*fpair;
-          f[j][2] -= delz*fpair;
-        }
-      }
-    }
-  }
+  compute_policy(LJCutSoftcorePolicy(this),0,0,MIDDLE,cut_respa);
 }
 
 /* ---------------------------------------------------------------------- */
 
 void PairLJCutSoftcore::compute_outer(int eflag, int vflag)
 {
-  int i,j,ii,jj,inum,jnum,itype,jtype;
-  double xtmp,ytmp,ztmp,delx,dely,delz,evdwl,fpair;
-  double rsq,r6,sinv,forcelj,factor_lj,rsw;
-  int *ilist,*jlist,*numneigh,**firstneigh;
-
-  if (gridflag) for (i = 0; i < gridsize; i++) evdwlnode[i] = 0.0;
-
-  evdwl = 0.0;
-  if (eflag || vflag) ev_setup(eflag,vflag);
-  else evflag = 0;
-
-  double **x = atom->x;
-  double **f = atom->f;
-  int *type = atom->type;
-  int nlocal = atom->nlocal;
-  double *special_lj = force->special_lj;
-  int newton_pair = force->newton_pair;
-
-  inum = listouter->inum;
-  ilist = listouter->ilist;
-  numneigh = listouter->numneigh;
-  firstneigh = listouter->firstneigh;
-
-  double cut_in_off = cut_respa[2];
-  double cut_in_on = cut_respa[3];
-
-  double cut_in_diff = cut_in_on - cut_in_off;
-  double cut_in_off_sq = cut_in_off*cut_in_off;
-  double cut_in_on_sq = cut_in_on*cut_in_on;
-
-  // loop over neighbors of my atoms
-
-  for (ii = 0; ii < inum; ii++) {
-    i = ilist[ii];
-    xtmp = x[i][0];
-    ytmp = x[i][1];
-    ztmp = x[i][2];
-    itype = type[i];
-    jlist = firstneigh[i];
-    jnum = numneigh[i];
-
-    for (jj = 0; jj < jnum; jj++) {
-      j = jlist[jj];
-      factor_lj = special_lj[sbmask(j)];
-      j &= NEIGHMASK;
-
-      delx = xtmp - x[j][0];
-      dely = ytmp - x[j][1];
-      delz = ztmp - x[j][2];
-      rsq = delx*delx + dely*dely + delz*delz;
-      jtype = type[j];
-
-      if (rsq < cutsq[itype][jtype]) {
-        if (rsq > cut_in_off_sq) {
-          r6 = rsq*rsq*rsq;
-          sinv = 1.0/(r6 + asq[itype][jtype]);
-          forcelj = r6*sinv*sinv*(lj1[itype][jtype]*sinv - lj2[itype][jtype]);
-          fpair = factor_lj*forcelj/rsq;
-          if (rsq < cut_in_on_sq) {
-            rsw = (sqrt(rsq) - cut_in_off)/cut_in_diff;
-            fpair *= rsw*rsw*(3.0 - 2.0*rsw);
-          }
-
-          f[i][0] += delx*fpair;
-          f[i][1] += dely*fpair;
-          f[i][2] += delz*fpair;
-          if (newton_pair || j < nlocal) {
-            f[j][0] -= delx*fpair;
-            f[j][1] -= dely*fpair;
-            f[j][2] -= delz*fpair;
-          }
-        }
-
-        if (eflag) {
-          r6 = rsq*rsq*rsq;
-          sinv = 1.0/(r6 + asq[itype][jtype]);
-          evdwl = sinv*(lj3[itype][jtype]*sinv-lj4[itype][jtype]) -
-            offset[itype][jtype];
-          evdwl *= factor_lj;
-        }
-
-        if (vflag) {
-          if (rsq <= cut_in_off_sq) {
-            r6 = rsq*rsq*rsq;
-            sinv = 1.0/(r6 + asq[itype][jtype]);
-            forcelj = r6*sinv*sinv*(lj1[itype][jtype]*sinv - lj2[itype][jtype]);
-            fpair = factor_lj*forcelj/rsq;
-          } else if (rsq < cut_in_on_sq)
-            fpair = factor_lj*forcelj/rsq;
-        }
-
-        if (evflag) ev_tally(i,j,nlocal,newton_pair,
-                             evdwl,0.0,fpair,delx,dely,delz);
-
-        if (gridflag)
-          for (int k = 0; k < gridsize; k++) {
-            sinv = 1.0/(r6 + asqn[itype][jtype][k]);
-            evdwl = sinv*(lj3n[itype][jtype][k]*sinv-lj4n[itype][jtype][k]) -
-              offsetn[itype][jtype][k];
-            evdwl *= factor_lj;
-            if (newton_pair || j < nlocal)
-              evdwlnode[k] += evdwl;
-            else
-              evdwlnode[k] += 0.5*evdwl;
-          }
-      }
-    }
-  }
+  compute_policy(LJCutSoftcorePolicy(this),eflag,vflag,OUTER,cut_respa);
 }
 
 /* ----------------------------------------------------------------------
@@ -462,6 +269,19 @@ void PairLJCutSoftcore::allocate()
   memory->create(offset,n+1,n+1,"pair:offset");
 
   memory->create(asq,n+1,n+1,"pair:asq");
+  memory->create(lj1f,n+1,n+1,"pair:lj1f");
+  memory->create(lj2f,n+1,n+1,"pair:lj2f");
+  memory->create(lj3f,n+1,n+1,"pair:lj3f");
+  memory->create(lj4f,n+1,n+1,"pair:lj4f");
+  memory->create(offsetf,n+1,n+1,"pair:offsetf");
+  memory->create(asqf,n+1,n+1,"pair:asqf");
+  for (int i = 1; i <= n; i++)
+    for (int j = 1; j <= n; j++)
+      asqf[i][j] = 0.0;
+  memory->create(dlj3,n+1,n+1,"pair:dlj3");
+  memory->create(dlj4,n+1,n+1,"pair:dlj4");
+  memory->create(dasq,n+1,n+1,"pair:dasq");
+  memory->create(doffset,n+1,n+1,"pair:doffset");
   memory->create(lj3n,n+1,n+1,gridsize,"pair:lj3n");
   memory->create(lj4n,n+1,n+1,gridsize,"pair:lj4n");
   memory->create(asqn,n+1,n+1,gridsize,"pair:asqn");
@@ -528,11 +348,17 @@ void PairLJCutSoftcore::coeff(int narg, char **arg)
 
 void PairLJCutSoftcore::init_style()
 {
-  // request regular or rRESPA neighbor lists
+  // request regular or rRESPA neighbor lists (none in all-pairs mode)
 
   int irequest;
 
-  if (update->whichflag == 1 && strstr(update->integrate_style,"respa")) {
+  double cutmax = 0.0;
+  for (int i = 1; i <= atom->ntypes; i++)
+    for (int j = i; j <= atom->ntypes; j++)
+      if (setflag[i][j]) cutmax = MAX(cutmax,cut[i][j]);
+
+  if (allpairs_mode(cutmax)) irequest = -1;
+  else if (update->whichflag == 1 && strstr(update->integrate_style,"respa")) {
     int respa = 0;
     if (((Respa *) update->integrate)->level_inner >= 0) respa = 1;
     if (((Respa *) update->integrate)->level_middle >= 0) respa = 2;
@@ -569,6 +395,48 @@ void PairLJCutSoftcore::init_style()
   PairSoftcore::init_style();
 
   int n = atom->ntypes;
+
+  // perturbed coefficients of each perturbation node, -1 = unperturbed
+
+  memory->destroy(epertnode);
+  if (npert) {
+    memory->destroy(epsp);
+    memory->create(epsp,n+1,n+1,npert,"pair:epsp");
+    memory->destroy(sigp);
+    memory->create(sigp,n+1,n+1,npert,"pair:sigp");
+    for (int i = 1; i <= n; i++)
+      for (int j = 1; j <= n; j++)
+        for (int k = 0; k < npert; k++)
+          epsp[i][j][k] = sigp[i][j][k] = -1.0;
+    for (int m = 0; m < npentry; m++) {
+      int *e = pentry[m];
+      if (e[1] < 1 || e[2] > n || e[3] < 1 || e[4] > n)
+        error->all(FLERR,"Pair lj/cut/softcore perturbation types are out of range");
+      for (int i = e[1]; i <= e[2]; i++)
+        for (int j = MAX(e[3],i); j <= e[4]; j++) {
+          epsp[i][j][e[0]] = epsp[j][i][e[0]] = pvalue[m][0];
+          sigp[i][j][e[0]] = sigp[j][i][e[0]] = pvalue[m][1];
+        }
+    }
+    memory->destroy(lj3p);
+    memory->create(lj3p,n+1,n+1,npert,"pair:lj3p");
+    memory->destroy(lj4p);
+    memory->create(lj4p,n+1,n+1,npert,"pair:lj4p");
+    memory->destroy(asqp);
+    memory->create(asqp,n+1,n+1,npert,"pair:asqp");
+    memory->destroy(offsetp);
+    memory->create(offsetp,n+1,n+1,npert,"pair:offsetp");
+    memory->destroy(lj3pf);
+    memory->create(lj3pf,n+1,n+1,npert,"pair:lj3pf");
+    memory->destroy(lj4pf);
+    memory->create(lj4pf,n+1,n+1,npert,"pair:lj4pf");
+    memory->destroy(offsetpf);
+    memory->create(offsetpf,n+1,n+1,npert,"pair:offsetpf");
+    memory->destroy(etailp);
+    memory->create(etailp,n+1,n+1,npert,"pair:etailp");
+    memory->create(epertnode,npert,"pair:epertnode");
+  }
+
   memory->grow(lj3n,n+1,n+1,gridsize,"pair:lj3n");
   memory->grow(lj4n,n+1,n+1,gridsize,"pair:lj4n");
   memory->grow(asqn,n+1,n+1,gridsize,"pair:asqn");
@@ -589,6 +457,26 @@ void PairLJCutSoftcore::init_style()
           if (tail_flag) etailnode[k] += (i == j ? 1.0 : 2.0)*etail_ij;
         }
   }
+
+  // full-strength parameters of decoupled pairs:
+  if (decouple || unlinked) {
+    lambda = 1.0;
+    for (int i = 1; i <= n; i++)
+      for (int j = i; j <= n; j++)
+        if (setflag[i][j] || (setflag[i][i] && setflag[j][j])) {
+          init_one(i,j);
+          lj1f[i][j] = lj1f[j][i] = lj1[i][j];
+          lj2f[i][j] = lj2f[j][i] = lj2[i][j];
+          lj3f[i][j] = lj3f[j][i] = lj3[i][j];
+          lj4f[i][j] = lj4f[j][i] = lj4[i][j];
+          offsetf[i][j] = offsetf[j][i] = offset[i][j];
+          for (int k = 0; k < npert; k++) {
+            lj3pf[i][j][k] = lj3pf[j][i][k] = lj3p[i][j][k];
+            lj4pf[i][j][k] = lj4pf[j][i][k] = lj4p[i][j][k];
+            offsetpf[i][j][k] = offsetpf[j][i][k] = offsetp[i][j][k];
+          }
+        }
+  }
   lambda = save;
 }
 
@@ -624,18 +512,11 @@ double PairLJCutSoftcore::atanx_x(double x)
 }
 
 /* ----------------------------------------------------------------------
-   init for one type pair i,j and corresponding j,i
+   coefficients of pair i,j and j,i that depend on lambda
 ------------------------------------------------------------------------- */
 
-double PairLJCutSoftcore::init_one(int i, int j)
+void PairLJCutSoftcore::lambda_coeffs(int i, int j)
 {
-  if (setflag[i][j] == 0) {
-    epsilon[i][j] = mix_energy(epsilon[i][i],epsilon[j][j],
-                               sigma[i][i],sigma[j][j]);
-    sigma[i][j] = mix_distance(sigma[i][i],sigma[j][j]);
-    cut[i][j] = mix_distance(cut[i][i],cut[j][j]);
-  }
-
   double rc = cut[i][j];
   double rc3 = rc*rc*rc;
   double rc6 = rc3*rc3;
@@ -643,18 +524,75 @@ double PairLJCutSoftcore::init_one(int i, int j)
   double sig6 = sig2*sig2*sig2;
   double sig12 = sig6*sig6;
   double eps4 = 4.0 * epsilon[i][j];
-  double efactor = eps4 * pow(lambda,exponent_n);
+  double lam = linked_lambda(i,j);
+  double efactor = eps4 * pow(lam,exponent_n);
 
   lj3[i][j] = lj3[j][i] = efactor * sig12;
   lj4[i][j] = lj4[j][i] = efactor * sig6;
   lj1[i][j] = lj1[j][i] = 12.0 * lj3[i][j];
   lj2[i][j] = lj2[j][i] =  6.0 * lj4[i][j];
-  asq[i][j] = asq[j][i] = alpha*sig6*pow(1.0 - lambda,exponent_p);
+  asq[i][j] = asq[j][i] = alpha*pow(1.0 - lam,exponent_p)*sig6;
+
+  // derivatives with respect to lambda
+
+  double dfactor = exponent_n == 0.0 ? 0.0 :
+    eps4 * exponent_n * pow(lam,exponent_n - 1.0);
+  dlj3[i][j] = dlj3[j][i] = dfactor * sig12;
+  dlj4[i][j] = dlj4[j][i] = dfactor * sig6;
+  dasq[i][j] = dasq[j][i] = exponent_p == 0.0 ? 0.0 :
+    -alpha*sig6*exponent_p*pow(1.0 - lam,exponent_p - 1.0);
 
   if (offset_flag && (cut[i][j] > 0.0)) {
     double rc6inv = 1.0/(rc6 + asq[i][j]);
     offset[i][j] = offset[j][i] = rc6inv*(lj3[i][j]*rc6inv - lj4[i][j]);
-  } else offset[i][j] = 0.0;
+    doffset[i][j] = doffset[j][i] = rc6inv*(dlj3[i][j]*rc6inv - dlj4[i][j]) -
+      rc6inv*rc6inv*(2.0*lj3[i][j]*rc6inv - lj4[i][j])*dasq[i][j];
+  } else offset[i][j] = doffset[i][j] = 0.0;
+}
+
+/* ----------------------------------------------------------------------
+   init for one type pair i,j and corresponding j,i
+------------------------------------------------------------------------- */
+
+double PairLJCutSoftcore::init_one(int i, int j)
+{
+  if (setflag[i][j] == 0) {
+    epsilon[i][j] = mix_energy(epsilon[i][i],epsilon[j][j],
+                               sigma[i][i],sigma[j][j]);
+    sigma[i][j] = mix_distance(sigma[i][i],sigma[j][j]);
+    cut[i][j] = mix_distance(cut[i][i],cut[j][j]);
+  }
+
+  lambda_coeffs(i,j);
+
+  double rc = cut[i][j];
+  double rc3 = rc*rc*rc;
+  double rc6 = rc3*rc3;
+  double sig2 = sigma[i][j]*sigma[i][j];
+  double sig6 = sig2*sig2*sig2;
+  double lam = linked_lambda(i,j);
+  double lfactor = pow(lam,exponent_n);
+  double afactor = alpha*pow(1.0 - lam,exponent_p);
+  double efactor = 4.0 * epsilon[i][j] * lfactor;
+
+  // coefficients of each perturbation node at the current lambda
+
+  for (int k = 0; k < npert; k++) {
+    double eps_k,sig_k;
+    perturbed(i,j,k,eps_k,sig_k);
+    double sig6_k = pow(sig_k,6.0);
+    double efactor_k = 4.0*eps_k*lfactor;
+    lj3p[i][j][k] = lj3p[j][i][k] = efactor_k*sig6_k*sig6_k;
+    lj4p[i][j][k] = lj4p[j][i][k] = efactor_k*sig6_k;
+    asqp[i][j][k] = asqp[j][i][k] = afactor*sig6_k;
+    if (offset_flag && (cut[i][j] > 0.0)) {
+      double rc6inv = 1.0/(rc6 + asqp[i][j][k]);
+      offsetp[i][j][k] = offsetp[j][i][k] =
+        rc6inv*(lj3p[i][j][k]*rc6inv - lj4p[i][j][k]);
+    } else offsetp[i][j][k] = offsetp[j][i][k] = 0.0;
+    etailp[i][j][k] = etailp[j][i][k] = tail_flag ?
+      tail_energy(i,j,lj3p[i][j][k],lj4p[i][j][k],asqp[i][j][k]) : 0.0;
+  }
 
   // check interior rRESPA cutoff
 
@@ -662,21 +600,10 @@ double PairLJCutSoftcore::init_one(int i, int j)
     error->all(FLERR,"Pair cutoff < Respa interior cutoff");
 
   // compute I,J contribution to long-range tail correction
-  // count total # of atoms of type I and J via Allreduce
+  // total # of atoms of each type was counted in init_style()
 
   if (tail_flag) {
-    int *type = atom->type;
-    int nlocal = atom->nlocal;
-
-    double count[2],all[2];
-    count[0] = count[1] = 0.0;
-    for (int k = 0; k < nlocal; k++) {
-      if (type[k] == i) count[0] += 1.0;
-      if (type[k] == j) count[1] += 1.0;
-    }
-    MPI_Allreduce(count,all,2,MPI_DOUBLE,MPI_SUM,world);
-
-    double TwoPiNiNj = 2.0*MY_PI*all[0]*all[1];
+    double TwoPiNiNj = 2.0*MY_PI*typecount[i]*typecount[j];
     double fe, ge, fw, gw;
     if (asq[i][j] == 0.0)
       fe = ge = fw = gw = 1.0;
@@ -698,6 +625,114 @@ double PairLJCutSoftcore::init_one(int i, int j)
   return cut[i][j];
 }
 
+/* ----------------------------------------------------------------------
+   Epsilon and sigma of pair i,j at perturbation node k. Pairs without
+   explicit coefficients are mixed from the (perturbed) like pairs.
+------------------------------------------------------------------------- */
+
+void PairLJCutSoftcore::perturbed(int i, int j, int k,
+                                  double &eps, double &sig)
+{
+  if (epsp[i][j][k] >= 0.0) {
+    eps = epsp[i][j][k];
+    sig = sigp[i][j][k];
+  }
+  else if (setflag[i][j] == 0) {
+    double epsi = epsp[i][i][k] >= 0.0 ? epsp[i][i][k] : epsilon[i][i];
+    double sigi = epsp[i][i][k] >= 0.0 ? sigp[i][i][k] : sigma[i][i];
+    double epsj = epsp[j][j][k] >= 0.0 ? epsp[j][j][k] : epsilon[j][j];
+    double sigj = epsp[j][j][k] >= 0.0 ? sigp[j][j][k] : sigma[j][j];
+    eps = mix_energy(epsi,epsj,sigi,sigj);
+    sig = mix_distance(sigi,sigj);
+  }
+  else {
+    eps = epsilon[i][j];
+    sig = sigma[i][j];
+  }
+}
+
+/* ----------------------------------------------------------------------
+   Tail correction energy of pair i,j with coefficients a, b and asq
+------------------------------------------------------------------------- */
+
+double PairLJCutSoftcore::tail_energy(int i, int j, double a, double b,
+                                      double asq_ij)
+{
+  double rc3 = cut[i][j]*cut[i][j]*cut[i][j];
+  double fe, ge;
+  if (asq_ij == 0.0)
+    fe = ge = 1.0;
+  else {
+    double x = sqrt(asq_ij)/rc3;
+    double x2 = x*x;
+    fe = atanx_x( x );
+    ge = 1.5*(fe - 1.0/(1.0 + x2))/x2;
+  }
+  double b6 = b/(3.0*rc3);
+  double b12 = a/(9.0*rc3*rc3*rc3);
+  return 2.0*MY_PI*typecount[i]*typecount[j]*(b12*ge - b6*fe);
+}
+
+/* ----------------------------------------------------------------------
+   Total tail correction energy at perturbation node k
+------------------------------------------------------------------------- */
+
+double PairLJCutSoftcore::perturb_tail(int k)
+{
+  double etail = 0.0;
+  int n = atom->ntypes;
+  for (int i = 1; i <= n; i++)
+    for (int j = i; j <= n; j++)
+      if (setflag[i][j] || (setflag[i][i] && setflag[j][j]))
+        etail += (i == j ? 1.0 : 2.0)*etailp[i][j][k];
+  return etail;
+}
+
+/* ----------------------------------------------------------------------
+   pair_modify perturb M I1 J1 eps1 sigma1 ... IM JM epsM sigmaM
+   appends a perturbation node. pair_modify perturb none removes all.
+   Other keywords are handled by the parent class.
+------------------------------------------------------------------------- */
+
+void PairLJCutSoftcore::modify_params(int narg, char **arg)
+{
+  int ns = 0;
+  int iarg = 0;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"perturb") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal pair_modify command");
+      if (strcmp(arg[iarg+1],"none") == 0) {
+        npert = npentry = 0;
+        iarg += 2;
+        continue;
+      }
+      int m = force->inumeric(FLERR,arg[iarg+1]);
+      if (m < 1 || iarg+2+4*m > narg)
+        error->all(FLERR,"Illegal pair_modify command");
+      if (!allocated) allocate();
+      memory->grow(pentry,npentry+m,5,"pair:pentry");
+      memory->grow(pvalue,npentry+m,2,"pair:pvalue");
+      for (int q = 0; q < m; q++) {
+        char **a = &arg[iarg+2+4*q];
+        int *e = pentry[npentry];
+        e[0] = npert;
+        force->bounds(FLERR,a[0],atom->ntypes,e[1],e[2]);
+        force->bounds(FLERR,a[1],atom->ntypes,e[3],e[4]);
+        pvalue[npentry][0] = force->numeric(FLERR,a[2]);
+        pvalue[npentry][1] = force->numeric(FLERR,a[3]);
+        if (pvalue[npentry][0] < 0.0 || pvalue[npentry][1] <= 0.0)
+          error->all(FLERR,"Illegal pair_modify command");
+        npentry++;
+      }
+      npert++;
+      iarg += 2+4*m;
+    }
+    else arg[ns++] = arg[iarg++];
+  }
+
+  if (ns > 0) PairSoftcore::modify_params(ns,arg);
+}
+
 /* ----------------------------------------------------------------------
    proc 0 writes to restart file
 ------------------------------------------------------------------------- */
@@ -806,15 +841,25 @@ double PairLJCutSoftcore::single(int i, int j, int itype, int jtype, double rsq,
                          double factor_coul, double factor_lj,
                          double &fforce)
 {
+  int c = full_strength(i,j,itype,jtype,atom->molecule,atom->mask);
+
+  // parameters of lambda-coupled (0) and full-strength (1) pairs
+  double **lj1c[2] = {lj1,lj1f};
+  double **lj2c[2] = {lj2,lj2f};
+  double **lj3c[2] = {lj3,lj3f};
+  double **lj4c[2] = {lj4,lj4f};
+  double **asqc[2] = {asq,asqf};
+  double **offsetc[2] = {offset,offsetf};
+
   double r6,sinv,forcelj,philj;
 
   r6 = rsq*rsq*rsq;
-  sinv = 1.0/(r6 + asq[itype][jtype]);
-  forcelj = r6*sinv*sinv*(lj1[itype][jtype]*sinv - lj2[itype][jtype]);
+  sinv = 1.0/(r6 + asqc[c][itype][jtype]);
+  forcelj = r6*sinv*sinv*(lj1c[c][itype][jtype]*sinv - lj2c[c][itype][jtype]);
   fforce = factor_lj*forcelj/rsq;
 
-  philj = sinv*(lj3[itype][jtype]*sinv-lj4[itype][jtype]) -
-    offset[itype][jtype];
+  philj = sinv*(lj3c[c][itype][jtype]*sinv-lj4c[c][itype][jtype]) -
+    offsetc[c][itype][jtype];
   return factor_lj*philj;
 }
 
@@ -827,3 +872,48 @@ void *PairLJCutSoftcore::extract(const char *str, int &dim)
   if (strcmp(str,"sigma") == 0) return (void *) sigma;
   return NULL;
 }
+
+/* ----------------------------------------------------------------------
+   energy-only kernel of a virtual atom of type itype at xi
+------------------------------------------------------------------------- */
+
+void PairLJCutSoftcore::test_energy(int itype, double *xi, int n, int *jlist,
+                                    int **active, double *e)
+{
+  int j,jj,k,jtype;
+  double delx,dely,delz,rsq,r6,sinv,evdwl;
+
+  double **x = atom->x;
+  int *type = atom->type;
+
+  for (jj = 0; jj < n; jj++) {
+    j = jlist[jj];
+    jtype = type[j];
+    if (active && !active[itype][jtype]) continue;
+    delx = xi[0] - x[j][0];
+    dely = xi[1] - x[j][1];
+    delz = xi[2] - x[j][2];
+    rsq = delx*delx + dely*dely + delz*delz;
+    if (rsq >= cutsq[itype][jtype]) continue;
+
+    r6 = rsq*rsq*rsq;
+    if (unlinked && !linkflag[itype][jtype]) {
+      sinv = 1.0/r6;
+      evdwl = sinv*(lj3f[itype][jtype]*sinv - lj4f[itype][jtype]) -
+        offsetf[itype][jtype];
+      for (k = 0; k < MAX(gridsize,1); k++)
+        e[k] += evdwl;
+    }
+    else if (gridsize)
+      for (k = 0; k < gridsize; k++) {
+        sinv = 1.0/(r6 + asqn[itype][jtype][k]);
+        e[k] += sinv*(lj3n[itype][jtype][k]*sinv - lj4n[itype][jtype][k]) -
+          offsetn[itype][jtype][k];
+      }
+    else {
+      sinv = 1.0/(r6 + asq[itype][jtype]);
+      e[0] += sinv*(lj3[itype][jtype]*sinv - lj4[itype][jtype]) -
+        offset[itype][jtype];
+    }
+  }
+}
@@ -25,6 +25,8 @@ PairStyle(lj/cut/softcore,PairLJCutSoftcore)
 namespace LAMMPS_NS {
 
 class PairLJCutSoftcore : public PairSoftcore {
+ friend struct LJCutSoftcorePolicy;
+
  public:
   PairLJCutSoftcore(class LAMMPS *);
   virtual ~PairLJCutSoftcore();
@@ -34,6 +36,7 @@ class PairLJCutSoftcore : public PairSoftcore {
   void init_style();
   void init_list(int, class NeighList *);
   double init_one(int, int);
+  void lambda_coeffs(int, int);
   void write_restart(FILE *);
   void read_restart(FILE *);
   void write_restart_settings(FILE *);
@@ -42,6 +45,9 @@ class PairLJCutSoftcore : public PairSoftcore {
   void write_data_all(FILE *);
   double single(int, int, int, int, double, double, double, double &);
   void *extract(const char *, int &);
+  void test_energy(int, double *, int, int *, int **, double *);
+  void modify_params(int, char **);
+  double perturb_tail(int);
 
   void compute_inner();
   void compute_middle();
@@ -58,7 +64,22 @@ class PairLJCutSoftcore : public PairSoftcore {
 
   double **asq;
   double ***lj3n,***lj4n,***asqn,***offsetn;
+  double **lj1f,**lj2f,**lj3f,**lj4f,**offsetf,**asqf;  // full-strength parameters
+  double **dlj3,**dlj4,**dasq,**doffset;              // lambda derivatives
   double atanx_x(double x);
+
+  // perturbation entries: node, ilo, ihi, jlo, jhi and epsilon, sigma
+
+  int npentry;
+  int **pentry;
+  double **pvalue;
+
+  double ***epsp,***sigp;                    // perturbed coeffs (-1 = none)
+  double ***lj3p,***lj4p,***asqp,***offsetp; // at the current lambda
+  double ***lj3pf,***lj4pf,***offsetpf;      // at full strength
+  double ***etailp;                          // tail correction of each pair
+  void perturbed(int, int, int, double &, double &);
+  double tail_energy(int, int, double, double, double);
 };
 
 }
@@ -78,6 +99,10 @@ E: Incorrect args for pair coefficients
 
 Self-explanatory.  Check the input script or data file.
 
+E: Pair lj/cut/softcore perturbation types are out of range
+
+The type pairs of a perturbation node must be valid atom types.
+
 E: Pair cutoff < Respa interior cutoff
 
 One or more pairwise cutoffs are too short to use with the specified
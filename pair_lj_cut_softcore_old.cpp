@@ -108,7 +108,7 @@ void PairLJCutSoftcoreOld::compute(int eflag, int vflag)
   }
 
   double **x = atom->x;
-  double **f = atom->f;
+  double **f = force_target();
   int *type = atom->type;
   int nlocal = atom->nlocal;
   double *special_lj = force->special_lj;
@@ -283,6 +283,19 @@ void PairLJCutSoftcoreOld::coeff(int narg, char **arg)
 
 void PairLJCutSoftcoreOld::init_style()
 {
+  // options of the softcore base class that the kernels of this style
+  // do not implement:
+  if (decouple != NONE)
+    error->all(FLERR,"Pair lj/cut/softcore/old does not support pair_modify decouple");
+  if (ghost_grid != HALF)
+    error->all(FLERR,"Pair lj/cut/softcore/old does not support pair_modify ghost_grid");
+  if (kernel != AUTO)
+    error->all(FLERR,"Pair lj/cut/softcore/old does not support pair_modify kernel");
+  if (allpairs)
+    error->all(FLERR,"Pair lj/cut/softcore/old does not support pair_modify allpairs");
+  if (npert)
+    error->all(FLERR,"Pair lj/cut/softcore/old does not support pair_modify perturb");
+
   // request regular neighbor lists
   neighbor->request(this);
 
@@ -86,4 +86,26 @@ E: Pair cutoff < Respa interior cutoff
 One or more pairwise cutoffs are too short to use with the specified
 rRESPA cutoffs.
 
+E: Pair lj/cut/softcore/old does not support pair_modify decouple
+
+Intramolecular decoupling is only implemented by the newer softcore
+pair styles, e.g. lj/cut/softcore.
+
+E: Pair lj/cut/softcore/old does not support pair_modify ghost_grid
+
+Grid energies of this style always split pairs shared by two procs
+in half.
+
+E: Pair lj/cut/softcore/old does not support pair_modify kernel
+
+This style has a single kernel, so no kernel can be selected.
+
+E: Pair lj/cut/softcore/old does not support pair_modify allpairs
+
+This style always uses neighbor lists.
+
+E: Pair lj/cut/softcore/old does not support pair_modify perturb
+
+Perturbation nodes are only implemented by lj/cut/softcore.
+
 */
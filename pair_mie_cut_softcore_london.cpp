@@ -28,6 +28,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "pair_mie_cut_softcore_london.h"
+#include "pair_softcore_kernel.h"
 #include "atom.h"
 #include "comm.h"
 #include "force.h"
@@ -50,6 +51,9 @@ PairMieCutSoftcoreLondon::PairMieCutSoftcoreLondon(LAMMPS *lmp) : PairSoftcore(l
 {
   respa_enable = 1;
   writedata = 1;
+  dudl_enable = 1;
+  test_enable = 1;
+  lambda_enable = 1;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -71,384 +75,133 @@ PairMieCutSoftcoreLondon::~PairMieCutSoftcoreLondon()
     memory->destroy(offset);
 
     memory->destroy(asq);
+    memory->destroy(mie2f);
+    memory->destroy(offsetf);
+    memory->destroy(asqf);
+
+    memory->destroy(dmie2);
+    memory->destroy(dasq);
+    memory->destroy(doffset);
   }
 }
 
-/* ---------------------------------------------------------------------- */
+/* ----------------------------------------------------------------------
+   Mie softcore policy of the shared kernels, attractive exponent 6
+   (see pair_softcore_kernel.h)
+------------------------------------------------------------------------- */
 
-void PairMieCutSoftcoreLondon::compute(int eflag, int vflag)
-{
-  int i,j,k,ii,jj,inum,jnum,itype,jtype;
-  double xtmp,ytmp,ztmp,delx,dely,delz,evdwl,fpair;
-  double rsq,ratio,sinvc,rgamA,forcemie,factor_mie,sinvcRA;
-  int *ilist,*jlist,*numneigh,**firstneigh;
+namespace LAMMPS_NS {
+
+struct MieCutSoftcoreLondonPolicy {
+  enum {NP = 5};
+  int gridsize;
+  double **mie1,**mie2c[2],**mie3,**gamR,**asqc[2],**offsetc[2];
+  double **mie2,**dmie2,**dasq,**doffset;
+  double ***mie1n,***mie2n,***mie3n,***asqn,***offsetn;
+
+  MieCutSoftcoreLondonPolicy(PairMieCutSoftcoreLondon *pair) {
+    gridsize = pair->gridsize;
+    mie1 = pair->mie1;
+    mie2c[0] = pair->mie2; mie2c[1] = pair->mie2f;
+    mie3 = pair->mie3;
+    gamR = pair->gamR;
+    asqc[0] = pair->asq; asqc[1] = pair->asqf;
+    offsetc[0] = pair->offset; offsetc[1] = pair->offsetf;
+    mie2 = pair->mie2; dmie2 = pair->dmie2;
+    dasq = pair->dasq; doffset = pair->doffset;
+    mie1n = pair->mie1n; mie2n = pair->mie2n; mie3n = pair->mie3n;
+    asqn = pair->asqn; offsetn = pair->offsetn;
+  }
 
-  if (gridflag) for (i = 0; i < gridsize; i++) evdwlnode[i] = 0.0;
+  double eval(int itype, int jtype, int c, double rsq, int eflag,
+              double &evdwl) const {
+    double ratio = rsq*rsq*rsq/mie1[itype][jtype];
+    double sinvc = 1.0/(ratio + asqc[c][itype][jtype]);
+    double sinvcRA = pow(sinvc,mie3[itype][jtype]);
+    if (eflag)
+      evdwl = mie2c[c][itype][jtype]*(sinvcRA - sinvc) -
+        offsetc[c][itype][jtype];
+    return mie2c[c][itype][jtype]*sinvc*ratio*
+      (gamR[itype][jtype]*sinvcRA - 6.0*sinvc)/rsq;
+  }
 
-  evdwl = 0.0;
-  if (eflag || vflag) ev_setup(eflag,vflag);
-  else evflag = vflag_fdotr = 0;
+  double dudl(int itype, int jtype, double rsq) const {
+    double ratio = rsq*rsq*rsq/mie1[itype][jtype];
+    double sinvc = 1.0/(ratio + asqc[0][itype][jtype]);
+    double sinvcRA = pow(sinvc,mie3[itype][jtype]);
+    return dmie2[itype][jtype]*(sinvcRA - sinvc) +
+      mie2[itype][jtype]*sinvc*(sinvc - mie3[itype][jtype]*sinvcRA)*
+      dasq[itype][jtype] - doffset[itype][jtype];
+  }
 
-  double **x = atom->x;
-  double **f = atom->f;
-  int *type = atom->type;
-  int nlocal = atom->nlocal;
-  double *special_mie = force->special_lj;
-  int newton_pair = force->newton_pair;
-
-  inum = list->inum;
-  ilist = list->ilist;
-  numneigh = list->numneigh;
-  firstneigh = list->firstneigh;
-
-  // loop over neighbors of my atoms
-
-  for (ii = 0; ii < inum; ii++) {
-    i = ilist[ii];
-    xtmp = x[i][0];
-    ytmp = x[i][1];
-    ztmp = x[i][2];
-    itype = type[i];
-    jlist = firstneigh[i];
-    jnum = numneigh[i];
-
-    for (jj = 0; jj < jnum; jj++) {
-      j = jlist[jj];
-      factor_mie = special_mie[sbmask(j)];
-      j &= NEIGHMASK;
-
-      delx = xtmp - x[j][0];
-      dely = ytmp - x[j][1];
-      delz = ztmp - x[j][2];
-      rsq = delx*delx + dely*dely + delz*delz;
-      jtype = type[j];
-
-      if (rsq < cutsq[itype][jtype]) {
-
-        rgamA = rsq*rsq*rsq;
-        ratio = rgamA / mie1[itype][jtype];
-        sinvc = 1.0 / (ratio + asq[itype][jtype]);
-        sinvcRA = pow(sinvc,mie3[itype][jtype]);
-        forcemie = mie2[itype][jtype] * sinvc * ratio *
-            (gamR[itype][jtype]*sinvcRA - 6.0*sinvc);
-        fpair = factor_mie*forcemie/rsq;
-
-        f[i][0] += delx*fpair;
-        f[i][1] += dely*fpair;
-        f[i][2] += delz*fpair;
-        if (newton_pair || j < nlocal) {
-          f[j][0] -= delx*fpair;
-          f[j][1] -= dely*fpair;
-          f[j][2] -= delz*fpair;
-        }
+  void nodes(int itype, int jtype, int c, double rsq, double w,
+             double *e) const {
+    double rgamA = rsq*rsq*rsq;
+    if (c) {
+      double sinvc = mie1[itype][jtype]/rgamA;
+      double evdwl = w*(mie2c[1][itype][jtype]*
+        (pow(sinvc,mie3[itype][jtype]) - sinvc) - offsetc[1][itype][jtype]);
+      for (int k = 0; k < gridsize; k++) e[k] += evdwl;
+      return;
+    }
+    double *m1 = mie1n[itype][jtype], *m2 = mie2n[itype][jtype];
+    double *m3 = mie3n[itype][jtype], *asq = asqn[itype][jtype];
+    double *offset = offsetn[itype][jtype];
+    for (int k = 0; k < gridsize; k++) {
+      double sinvc = 1.0/(rgamA/m1[k] + asq[k]);
+      e[k] += w*(m2[k]*(pow(sinvc,m3[k]) - sinvc) - offset[k]);
+    }
+  }
 
-        if (eflag) {
-           evdwl = factor_mie*(mie2[itype][jtype]*
-            (sinvcRA-sinvc)-offset[itype][jtype]);
-        }
+  void pert(int, int, int, double, double, double *) const {}
 
-        if (evflag) ev_tally(i,j,nlocal,newton_pair,
-                             evdwl,0.0,fpair,delx,dely,delz);
-
-        if (gridflag)
-          for (int k = 0; k < gridsize; k++) {
-           ratio = rgamA / mie1n[itype][jtype][k];
-           sinvc = 1.0 / (ratio + asqn[itype][jtype][k]);
-           evdwl = factor_mie*(mie2n[itype][jtype][k]*
-                (pow(sinvc,mie3n[itype][jtype][k])-sinvc)-offsetn[itype][jtype][k]);
-            if (newton_pair || j < nlocal)
-              evdwlnode[k] += evdwl;
-            else
-              evdwlnode[k] += 0.5*evdwl;
-          }
-      }
-    }
+  void gather(int itype, int jtype, int c, double **p, int n) const {
+    p[0][n] = mie1[itype][jtype];
+    p[1][n] = mie2c[c][itype][jtype];
+    p[2][n] = mie3[itype][jtype];
+    p[3][n] = gamR[itype][jtype];
+    p[4][n] = asqc[c][itype][jtype];
   }
 
-  if (vflag_fdotr) virial_fdotr_compute();
+  void fpair(int n, double *rsq, double *fc, double **p) const {
+    double *m1 = p[0], *m2 = p[1], *m3 = p[2], *gR = p[3], *asq = p[4];
+    for (int k = 0; k < n; k++) {
+      double ratio = rsq[k]*rsq[k]*rsq[k]/m1[k];
+      double sinvc = 1.0/(ratio + asq[k]);
+      rsq[k] = fc[k]*m2[k]*sinvc*ratio*
+        (gR[k]*pow(sinvc,m3[k]) - 6.0*sinvc)/rsq[k];
+    }
+  }
+};
 
-  uptodate = gridflag;
-  gridflag = 0;
 }
 
 /* ---------------------------------------------------------------------- */
 
-void PairMieCutSoftcoreLondon::compute_inner()
+void PairMieCutSoftcoreLondon::compute(int eflag, int vflag)
 {
-  int i,j,ii,jj,inum,jnum,itype,jtype;
-  double xtmp,ytmp,ztmp,delx,dely,delz,fpair;
-  double rsq,ratio,sinvc,rgamA,forcemie,factor_mie,rsw;
-  int *ilist,*jlist,*numneigh,**firstneigh;
+  compute_policy(MieCutSoftcoreLondonPolicy(this),eflag,vflag,NORESPA,NULL);
+}
 
-  double **x = atom->x;
-  double **f = atom->f;
-  int *type = atom->type;
-  int nlocal = atom->nlocal;
-  double *special_mie = force->special_lj;
-  int newton_pair = force->newton_pair;
-
-  inum = listinner->inum;
-  ilist = listinner->ilist;
-  numneigh = listinner->numneigh;
-  firstneigh = listinner->firstneigh;
-
-  double cut_out_on = cut_respa[0];
-  double cut_out_off = cut_respa[1];
-
-  double cut_out_diff = cut_out_off - cut_out_on;
-  double cut_out_on_sq = cut_out_on*cut_out_on;
-  double cut_out_off_sq = cut_out_off*cut_out_off;
-
-  // loop over neighbors of my atoms
-
-  for (ii = 0; ii < inum; ii++) {
-    i = ilist[ii];
-    xtmp = x[i][0];
-    ytmp = x[i][1];
-    ztmp = x[i][2];
-    itype = type[i];
-    jlist = firstneigh[i];
-    jnum = numneigh[i];
-
-    for (jj = 0; jj < jnum; jj++) {
-      j = jlist[jj];
-      factor_mie = special_mie[sbmask(j)];
-      j &= NEIGHMASK;
-
-      delx = xtmp - x[j][0];
-      dely = ytmp - x[j][1];
-      delz = ztmp - x[j][2];
-      rsq = delx*delx + dely*dely + delz*delz;
-
-      if (rsq < cut_out_off_sq) {
-        rgamA = rsq*rsq*rsq;
-        ratio = rgamA / mie1[itype][jtype]; 
-        sinvc = 1.0 / (ratio + asq[itype][jtype]);
-        forcemie = mie2[itype][jtype] * sinvc * ratio *
-            (gamR[itype][jtype]*pow(sinvc, mie3[itype][jtype]) -
-        6.0*sinvc);
-        fpair = factor_mie*forcemie/rsq;
-        if (rsq > cut_out_on_sq) {
-          rsw = (sqrt(rsq) - cut_out_on)/cut_out_diff;
-          fpair *= 1.0 - rsw*rsw*(3.0 - 2.0*rsw);
-        }
+/* ---------------------------------------------------------------------- */
 
-        f[i][0] += delx*fpair;
-        f[i][1] += dely*fpair;
-        f[i][2] += delz*fpair;
-        if (newton_pair || j < nlocal) {
-          f[j][0] -= delx*fpair;
-          f[j][1] -= dely*fpair;
-          f[j][2] -= delz*fpair;
-        }
-      }
-    }
-  }
+void PairMieCutSoftcoreLondon::compute_inner()
+{
+  compute_policy(MieCutSoftcoreLondonPolicy(this),0,0,INNER,cut_respa);
 }
 
 /* ---------------------------------------------------------------------- */
 
 void PairMieCutSoftcoreLondon::compute_middle()
 {
-  int i,j,ii,jj,inum,jnum,itype,jtype;
-  double xtmp,ytmp,ztmp,delx,dely,delz,fpair;
-  double rsq,ratio,sinvc,rgamA,forcemie,factor_mie,rsw;
-  int *ilist,*jlist,*numneigh,**firstneigh;
-
-  double **x = atom->x;
-  double **f = atom->f;
-  int *type = atom->type;
-  int nlocal = atom->nlocal;
-  double *special_mie = force->special_lj;
-  int newton_pair = force->newton_pair;
-
-  inum = listmiddle->inum;
-  ilist = listmiddle->ilist;
-  numneigh = listmiddle->numneigh;
-  firstneigh = listmiddle->firstneigh;
-
-  double cut_in_off = cut_respa[0];
-  double cut_in_on = cut_respa[1];
-  double cut_out_on = cut_respa[2];
-  double cut_out_off = cut_respa[3];
-
-  double cut_in_diff = cut_in_on - cut_in_off;
-  double cut_out_diff = cut_out_off - cut_out_on;
-  double cut_in_off_sq = cut_in_off*cut_in_off;
-  double cut_in_on_sq = cut_in_on*cut_in_on;
-  double cut_out_on_sq = cut_out_on*cut_out_on;
-  double cut_out_off_sq = cut_out_off*cut_out_off;
-
-  // loop over neighbors of my atoms
-
-  for (ii = 0; ii < inum; ii++) {
-    i = ilist[ii];
-    xtmp = x[i][0];
-    ytmp = x[i][1];
-    ztmp = x[i][2];
-    itype = type[i];
-    jlist = firstneigh[i];
-    jnum = numneigh[i];
-
-    for (jj = 0; jj < jnum; jj++) {
-      j = jlist[jj];
-      factor_mie = special_mie[sbmask(j)];
-      j &= NEIGHMASK;
-
-      delx = xtmp - x[j][0];
-      dely = ytmp - x[j][1];
-      delz = ztmp - x[j][2];
-      rsq = delx*delx + dely*dely + delz*delz;
-
-      if (rsq < cut_out_off_sq && rsq > cut_in_off_sq) {
-        rgamA = rsq*rsq*rsq;
-        ratio = rgamA / mie1[itype][jtype]; 
-        sinvc = 1.0 / (ratio + asq[itype][jtype]);
-        forcemie = mie2[itype][jtype] * sinvc * ratio *
-            (gamR[itype][jtype]*pow(sinvc,mie3[itype][jtype]) -
-        6.0*sinvc);
-        fpair = factor_mie*forcemie/rsq;
-        if (rsq < cut_in_on_sq) {
-          rsw = (sqrt(rsq) - cut_in_off)/cut_in_diff;
-          fpair *= rsw*rsw*(3.0 - 2.0*rsw);
-        }
-        if (rsq > cut_out_on_sq) {
-          rsw = (sqrt(rsq) - cut_out_on)/cut_out_diff;
-          fpair *= 1.0 + rsw*rsw*(2.0*rsw - 3.0);
-        }
-
-        f[i][0] += delx*fpair;
-        f[i][1] += dely*fpair;
-        f[i][2] += delz*fpair;
-        if (newton_pair || j < nlocal) {
-          f[j][0] -= delx*fpair;
-          f[j][1] -= dely*fpair;
-          f[j][2] -= delz*fpair;
-        }
-      }
-    }
-  }
+  compute_policy(MieCutSoftcoreLondonPolicy(this),0,0,MIDDLE,cut_respa);
 }
 
 /* ---------------------------------------------------------------------- */
 
 void PairMieCutSoftcoreLondon::compute_outer(int eflag, int vflag)
 {
-  int i,j,ii,jj,inum,jnum,itype,jtype;
-  double xtmp,ytmp,ztmp,delx,dely,delz,evdwl,fpair;
-  double rsq,ratio,sinvc,rgamA,forcemie,factor_mie,rsw;
-  int *ilist,*jlist,*numneigh,**firstneigh;
-
-  if (gridflag) for (i = 0; i < gridsize; i++) evdwlnode[i] = 0.0;
-
-  evdwl = 0.0;
-  if (eflag || vflag) ev_setup(eflag,vflag);
-  else evflag = 0;
-
-  double **x = atom->x;
-  double **f = atom->f;
-  int *type = atom->type;
-  int nlocal = atom->nlocal;
-  double *special_mie = force->special_lj;
-  int newton_pair = force->newton_pair;
-
-  inum = listouter->inum;
-  ilist = listouter->ilist;
-  numneigh = listouter->numneigh;
-  firstneigh = listouter->firstneigh;
-
-  double cut_in_off = cut_respa[2];
-  double cut_in_on = cut_respa[3];
-
-  double cut_in_diff = cut_in_on - cut_in_off;
-  double cut_in_off_sq = cut_in_off*cut_in_off;
-  double cut_in_on_sq = cut_in_on*cut_in_on;
-
-  // loop over neighbors of my atoms
-
-  for (ii = 0; ii < inum; ii++) {
-    i = ilist[ii];
-    xtmp = x[i][0];
-    ytmp = x[i][1];
-    ztmp = x[i][2];
-    itype = type[i];
-    jlist = firstneigh[i];
-    jnum = numneigh[i];
-
-    for (jj = 0; jj < jnum; jj++) {
-      j = jlist[jj];
-      factor_mie = special_mie[sbmask(j)];
-      j &= NEIGHMASK;
-
-      delx = xtmp - x[j][0];
-      dely = ytmp - x[j][1];
-      delz = ztmp - x[j][2];
-      rsq = delx*delx + dely*dely + delz*delz;
-      jtype = type[j];
-
-      if (rsq < cutsq[itype][jtype]) {
-        if (rsq > cut_in_off_sq) {
-          rgamA = rsq*rsq*rsq;
-          ratio = rgamA / mie1[itype][jtype]; 
-          sinvc = 1.0 / (ratio + asq[itype][jtype]);
-          forcemie = mie2[itype][jtype] * sinvc * ratio *
-          (gamR[itype][jtype]*pow(sinvc,mie3[itype][jtype]) -
-          6.0*sinvc);
-          fpair = factor_mie*forcemie/rsq;
-          if (rsq < cut_in_on_sq) {
-            rsw = (sqrt(rsq) - cut_in_off)/cut_in_diff;
-            fpair *= rsw*rsw*(3.0 - 2.0*rsw);
-          }
-
-          f[i][0] += delx*fpair;
-          f[i][1] += dely*fpair;
-          f[i][2] += delz*fpair;
-          if (newton_pair || j < nlocal) {
-            f[j][0] -= delx*fpair;
-            f[j][1] -= dely*fpair;
-            f[j][2] -= delz*fpair;
-          }
-        }
-
-        if (eflag) {
-          rgamA = rsq*rsq*rsq;
-          ratio = rgamA / mie1[itype][jtype];
-          sinvc = 1.0 / (ratio + asq[itype][jtype]);
-          evdwl = factor_mie*(mie2[itype][jtype]*
-                (pow(sinvc,mie3[itype][jtype])-sinvc)-offset[itype][jtype]);
-        }
-
-        if (vflag) {
-          if (rsq <= cut_in_off_sq) {
-            rgamA = rsq*rsq*rsq;
-            ratio = rgamA / mie1[itype][jtype]; 
-            sinvc = 1.0 / (ratio + asq[itype][jtype]);
-            forcemie = mie2[itype][jtype] * sinvc * ratio *
-            (gamR[itype][jtype]*pow(sinvc,mie3[itype][jtype]) -
-            6.0*sinvc);
-            fpair = factor_mie*forcemie/rsq;
-          } else if (rsq < cut_in_on_sq)
-            fpair = factor_mie*forcemie/rsq;
-        }
-
-        if (evflag) ev_tally(i,j,nlocal,newton_pair,
-                             evdwl,0.0,fpair,delx,dely,delz);
-
-        if (gridflag)
-          for (int k = 0; k < gridsize; k++) {
-            rgamA = rsq*rsq*rsq;
-            ratio = rgamA / mie1n[itype][jtype][k];
-            sinvc = 1.0 / (ratio + asqn[itype][jtype][k]);
-            evdwl = factor_mie*(mie2n[itype][jtype][k]*
-              (pow(sinvc,mie3n[itype][jtype][k])-sinvc)-offsetn[itype][jtype][k]);
-            if (newton_pair || j < nlocal)
-              evdwlnode[k] += evdwl;
-            else
-              evdwlnode[k] += 0.5*evdwl;
-          }
-      }
-    }
-  }
+  compute_policy(MieCutSoftcoreLondonPolicy(this),eflag,vflag,OUTER,cut_respa);
 }
 
 /* ----------------------------------------------------------------------
@@ -478,6 +231,15 @@ void PairMieCutSoftcoreLondon::allocate()
   memory->create(offset,n+1,n+1,"pair:offset");
 
   memory->create(asq,n+1,n+1,"pair:asq");
+  memory->create(mie2f,n+1,n+1,"pair:mie2f");
+  memory->create(offsetf,n+1,n+1,"pair:offsetf");
+  memory->create(asqf,n+1,n+1,"pair:asqf");
+  for (int i = 1; i <= n; i++)
+    for (int j = 1; j <= n; j++)
+      asqf[i][j] = 0.0;
+  memory->create(dmie2,n+1,n+1,"pair:dmie2");
+  memory->create(dasq,n+1,n+1,"pair:dasq");
+  memory->create(doffset,n+1,n+1,"pair:doffset");
   memory->create(mie1n,n+1,n+1,gridsize,"pair:mie1n");
   memory->create(mie2n,n+1,n+1,gridsize,"pair:mie2n");
   memory->create(mie3n,n+1,n+1,gridsize,"pair:mie3n");
@@ -547,11 +309,17 @@ void PairMieCutSoftcoreLondon::coeff(int narg, char **arg)
 
 void PairMieCutSoftcoreLondon::init_style()
 {
-  // request regular or rRESPA neighbor lists
+  // request regular or rRESPA neighbor lists (none in all-pairs mode)
 
   int irequest;
 
-  if (update->whichflag == 1 && strstr(update->integrate_style,"respa")) {
+  double cutmax = 0.0;
+  for (int i = 1; i <= atom->ntypes; i++)
+    for (int j = i; j <= atom->ntypes; j++)
+      if (setflag[i][j]) cutmax = MAX(cutmax,cut[i][j]);
+
+  if (allpairs_mode(cutmax)) irequest = -1;
+  else if (update->whichflag == 1 && strstr(update->integrate_style,"respa")) {
     int respa = 0;
     if (((Respa *) update->integrate)->level_inner >= 0) respa = 1;
     if (((Respa *) update->integrate)->level_middle >= 0) respa = 2;
@@ -610,6 +378,18 @@ void PairMieCutSoftcoreLondon::init_style()
           if (tail_flag) etailnode[k] += (i == j ? 1.0 : 2.0)*etail_ij;
         }
   }
+
+  // full-strength parameters of decoupled pairs:
+  if (decouple || unlinked) {
+    lambda = 1.0;
+    for (int i = 1; i <= n; i++)
+      for (int j = i; j <= n; j++)
+        if (setflag[i][j] || (setflag[i][i] && setflag[j][j])) {
+          init_one(i,j);
+          mie2f[i][j] = mie2f[j][i] = mie2[i][j];
+          offsetf[i][j] = offsetf[j][i] = offset[i][j];
+        }
+  }
   lambda = save;
 }
 
@@ -644,13 +424,46 @@ double PairMieCutSoftcoreLondon::atanx_x(double x)
   return s;
 }
 
+/* ----------------------------------------------------------------------
+   coefficients of pair i,j and j,i that depend on lambda
+------------------------------------------------------------------------- */
+
+void PairMieCutSoftcoreLondon::lambda_coeffs(int i, int j)
+{
+  double Cmie,sinvc,ratio,rcA;
+  double lam = linked_lambda(i,j);
+
+  rcA = cut[i][j]*cut[i][j]*cut[i][j]*cut[i][j]*cut[i][j]*cut[i][j];
+  Cmie = (gamR[i][j]/(gamR[i][j]-6.0) *
+                pow((gamR[i][j]/6.0),
+                    (6.0/(gamR[i][j]-6.0))));
+
+  mie2[i][j] = mie2[j][i] = Cmie*epsilon[i][j] * pow(lam,exponent_n);
+  asq[i][j] = asq[j][i] = alpha*pow(1.0-lam,exponent_p);
+
+  // derivatives with respect to lambda
+
+  dmie2[i][j] = dmie2[j][i] = exponent_n == 0.0 ? 0.0 :
+    Cmie*epsilon[i][j]*exponent_n*pow(lam,exponent_n-1.0);
+  dasq[i][j] = dasq[j][i] = exponent_p == 0.0 ? 0.0 :
+    -alpha*exponent_p*pow(1.0-lam,exponent_p-1.0);
+
+  if (offset_flag && (cut[i][j] > 0.0)) {
+    ratio = rcA / mie1[i][j];
+    sinvc = 1.0 / (ratio + asq[i][j]);
+    double sinvcRA = pow(sinvc,mie3[i][j]);
+    offset[i][j] = offset[j][i] = mie2[i][j] * (sinvcRA - sinvc);
+    doffset[i][j] = doffset[j][i] = dmie2[i][j] * (sinvcRA - sinvc) +
+      mie2[i][j]*sinvc*(sinvc - mie3[i][j]*sinvcRA)*dasq[i][j];
+  } else offset[i][j] = doffset[i][j] = 0.0;
+}
+
 /* ----------------------------------------------------------------------
    init for one type pair i,j and corresponding j,i
 ------------------------------------------------------------------------- */
 
 double PairMieCutSoftcoreLondon::init_one(int i, int j)
 {
-  double Cmie,sinvc,ratio,rcA;
   if (setflag[i][j] == 0) {
     epsilon[i][j] = mix_energy(epsilon[i][i],epsilon[j][j],
                                sigma[i][i],sigma[j][j]);
@@ -660,22 +473,10 @@ double PairMieCutSoftcoreLondon::init_one(int i, int j)
   }
 
   gamR[j][i] = gamR[i][j];
-  rcA = cut[i][j]*cut[i][j]*cut[i][j]*cut[i][j]*cut[i][j]*cut[i][j];
-  Cmie = (gamR[i][j]/(gamR[i][j]-6.0) *
-                pow((gamR[i][j]/6.0),
-                    (6.0/(gamR[i][j]-6.0))));
 
   mie1[i][j] = mie1[j][i] = pow(sigma[i][j],6.0);
-  mie2[i][j] = mie2[j][i] = Cmie*epsilon[i][j] * pow(lambda,exponent_n);
   mie3[i][j] = mie3[j][i] = gamR[i][j]/6.0;
-  asq[i][j] = asq[j][i] = alpha*pow(1.0-lambda,exponent_p);
-
-  if (offset_flag && (cut[i][j] > 0.0)) {
-    ratio = rcA / mie1[i][j]; 
-    sinvc = 1.0 / (ratio + asq[i][j]);
-    offset[i][j] = offset[j][i] = mie2[i][j] * 
-                  (pow(sinvc,mie3[i][j]) - sinvc);
-  } else offset[i][j] = 0.0;
+  lambda_coeffs(i,j);
 
   // check interior rRESPA cutoff
 
@@ -796,20 +597,27 @@ double PairMieCutSoftcoreLondon::single(int i, int j, int itype, int jtype, doub
                          double factor_coul, double factor_mie,
                          double &fforce)
 {
+  int c = full_strength(i,j,itype,jtype,atom->molecule,atom->mask);
+
+  // parameters of lambda-coupled (0) and full-strength (1) pairs
+  double **mie2c[2] = {mie2,mie2f};
+  double **asqc[2] = {asq,asqf};
+  double **offsetc[2] = {offset,offsetf};
+
   double forcemie,phimie;
   double sinvc,sinvcRA,rgamA,ratio;
 
     rgamA = rsq*rsq*rsq;
     ratio = rgamA / mie1[itype][jtype]; 
-    sinvc = 1.0 / (ratio + asq[itype][jtype]);
+    sinvc = 1.0 / (ratio + asqc[c][itype][jtype]);
     sinvcRA = pow(sinvc,mie3[itype][jtype]);
-    forcemie = mie2[itype][jtype] * sinvc * ratio *
+    forcemie = mie2c[c][itype][jtype] * sinvc * ratio *
       (gamR[itype][jtype]*sinvcRA - 6.0*sinvc);
 
     fforce = factor_mie*forcemie/rsq;
 
 
-    phimie = mie2[itype][jtype]*(sinvcRA - sinvc) - offset[itype][jtype];
+    phimie = mie2c[c][itype][jtype]*(sinvcRA - sinvc) - offsetc[c][itype][jtype];
 
   return factor_mie*phimie;
 }
@@ -823,3 +631,50 @@ void *PairMieCutSoftcoreLondon::extract(const char *str, int &dim)
   if (strcmp(str,"sigma") == 0) return (void *) sigma;
   return NULL;
 }
+
+/* ----------------------------------------------------------------------
+   energy-only kernel of a virtual atom of type itype at xi
+------------------------------------------------------------------------- */
+
+void PairMieCutSoftcoreLondon::test_energy(int itype, double *xi, int n, int *jlist,
+                                           int **active, double *e)
+{
+  int j,jj,k,jtype;
+  double delx,dely,delz,rsq,rgamA,ratio,sinvc,evdwl;
+
+  double **x = atom->x;
+  int *type = atom->type;
+
+  for (jj = 0; jj < n; jj++) {
+    j = jlist[jj];
+    jtype = type[j];
+    if (active && !active[itype][jtype]) continue;
+    delx = xi[0] - x[j][0];
+    dely = xi[1] - x[j][1];
+    delz = xi[2] - x[j][2];
+    rsq = delx*delx + dely*dely + delz*delz;
+    if (rsq >= cutsq[itype][jtype]) continue;
+
+    rgamA = rsq*rsq*rsq;
+    if (unlinked && !linkflag[itype][jtype]) {
+      sinvc = mie1[itype][jtype] / rgamA;
+      evdwl = mie2f[itype][jtype]*(pow(sinvc,mie3[itype][jtype]) - sinvc) -
+        offsetf[itype][jtype];
+      for (k = 0; k < MAX(gridsize,1); k++)
+        e[k] += evdwl;
+    }
+    else if (gridsize)
+      for (k = 0; k < gridsize; k++) {
+        ratio = rgamA / mie1n[itype][jtype][k];
+        sinvc = 1.0 / (ratio + asqn[itype][jtype][k]);
+        e[k] += mie2n[itype][jtype][k]*(pow(sinvc,mie3n[itype][jtype][k]) -
+          sinvc) - offsetn[itype][jtype][k];
+      }
+    else {
+      ratio = rgamA / mie1[itype][jtype];
+      sinvc = 1.0 / (ratio + asq[itype][jtype]);
+      e[0] += mie2[itype][jtype]*(pow(sinvc,mie3[itype][jtype]) - sinvc) -
+        offset[itype][jtype];
+    }
+  }
+}
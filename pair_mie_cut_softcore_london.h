@@ -25,6 +25,8 @@ PairStyle(mie/cut/softcore/london,PairMieCutSoftcoreLondon)
 namespace LAMMPS_NS {
 
 class PairMieCutSoftcoreLondon : public PairSoftcore {
+ friend struct MieCutSoftcoreLondonPolicy;
+
  public:
   PairMieCutSoftcoreLondon(class LAMMPS *);
   virtual ~PairMieCutSoftcoreLondon();
@@ -34,6 +36,7 @@ class PairMieCutSoftcoreLondon : public PairSoftcore {
   void init_style();
   void init_list(int, class NeighList *);
   double init_one(int, int);
+  void lambda_coeffs(int, int);
   void write_restart(FILE *);
   void read_restart(FILE *);
   void write_restart_settings(FILE *);
@@ -42,6 +45,7 @@ class PairMieCutSoftcoreLondon : public PairSoftcore {
   void write_data_all(FILE *);
   double single(int, int, int, int, double, double, double, double &);
   void *extract(const char *, int &);
+  void test_energy(int, double *, int, int *, int **, double *);
 
   void compute_inner();
   void compute_middle();
@@ -59,6 +63,8 @@ class PairMieCutSoftcoreLondon : public PairSoftcore {
 
   double **asq;
   double ***mie1n,***mie2n,***mie3n,***asqn,***offsetn;
+  double **mie2f,**offsetf,**asqf;  // full-strength parameters
+  double **dmie2,**dasq,**doffset;  // lambda derivatives
   double atanx_x(double x);
 };
 
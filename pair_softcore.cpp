@@ -17,13 +17,29 @@
                         Federal University of Rio de Janeiro, Brazil
 ------------------------------------------------------------------------- */
 
+#include "mpi.h"
 #include "string.h"
 #include "pair_softcore.h"
+#include "pair_hybrid_softcore.h"
 #include "memory.h"
 #include "error.h"
 #include "force.h"
+#include "atom.h"
+#include "comm.h"
+#include "group.h"
+#include "neighbor.h"
+#include "neigh_list.h"
+#include "domain.h"
+#include "update.h"
+#include "math_const.h"
+#include "modify.h"
+#include "compute.h"
 
 using namespace LAMMPS_NS;
+using namespace MathConst;
+
+#define NTUNE 10   // regular steps timed per kernel variant
+#define APRATIO 8.0  // maximum ratio of all-pairs table to neighbor list
 
 /* ---------------------------------------------------------------------- */
 
@@ -37,6 +53,50 @@ PairSoftcore::PairSoftcore(LAMMPS *lmp) : Pair(lmp)
   gridflag = 1;
   gridsize = 0;
   uptodate = 0;
+
+  dudl_enable = 0;
+  test_enable = 0;
+  lambda_enable = 0;
+  dudlflag = 0;
+  edudl = 0.0;
+  typecount = NULL;
+
+  npert = 0;
+  pertflag = 0;
+  epertnode = NULL;
+  pertstep = -1;
+  npertcompute = 0;
+  pertcompute = NULL;
+
+  decouple = NONE;
+  decouple_bit = 0;
+  decouple_id = NULL;
+
+  unlinked = 0;
+  linkflag = NULL;
+
+  ghost_grid = HALF;
+
+  fdest = NULL;
+  nmax_scratch = 0;
+  scratch = NULL;
+
+  maxpack = 0;
+  jpack = NULL;
+  dpack = NULL;
+
+  kernel = AUTO;
+  tuned[FORCES] = tuned[GRID] = -1;
+
+  allpairs = allpairs_on = 0;
+  apstamp = -1;
+  apinum = apmaxatom = apmaxneigh = 0;
+  apilist = apnumneigh = apneigh = NULL;
+  apfirstneigh = NULL;
+
+  gridcomm = MPI_COMM_NULL;
+  gridstamp = -1;
+
   allocate();
 }
 
@@ -49,11 +109,70 @@ PairSoftcore::~PairSoftcore()
   memory->destroy(ecoulnode);
   memory->destroy(ecoulnode);
   memory->destroy(etailnode);
+  delete [] decouple_id;
+  memory->destroy(scratch);
+  memory->destroy(typecount);
+  memory->destroy(epertnode);
+  delete [] pertcompute;
+  memory->destroy(jpack);
+  memory->destroy(dpack);
+  memory->destroy(linkflag);
+  memory->destroy(apilist);
+  memory->destroy(apnumneigh);
+  memory->sfree(apfirstneigh);
+  memory->destroy(apneigh);
+  if (gridcomm != MPI_COMM_NULL) MPI_Comm_free(&gridcomm);
 }
 /* ---------------------------------------------------------------------- */
 
 void PairSoftcore::init_style()
 {
+  // resolve intramolecular/intragroup decoupling:
+  if (decouple == MOLECULE && !atom->molecule_flag)
+    error->all(FLERR,"Pair softcore decouple molecule requires atom attribute molecule");
+  if (decouple == GROUP) {
+    int igroup = group->find(decouple_id);
+    if (igroup == -1)
+      error->all(FLERR,"Could not find pair softcore decouple group ID");
+    decouple_bit = group->bitmask[igroup];
+  }
+  if (ghost_grid == SINGLE && !atom->tag_enable)
+    error->all(FLERR,"Pair softcore ghost_grid single requires atom IDs");
+
+  // check whether any pair of types has been unlinked from lambda:
+  unlinked = 0;
+  if (linkflag)
+    for (int i = 1; i <= atom->ntypes; i++)
+      for (int j = i; j <= atom->ntypes; j++)
+        if (!linkflag[i][j]) unlinked = 1;
+
+  // tail corrections of all type pairs share a single count of atoms,
+  // so that reinit() requires no communication when lambda changes:
+  if (tail_flag) count_types();
+
+  // computes of perturbation energies register again in their init():
+  delete [] pertcompute;
+  pertcompute = new Compute*[modify->ncompute];
+  npertcompute = 0;
+  pertstep = -1;
+
+  // restart the timing of regular-step kernels:
+  for (int i = 0; i < 2; i++) {
+    tuned[i] = -1;
+    tunestep[i] = 0;
+    tunetime[i][SCALAR] = tunetime[i][PACKED] = 0.0;
+  }
+
+  // report the all-pairs mode decided by the derived style:
+  if (allpairs_on && comm->me == 0) {
+    if (screen)
+      fprintf(screen,"Softcore all-pairs mode: no neighbor list for "
+              BIGINT_FORMAT " atoms\n",atom->natoms);
+    if (logfile)
+      fprintf(logfile,"Softcore all-pairs mode: no neighbor list for "
+              BIGINT_FORMAT " atoms\n",atom->natoms);
+  }
+
   // print grid information:
   if ( (gridsize > 0) && (comm->me == 0) ) {
     if (screen) fprintf(screen,"Lambda grid: (");
@@ -78,6 +197,26 @@ void PairSoftcore::allocate()
   memory->create(etailnode,0,"pair_softcore:etailnode");
 }
 
+/* ----------------------------------------------------------------------
+   count the total number of atoms of each type
+------------------------------------------------------------------------- */
+
+void PairSoftcore::count_types()
+{
+  int ntypes = atom->ntypes;
+  int *type = atom->type;
+  int nlocal = atom->nlocal;
+
+  double *count = new double[ntypes+1];
+  for (int i = 0; i <= ntypes; i++) count[i] = 0.0;
+  for (int k = 0; k < nlocal; k++) count[type[k]] += 1.0;
+
+  memory->destroy(typecount);
+  memory->create(typecount,ntypes+1,"pair_softcore:typecount");
+  MPI_Allreduce(count,typecount,ntypes+1,MPI_DOUBLE,MPI_SUM,world);
+  delete [] count;
+}
+
 /* ----------------------------------------------------------------------
    adds a new node to the lambda grid, in increasing order of lambdas
 ------------------------------------------------------------------------- */
@@ -117,7 +256,7 @@ void PairSoftcore::modify_params(int narg, char **arg)
   if (narg == 0)
     error->all(FLERR,"Illegal pair_modify command");
 
-  int nkwds = 6;
+  int nkwds = 12;
   char *keyword[nkwds];
   keyword[0] = (char*)"alpha";
   keyword[1] = (char*)"n";
@@ -125,6 +264,12 @@ void PairSoftcore::modify_params(int narg, char **arg)
   keyword[3] = (char*)"lambda";
   keyword[4] = (char*)"set_grid";
   keyword[5] = (char*)"add_node";
+  keyword[6] = (char*)"decouple";
+  keyword[7] = (char*)"ghost_grid";
+  keyword[8] = (char*)"kernel";
+  keyword[9] = (char*)"link";
+  keyword[10] = (char*)"unlink";
+  keyword[11] = (char*)"allpairs";
 
   int ns = 0;
   int skip[narg];
@@ -167,6 +312,55 @@ void PairSoftcore::modify_params(int narg, char **arg)
       add_node_to_grid(force->numeric(FLERR,arg[iarg+1]));
       iarg += 2;
     }
+    else if (m == 6) { // decouple:
+      if (iarg+2 > narg) error->all(FLERR,"Illegal pair_modify command");
+      if (strcmp(arg[iarg+1],"no") == 0)
+        decouple = NONE;
+      else if (strcmp(arg[iarg+1],"molecule") == 0)
+        decouple = MOLECULE;
+      else if (strcmp(arg[iarg+1],"group") == 0) {
+        if (iarg+3 > narg) error->all(FLERR,"Illegal pair_modify command");
+        decouple = GROUP;
+        delete [] decouple_id;
+        int n = strlen(arg[iarg+2]) + 1;
+        decouple_id = new char[n];
+        strcpy(decouple_id,arg[iarg+2]);
+        iarg++;
+      }
+      else error->all(FLERR,"Illegal pair_modify command");
+      iarg += 2;
+    }
+    else if (m == 7) { // ghost_grid:
+      if (iarg+2 > narg) error->all(FLERR,"Illegal pair_modify command");
+      if (strcmp(arg[iarg+1],"half") == 0)
+        ghost_grid = HALF;
+      else if (strcmp(arg[iarg+1],"single") == 0)
+        ghost_grid = SINGLE;
+      else error->all(FLERR,"Illegal pair_modify command");
+      iarg += 2;
+    }
+    else if (m == 8) { // kernel:
+      if (iarg+2 > narg) error->all(FLERR,"Illegal pair_modify command");
+      if (strcmp(arg[iarg+1],"scalar") == 0)
+        kernel = SCALAR;
+      else if (strcmp(arg[iarg+1],"packed") == 0)
+        kernel = PACKED;
+      else if (strcmp(arg[iarg+1],"auto") == 0)
+        kernel = AUTO;
+      else error->all(FLERR,"Illegal pair_modify command");
+      iarg += 2;
+    }
+    else if (m < 11) { // link or unlink:
+      if (iarg+3 > narg) error->all(FLERR,"Illegal pair_modify command");
+      set_link(arg[iarg+1],arg[iarg+2],m == 9);
+      iarg += 3;
+    }
+    else if (m == 11) { // allpairs:
+      if (iarg+2 > narg) error->all(FLERR,"Illegal pair_modify command");
+      allpairs = force->inumeric(FLERR,arg[iarg+1]);
+      if (allpairs < 0) error->all(FLERR,"Illegal pair_modify command");
+      iarg += 2;
+    }
     else // no keyword found - skip argument:
       skip[ns++] = iarg++;
   }
@@ -185,6 +379,11 @@ void PairSoftcore::write_restart(FILE *fp)
 {
   fwrite(&gridsize,sizeof(int),1,fp);
   fwrite(lambdanode,sizeof(double),gridsize,fp);
+
+  int n = linkflag ? atom->ntypes : 0;
+  fwrite(&n,sizeof(int),1,fp);
+  for (int i = 1; i <= n; i++)
+    fwrite(&linkflag[i][1],sizeof(int),n,fp);
 }
 
 /* ---------------------------------------------------------------------- */
@@ -193,7 +392,493 @@ void PairSoftcore::read_restart(FILE *fp)
 {
   if (comm->me == 0) fread(&gridsize,sizeof(int),1,fp);
   MPI_Bcast(&gridsize,1,MPI_INT,0,world);
-  allocate();
+  memory->grow(lambdanode,gridsize,"pair_softcore:lambdanode");
+  memory->grow(evdwlnode,gridsize,"pair_softcore:evdwlnode");
+  memory->grow(ecoulnode,gridsize,"pair_softcore:ecoulnode");
+  memory->grow(etailnode,gridsize,"pair_softcore:etailnode");
   if (comm->me == 0) fread(lambdanode,sizeof(double),gridsize,fp);
   MPI_Bcast(lambdanode,gridsize,MPI_DOUBLE,0,world);
+
+  int n;
+  if (comm->me == 0) fread(&n,sizeof(int),1,fp);
+  MPI_Bcast(&n,1,MPI_INT,0,world);
+  memory->destroy(linkflag);
+  if (n) {
+    memory->create(linkflag,n+1,n+1,"pair_softcore:linkflag");
+    for (int i = 1; i <= n; i++) {
+      if (comm->me == 0) fread(&linkflag[i][1],sizeof(int),n,fp);
+      MPI_Bcast(&linkflag[i][1],n,MPI_INT,0,world);
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------
+   Link (flag = 1) or unlink (flag = 0) the pairs of types I,J to lambda,
+   where I and J may be type ranges. All pairs are linked by default.
+------------------------------------------------------------------------- */
+
+void PairSoftcore::set_link(char *istr, char *jstr, int flag)
+{
+  int n = atom->ntypes;
+  if (!linkflag) {
+    memory->create(linkflag,n+1,n+1,"pair_softcore:linkflag");
+    for (int i = 0; i <= n; i++)
+      for (int j = 0; j <= n; j++)
+        linkflag[i][j] = 1;
+  }
+
+  int ilo,ihi,jlo,jhi;
+  force->bounds(FLERR,istr,n,ilo,ihi);
+  force->bounds(FLERR,jstr,n,jlo,jhi);
+
+  int count = 0;
+  for (int i = ilo; i <= ihi; i++)
+    for (int j = MAX(jlo,i); j <= jhi; j++) {
+      linkflag[i][j] = linkflag[j][i] = flag;
+      count++;
+    }
+  if (count == 0)
+    error->all(FLERR,"Incorrect args for pair coefficients");
+}
+
+/* ----------------------------------------------------------------------
+   Register a compute of perturbation energies (called by its init)
+------------------------------------------------------------------------- */
+
+void PairSoftcore::add_pert_compute(Compute *c)
+{
+  pertcompute[npertcompute++] = c;
+}
+
+/* ----------------------------------------------------------------------
+   1 if a registered compute will be invoked at the current step
+------------------------------------------------------------------------- */
+
+int PairSoftcore::pert_scheduled()
+{
+  for (int i = 0; i < npertcompute; i++)
+    if (pertcompute[i]->matchstep(update->ntimestep)) return 1;
+  return 0;
+}
+
+/* ----------------------------------------------------------------------
+   Change lambda and the lambda-dependent coefficients of all linked type
+   pairs that were set by the latest init. Tail corrections (etail, ptail)
+   keep their values until the next reinit(). Styles with perturbation
+   nodes are fully reinitialized, since those nodes carry tail energies.
+------------------------------------------------------------------------- */
+
+void PairSoftcore::update_lambda(double value)
+{
+  lambda = value;
+  if (!lambda_enable || npert) {
+    reinit();
+    return;
+  }
+
+  int n = atom->ntypes;
+  for (int i = 1; i <= n; i++)
+    for (int j = i; j <= n; j++) {
+      if (unlinked && !linkflag[i][j]) continue;
+      if (setflag[i][j] || (setflag[i][i] && setflag[j][j]))
+        lambda_coeffs(i,j);
+    }
+}
+
+/* ----------------------------------------------------------------------
+   Compute the interactions of this style with forces written to fout
+   rather than atom->f. If enode is not NULL, the lambda grid is also
+   computed and local node energies are added to it. If vout is not
+   NULL, the global virial is added to it.
+------------------------------------------------------------------------- */
+
+void PairSoftcore::compute_softcore(double **fout, double *enode,
+                                    double *vout, int eflag, int vflag)
+{
+  fdest = fout;
+  gridflag = enode != NULL;
+  compute(eflag,vflag);
+  fdest = NULL;
+
+  if (enode)
+    for (int k = 0; k < gridsize; k++)
+      enode[k] += evdwlnode[k];
+  if (vout && vflag_global)
+    for (int k = 0; k < 6; k++)
+      vout[k] += virial[k];
+}
+
+/* ----------------------------------------------------------------------
+   Return a zeroed force buffer covering owned and ghost atoms. The
+   buffer is owned by this style and reused by every fix or compute that
+   needs a temporary force destination.
+------------------------------------------------------------------------- */
+
+double **PairSoftcore::scratch_forces()
+{
+  int n = atom->nlocal + atom->nghost;
+  if (n > nmax_scratch) {
+    nmax_scratch = atom->nmax;
+    memory->destroy(scratch);
+    memory->create(scratch,nmax_scratch,3,"pair_softcore:scratch");
+  }
+  if (n > 0) memset(&scratch[0][0],0,3*n*sizeof(double));
+  return scratch;
+}
+
+/* ----------------------------------------------------------------------
+   Kernel variant for a regular step of the given type (FORCES or GRID).
+   While tuning, the variants are alternated and the wall time of each
+   step is measured.
+------------------------------------------------------------------------- */
+
+int PairSoftcore::select_kernel(int step)
+{
+  if (kernel != AUTO) return kernel;
+  if (tuned[step] >= 0) return tuned[step];
+  tunestart = MPI_Wtime();
+  return tunestep[step] % 2 ? PACKED : SCALAR;
+}
+
+/* ----------------------------------------------------------------------
+   Called at the end of a regular step. After NTUNE steps of each variant
+   for the step type, the one with the smallest time on the slowest proc
+   is kept for the rest of the run. Must be called by all procs.
+------------------------------------------------------------------------- */
+
+void PairSoftcore::time_kernel(int step, int variant)
+{
+  if (kernel != AUTO || tuned[step] >= 0) return;
+  tunetime[step][variant] += MPI_Wtime() - tunestart;
+  if (++tunestep[step] < 2*NTUNE) return;
+
+  double all[2];
+  MPI_Allreduce(tunetime[step],all,2,MPI_DOUBLE,MPI_MAX,world);
+  tuned[step] = all[PACKED] < all[SCALAR] ? PACKED : SCALAR;
+
+  if (comm->me == 0) {
+    const char *name[2] = {"scalar","packed"};
+    const char *type[2] = {"force-only steps","grid-energy steps"};
+    FILE* unit[2] = {screen,logfile};
+    for (int i = 0; i < 2; i++)
+      if (unit[i])
+        fprintf(unit[i],"Softcore kernel of %s: %s "
+                "(scalar %g ms, packed %g ms per step)\n",type[step],
+                name[tuned[step]],1000.0*all[SCALAR]/NTUNE,
+                1000.0*all[PACKED]/NTUNE);
+  }
+}
+
+/* ----------------------------------------------------------------------
+   Make the packed neighbor arrays hold at least n neighbors
+------------------------------------------------------------------------- */
+
+void PairSoftcore::grow_pack(int n)
+{
+  maxpack = n;
+  memory->destroy(jpack);
+  memory->destroy(dpack);
+  memory->create(jpack,maxpack,"pair_softcore:jpack");
+  memory->create(dpack,6+NPARAM,maxpack,"pair_softcore:dpack");
+}
+
+/* ----------------------------------------------------------------------
+   Return the communicator of the procs owning at least one atom with
+   neighbors in the lists of the given softcore styles. Proc 0 is always
+   included, so that it can act as root of grid reductions. The
+   communicator is rebuilt after every reneighboring and is stored in the
+   style through which it is requested. Must be called by all procs.
+------------------------------------------------------------------------- */
+
+MPI_Comm PairSoftcore::grid_comm(PairSoftcore **pairs, int npairs)
+{
+  if (gridstamp == neighbor->ncalls) return gridcomm;
+
+  int active = comm->me == 0;
+  for (int k = 0; k < npairs && !active; k++) {
+    int inum,*ilist,*numneigh,**firstneigh;
+    pairs[k]->neighbors(inum,ilist,numneigh,firstneigh);
+    for (int ii = 0; ii < inum && !active; ii++)
+      active = numneigh[ilist[ii]] > 0;
+  }
+
+  if (gridcomm != MPI_COMM_NULL) MPI_Comm_free(&gridcomm);
+  MPI_Comm_split(world,active ? 0 : MPI_UNDEFINED,comm->me,&gridcomm);
+  gridstamp = neighbor->ncalls;
+  return gridcomm;
+}
+
+/* ---------------------------------------------------------------------- */
+
+double **PairSoftcore::force_target()
+{
+  return fdest ? fdest : atom->f;
+}
+
+/* ----------------------------------------------------------------------
+   Same as Pair::virial_fdotr_compute(), but using the force destination
+   of the kernels
+------------------------------------------------------------------------- */
+
+void PairSoftcore::virial_fdotr_compute()
+{
+  double **x = atom->x;
+  double **f = force_target();
+  int nall = atom->nlocal + atom->nghost;
+
+  if (neighbor->includegroup == 0) {
+    for (int i = 0; i < nall; i++) {
+      virial[0] += f[i][0]*x[i][0];
+      virial[1] += f[i][1]*x[i][1];
+      virial[2] += f[i][2]*x[i][2];
+      virial[3] += f[i][1]*x[i][0];
+      virial[4] += f[i][2]*x[i][0];
+      virial[5] += f[i][2]*x[i][1];
+    }
+  } else {
+    int nfirst = atom->nfirst;
+    for (int i = 0; i < nfirst; i++) {
+      virial[0] += f[i][0]*x[i][0];
+      virial[1] += f[i][1]*x[i][1];
+      virial[2] += f[i][2]*x[i][2];
+      virial[3] += f[i][1]*x[i][0];
+      virial[4] += f[i][2]*x[i][0];
+      virial[5] += f[i][2]*x[i][1];
+    }
+    for (int i = atom->nlocal; i < nall; i++) {
+      virial[0] += f[i][0]*x[i][0];
+      virial[1] += f[i][1]*x[i][1];
+      virial[2] += f[i][2]*x[i][2];
+      virial[3] += f[i][1]*x[i][0];
+      virial[4] += f[i][2]*x[i][0];
+      virial[5] += f[i][2]*x[i][1];
+    }
+  }
+
+  // prevent multiple calls to update the virial
+
+  vflag_fdotr = 0;
+}
+
+/* ----------------------------------------------------------------------
+   Decide whether the current run uses the all-pairs mode, which requires
+   the system to be small enough, a box not much larger than the cutoff
+   of the style (cutmax), no rRESPA, no neighbor exclusions (applied only
+   by neighbor builds), and, under pair hybrid, the hybrid/softcore style
+   (whose type map selects the pairs of each sub-style). Called by the
+   init_style() of derived styles, which request no neighbor list if it
+   returns 1.
+------------------------------------------------------------------------- */
+
+int PairSoftcore::allpairs_mode(double cutmax)
+{
+  allpairs_on = allpairs > 0 && atom->natoms <= allpairs &&
+    !strstr(update->integrate_style,"respa");
+  if (allpairs_on && atom->molecular == 2)
+    error->all(FLERR,"Pair softcore allpairs does not support template-based molecular systems");
+
+  if (allpairs_on && neighbor->exclude_setting()) {
+    allpairs_on = 0;
+    if (comm->me == 0)
+      error->warning(FLERR,"Pair softcore allpairs is ignored with neigh_modify exclude");
+  }
+  if (allpairs_on && force->pair != this &&
+      !dynamic_cast<PairHybridSoftcore*>(force->pair)) {
+    allpairs_on = 0;
+    if (comm->me == 0)
+      error->warning(FLERR,"Pair softcore allpairs is ignored under pair style hybrid");
+  }
+  if (allpairs_on && allpairs_ratio(cutmax) > APRATIO) {
+    allpairs_on = 0;
+    if (comm->me == 0)
+      error->warning(FLERR,"Pair softcore allpairs is ignored for a box much larger than the cutoff");
+  }
+
+  if (allpairs_on) list = NULL;
+  apstamp = -1;
+  apwarn = 0;
+  return allpairs_on;
+}
+
+/* ----------------------------------------------------------------------
+   Estimated size of the all-pairs table relative to a neighbor list with
+   cutoff cut: volume spanned by the owned and ghost atoms of a proc over
+   the volume of the cutoff sphere, along the dimensions that have ghost
+   atoms (periodic or split among procs). Along the other dimensions, both
+   hold all atoms of the proc.
+------------------------------------------------------------------------- */
+
+double PairSoftcore::allpairs_ratio(double cut)
+{
+  double cutghost = MAX(cut + neighbor->skin,comm->cutghostuser);
+  double ext = 1.0;
+  int n = 0;
+  for (int d = 0; d < domain->dimension; d++)
+    if (domain->periodicity[d] || comm->procgrid[d] > 1) {
+      ext *= domain->prd[d]/comm->procgrid[d] + 2.0*cutghost;
+      n++;
+    }
+  if (n == 0) return 1.0;
+
+  double ball = 2.0*cutghost;
+  if (n == 2) ball = MY_PI*cutghost*cutghost;
+  else if (n == 3) ball = 4.0*MY_PI*cutghost*cutghost*cutghost/3.0;
+  return ext/ball;
+}
+
+/* ----------------------------------------------------------------------
+   Neighbors of owned atoms, either from the neighbor list or from the
+   all-pairs table, which is rebuilt after every neighbor build (that is,
+   whenever atoms may have been exchanged, sorted, or made ghosts)
+------------------------------------------------------------------------- */
+
+void PairSoftcore::neighbors(int &inum, int *&ilist, int *&numneigh,
+                             int **&firstneigh)
+{
+  if (allpairs_on) {
+    if (apstamp != neighbor->ncalls) build_allpairs();
+    inum = apinum;
+    ilist = apilist;
+    numneigh = apnumneigh;
+    firstneigh = apfirstneigh;
+  }
+  else if (list) {
+    inum = list->inum;
+    ilist = list->ilist;
+    numneigh = list->numneigh;
+    firstneigh = list->firstneigh;
+  }
+  else inum = 0;
+}
+
+/* ----------------------------------------------------------------------
+   1-2, 1-3 or 1-4 neighbor (1, 2 or 3) of an atom, 0 if not special
+------------------------------------------------------------------------- */
+
+static int which_special(tagint *list, int *nspecial, tagint tag)
+{
+  for (int k = 0; k < nspecial[2]; k++)
+    if (list[k] == tag)
+      return k < nspecial[0] ? 1 : (k < nspecial[1] ? 2 : 3);
+  return 0;
+}
+
+/* ----------------------------------------------------------------------
+   Build the table of all pairs with the rules of the half/nsq neighbor
+   builds: each owned atom i has all owned atoms j > i and, with newton
+   off, all ghost atoms or, with newton on, the ghost atoms selected by
+   tag parity (or by coordinates for images of itself). Distances are not
+   checked, since the kernels test the cutoff of every pair anyway.
+   Special neighbors are excluded, kept, or tagged with their special bits
+   as in a neighbor list, except for images that are not the closest.
+   Under pair hybrid/softcore, only type pairs mapped to this style are
+   included, like in the skip lists that hybrid requests for sub-styles.
+------------------------------------------------------------------------- */
+
+void PairSoftcore::build_allpairs()
+{
+  int i,j,n,which;
+  tagint itag,jtag;
+
+  double **x = atom->x;
+  int *type = atom->type;
+  tagint *tag = atom->tag;
+  int nlocal = atom->nlocal;
+  int nall = nlocal + atom->nghost;
+  int newton_pair = force->newton_pair;
+  int molecular = atom->molecular;
+  tagint **special = atom->special;
+  int **nspecial = atom->nspecial;
+
+  // special neighbors: 0 = excluded, 1 = plain, 2 = with special bits
+  int sflag[4];
+  for (i = 1; i < 4; i++) {
+    double lj = force->special_lj[i];
+    double coul = force->special_coul[i];
+    if (lj == 0.0 && coul == 0.0) sflag[i] = force->kspace ? 2 : 0;
+    else if (lj == 1.0 && coul == 1.0) sflag[i] = 1;
+    else sflag[i] = 2;
+  }
+
+  if (nlocal > apmaxatom) {
+    apmaxatom = atom->nmax;
+    memory->destroy(apilist);
+    memory->destroy(apnumneigh);
+    memory->sfree(apfirstneigh);
+    memory->create(apilist,apmaxatom,"pair_softcore:apilist");
+    memory->create(apnumneigh,apmaxatom,"pair_softcore:apnumneigh");
+    apfirstneigh = (int **)
+      memory->smalloc(apmaxatom*sizeof(int *),"pair_softcore:apfirstneigh");
+  }
+
+  bigint bound = (bigint) nlocal*nall - (bigint) nlocal*(nlocal+1)/2;
+  if (bound > MAXSMALLINT)
+    error->one(FLERR,"Pair softcore allpairs table is too large");
+  if (bound > apmaxneigh) {
+    apmaxneigh = bound;
+    memory->destroy(apneigh);
+    memory->create(apneigh,apmaxneigh,"pair_softcore:apneigh");
+  }
+
+  // type pairs not mapped to this sub-style (skip = 1), if any:
+  int **skip = NULL;
+  PairHybridSoftcore *hybrid = dynamic_cast<PairHybridSoftcore*>(force->pair);
+  if (hybrid && hybrid != this) {
+    int ntypes = atom->ntypes;
+    memory->create(skip,ntypes+1,ntypes+1,"pair_softcore:skip");
+    for (i = 1; i <= ntypes; i++)
+      for (j = 1; j <= ntypes; j++) {
+        skip[i][j] = 1;
+        for (int k = 0; k < hybrid->nmap[i][j]; k++)
+          if (hybrid->styles[hybrid->map[i][j][k]] == this) skip[i][j] = 0;
+      }
+  }
+
+  if (!apwarn && nall - nlocal > nlocal) {
+    error->warning(FLERR,"Pair softcore allpairs: more ghost than owned atoms");
+    apwarn = 1;
+  }
+
+  n = 0;
+  for (i = 0; i < nlocal; i++) {
+    apilist[i] = i;
+    apfirstneigh[i] = &apneigh[n];
+    apnumneigh[i] = n;
+    itag = tag[i];
+
+    for (j = i+1; j < nall; j++) {
+      if (j >= nlocal && newton_pair) {
+        jtag = tag[j];
+        if (itag > jtag) {
+          if ((itag+jtag) % 2 == 0) continue;
+        } else if (itag < jtag) {
+          if ((itag+jtag) % 2 == 1) continue;
+        } else {
+          if (x[j][2] < x[i][2]) continue;
+          if (x[j][2] == x[i][2]) {
+            if (x[j][1] < x[i][1]) continue;
+            if (x[j][1] == x[i][1] && x[j][0] < x[i][0]) continue;
+          }
+        }
+      }
+
+      if (skip && skip[type[i]][type[j]]) continue;
+
+      if (molecular) {
+        which = which_special(special[i],nspecial[i],tag[j]);
+        if (which &&
+            domain->minimum_image_check(x[i][0] - x[j][0],x[i][1] - x[j][1],
+                                        x[i][2] - x[j][2]))
+          which = 0;
+        if (which == 0 || sflag[which] == 1) apneigh[n++] = j;
+        else if (sflag[which] == 2) apneigh[n++] = j ^ (which << SBBITS);
+      }
+      else apneigh[n++] = j;
+    }
+    apnumneigh[i] = n - apnumneigh[i];
+  }
+
+  memory->destroy(skip);
+  apinum = nlocal;
+  apstamp = neighbor->ncalls;
 }
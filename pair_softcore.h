@@ -23,6 +23,12 @@ namespace LAMMPS_NS {
 class PairSoftcore : public Pair {
  friend class FixSoftcoreEE;
  friend class ComputeSoftcoreGrid;
+ friend class FixSoftcoreWindows;
+ friend class FixSoftcoreSwitch;
+ friend class ComputeSoftcorePerturb;
+ friend class FixSoftcoreGCMC;
+ friend class ComputeSoftcoreWidom;
+ friend class FixSoftcoreRestraint;
 
  public:
   PairSoftcore(class LAMMPS *);
@@ -32,6 +38,20 @@ class PairSoftcore : public Pair {
   void write_restart(FILE *);
   void read_restart(FILE *);
 
+  // evaluate lambda-related interactions into explicit destinations:
+  // forces are added to the given array, local node energies (if any)
+  // are added to the energy-grid array, and the global virial (if any)
+  // is added to the virial array
+
+  void compute_softcore(double **, double *, double *, int, int);
+  double **scratch_forces();
+
+  // communicator of the procs whose softcore neighbor lists are not
+  // empty (plus proc 0), over which grid energies can be reduced
+
+  MPI_Comm grid_comm(PairSoftcore **, int);
+  void virial_fdotr_compute();
+
  protected:
   double alpha, exponent_n, exponent_p;  // softcore model parameters
   double lambda;                         // coupling parameter value
@@ -43,6 +63,163 @@ class PairSoftcore : public Pair {
   double *ecoulnode;  // total Coulomb potential energy at each node
   double *etailnode;  // tail correction for energy at each node
 
+  int    dudl_enable; // 1 if the kernel can compute dU/dlambda
+  int    dudlflag;    // 1 if dU/dlambda must be computed in the current step
+  double edudl;       // local dU/dlambda of lambda-coupled pairs
+
+  double *typecount;  // total # of atoms of each type, counted at init
+  void count_types();
+
+  // energy-only kernel for test-particle insertion: energy of a virtual
+  // atom of type itype at x with the atoms in jlist (owned or ghost),
+  // added to e at each node of the grid (or to e[0] at the current lambda
+  // if there is no grid); type pairs with active = 0 are skipped if active
+  // is not NULL
+
+  int test_enable;    // 1 if the style implements test_energy()
+  virtual void test_energy(int, double *, int, int *, int **, double *) {}
+
+  // lambda change during a run (fix softcore/switch): styles with
+  // lambda_enable = 1 recompute in lambda_coeffs() only the coefficients
+  // of pair i,j that depend on lambda, keeping mixing and tail corrections
+  // of the latest init; other styles are reinitialized
+
+  int lambda_enable;  // 1 if the style implements lambda_coeffs()
+  virtual void lambda_coeffs(int, int) {}
+  void update_lambda(double);
+
+  // force-field perturbation grid: each node is a set of perturbed
+  // coefficients of some type pairs, evaluated at the current lambda
+
+  int    npert;       // number of perturbation nodes (0 if unsupported)
+  int    pertflag;    // 1 if perturbation energies must be computed now
+  double *epertnode;  // local potential energy at each perturbation node
+  virtual double perturb_tail(int) { return 0.0; }
+
+  // computes of perturbation energies register at init, so that the
+  // energies are computed along with the forces of the steps at which
+  // any of them will be invoked (pertstep = step of the latest ones)
+
+  bigint pertstep;
+  int npertcompute;
+  class Compute **pertcompute;
+  void add_pert_compute(class Compute *);
+  int pert_scheduled();
+
+  enum {NONE,MOLECULE,GROUP};
+  int    decouple;      // NONE, MOLECULE or GROUP (see below)
+  int    decouple_bit;  // groupbit of the solute group in GROUP mode
+  char   *decouple_id;  // ID of the solute group in GROUP mode
+
+  // 1 if atoms i and j interact at full strength regardless of lambda:
+  // MOLECULE = same molecule, GROUP = both inside or both outside group
+
+  inline int uncoupled(int i, int j, tagint *molecule, int *mask) {
+    if (decouple == MOLECULE) return molecule[i] == molecule[j];
+    return !(mask[i] & decouple_bit) == !(mask[j] & decouple_bit);
+  }
+
+  // pairs of types not linked to lambda (pair_modify unlink) always
+  // interact at full strength and are evaluated by the plain kernels
+
+  int unlinked;        // 1 if any pair of types is not linked to lambda
+  int **linkflag;      // 1 if pair of types is linked to lambda, else 0
+  void set_link(char *, char *, int);
+
+  inline double linked_lambda(int itype, int jtype) {
+    return unlinked && !linkflag[itype][jtype] ? 1.0 : lambda;
+  }
+
+  // 1 if atoms i and j of types itype and jtype interact at full strength
+
+  inline int full_strength(int i, int j, int itype, int jtype,
+                           tagint *molecule, int *mask) {
+    if (unlinked && !linkflag[itype][jtype]) return 1;
+    return decouple && uncoupled(i,j,molecule,mask);
+  }
+
+  // share of a pair's grid energy accumulated by this proc: with
+  // newton_pair off and ghost_grid single, a pair shared by two procs
+  // is evaluated by only one of them, chosen by tag ordering
+
+  enum {HALF,SINGLE};
+  int ghost_grid;      // HALF or SINGLE
+
+  inline double grid_share(int i, int j, int nlocal, int newton_pair,
+                           tagint *tag) {
+    if (newton_pair || j < nlocal) return 1.0;
+    if (ghost_grid == HALF || tag[i] == tag[j]) return 0.5;
+    if ((tag[i] + tag[j]) % 2) return tag[i] > tag[j] ? 1.0 : 0.0;
+    return tag[i] < tag[j] ? 1.0 : 0.0;
+  }
+
+  double **fdest;      // force destination of kernels (NULL = atom->f)
+  int nmax_scratch;    // # of atoms that scratch can hold
+  double **scratch;    // force buffer shared by all callers of this style
+
+  double **force_target();
+
+  // packed neighbors of one atom for the fast kernels of regular steps:
+  // rows of dpack are delx, dely, delz, rsq (replaced by fpair), rsq,
+  // special factor and up to NPARAM per-pair parameters, gathered for the
+  // neighbors within cutoff
+
+  enum {NPARAM = 6};
+  int maxpack;         // # of neighbors that the packed arrays can hold
+  int *jpack;          // local index of each packed neighbor
+  double **dpack;      // packed distances, factors and parameters
+  void grow_pack(int);
+
+  // force, energy, grid, dU/dlambda and perturbation loops shared by the
+  // softcore styles, parameterized by a potential policy P, of all pairs
+  // (NORESPA) or of one rRESPA level (see pair_softcore_kernel.h)
+
+  enum {NORESPA,INNER,MIDDLE,OUTER};
+  template <class P> void compute_policy(const P &, int, int, int, double *);
+  template <class P> void compute_scalar(const P &, int, int, double *);
+  template <class P> void compute_packed(const P &, int);
+
+  // kernel of regular steps, i.e. steps without energies, virial per pair,
+  // dU/dlambda or perturbations, tuned separately for steps with forces
+  // only (FORCES) and steps with grid energies (GRID): SCALAR (general
+  // loop), PACKED (packed loop, with the nodes of each pair in a loop over
+  // contiguous node parameters), or AUTO = time both on the first regular
+  // steps of each type in a run and keep the fastest
+
+  enum {SCALAR,PACKED,AUTO};
+  enum {FORCES,GRID};
+  int kernel;          // SCALAR, PACKED or AUTO (set by pair_modify kernel)
+  int tuned[2];        // variant chosen by AUTO (-1 = still tuning)
+  int tunestep[2];     // # of regular steps timed so far
+  double tunestart;    // wall time at the start of the timed step
+  double tunetime[2][2];  // accumulated time of each variant
+  int select_kernel(int);
+  void time_kernel(int, int);
+
+  // all-pairs mode of small systems (pair_modify allpairs N): if the total
+  // # of atoms does not exceed N and the box is not much larger than the
+  // cutoff, the style requests no neighbor list and its kernels run over a
+  // table of all pairs of owned and ghost atoms, rebuilt only when atoms
+  // have been exchanged or sorted
+
+  int allpairs;        // maximum # of atoms for all-pairs mode (0 = off)
+  int allpairs_on;     // 1 if all-pairs mode is used in the current run
+  int allpairs_mode(double);    // decide the mode (see pair_softcore.cpp)
+  double allpairs_ratio(double);  // table size relative to a neighbor list
+  bigint apstamp;      // neighbor build at which the table was made
+  int apwarn;          // 1 if the ghost-atom warning has been issued
+  int apinum;          // # of atoms in the table
+  int apmaxatom;       // # of atoms that the per-atom arrays can hold
+  int apmaxneigh;      // # of entries that the pair table can hold
+  int *apilist,*apnumneigh,**apfirstneigh,*apneigh;
+  void build_allpairs();
+
+  // neighbors of the kernels: the neighbor list or the all-pairs table
+  void neighbors(int &, int *&, int *&, int **&);
+
+  MPI_Comm gridcomm;   // procs holding softcore pairs (NULL if not one)
+  bigint gridstamp;    // neighbor build at which gridcomm was created
+
   void allocate();
   void add_node_to_grid(double);
 };
@@ -64,6 +241,50 @@ E: Incorrect args for pair coefficients
 
 Self-explanatory.  Check the input script or data file.
 
+E: Pair softcore decouple molecule requires atom attribute molecule
+
+Self-explanatory.
+
+E: Could not find pair softcore decouple group ID
+
+Self-explanatory.
+
+E: Pair softcore ghost_grid single requires atom IDs
+
+Pairs shared by two processors are assigned to one of them by atom IDs.
+
+E: Pair softcore allpairs does not support template-based molecular systems
+
+Special neighbors are only resolved for atoms with their own bond
+topology.
+
+E: Pair softcore allpairs table is too large
+
+The all-pairs mode is meant for small systems.  Reduce the threshold
+given by pair_modify allpairs.
+
+W: Pair softcore allpairs: more ghost than owned atoms
+
+The all-pairs table grows with the number of ghost atoms, which is
+large when the box is small compared to the cutoff.  A neighbor list
+may be faster.
+
+W: Pair softcore allpairs is ignored with neigh_modify exclude
+
+Exclusions are only applied by neighbor builds, so a neighbor list is
+used.
+
+W: Pair softcore allpairs is ignored under pair style hybrid
+
+Only pair style hybrid/softcore lets its softcore sub-styles select the
+pairs of their types in the all-pairs table.
+
+W: Pair softcore allpairs is ignored for a box much larger than the cutoff
+
+The owned and ghost atoms of a proc span a volume much larger than the
+cutoff sphere, so a neighbor list has far fewer pairs than the all-pairs
+table.
+
 E: Pair cutoff < Respa interior cutoff
 
 One or more pairwise cutoffs are too short to use with the specified
@@ -0,0 +1,357 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifndef LMP_PAIR_SOFTCORE_KERNEL_H
+#define LMP_PAIR_SOFTCORE_KERNEL_H
+
+#include <math.h>
+#include "pair_softcore.h"
+#include "atom.h"
+#include "force.h"
+#include "neighbor.h"
+#include "neigh_list.h"
+#include "update.h"
+
+namespace LAMMPS_NS {
+
+/* ----------------------------------------------------------------------
+   Kernels shared by all softcore styles, which only differ by the
+   potential policy P. With c = 1 for pairs at full strength (see
+   full_strength()) and U(r) including the energy offset, P provides:
+
+   scalar loops:
+     eval(itype,jtype,c,rsq,eflag,e)  return F(r)/r, and set e = U(r)
+                                      if eflag
+     dudl(itype,jtype,rsq)            dU/dlambda of a lambda-coupled pair
+     nodes(itype,jtype,c,rsq,w,e)     add w*U(r) at each grid node k to e[k]
+     pert(itype,jtype,c,rsq,w,e)      add w*U(r) at each perturbation node
+                                      k to e[k] (empty without perturbations)
+   packed loop:
+     P::NP                        # of per-pair parameters (<= NPARAM)
+     gather(itype,jtype,c,p,n)    store the parameters of a pair of types
+                                  in column n of rows p[0..NP-1]
+     fpair(n,rsq,fc,p)            replace rsq[k] by fc[k]*F(r)/r, k < n
+
+   The kernels run on one thread per MPI task: the package has no /omp
+   variants or per-thread force and energy buffers, which threaded loops
+   would need since both i and j forces are updated with newton_pair on.
+------------------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------------
+   Pair computation of a softcore style, with level = NORESPA for
+   compute(), or INNER, MIDDLE, OUTER for the rRESPA levels, whose
+   switching cutoffs are given by cut_respa. Regular steps (see
+   select_kernel()) may use the packed loop, other steps and all rRESPA
+   levels use the scalar loop. Energies, grid energies, dU/dlambda and
+   perturbation energies are computed with compute() or compute_outer().
+------------------------------------------------------------------------- */
+
+template <class P>
+void PairSoftcore::compute_policy(const P &policy, int eflag, int vflag,
+                                  int level, double *cut_respa)
+{
+  if (level == INNER || level == MIDDLE) {
+    compute_scalar(policy,0,level,cut_respa);
+    return;
+  }
+
+  if (npert && pert_scheduled()) pertflag = 1;
+  if (gridflag) for (int k = 0; k < gridsize; k++) evdwlnode[k] = 0.0;
+  if (pertflag) for (int k = 0; k < npert; k++) epertnode[k] = 0.0;
+  if (dudlflag) edudl = 0.0;
+
+  if (eflag || vflag) ev_setup(eflag,vflag);
+  else evflag = vflag_fdotr = 0;
+
+  // regular steps need forces only, and possibly grid energies:
+  int regular = level == NORESPA && !evflag && !dudlflag && !pertflag;
+  int step = gridflag ? GRID : FORCES;
+  int variant = regular ? select_kernel(step) : SCALAR;
+  if (variant == PACKED) compute_packed(policy,gridflag);
+  else compute_scalar(policy,eflag,level,cut_respa);
+
+  if (vflag_fdotr) virial_fdotr_compute();
+  if (regular) time_kernel(step,variant);
+
+  uptodate = gridflag;
+  if (pertflag) pertstep = update->ntimestep;
+  gridflag = 0;
+  pertflag = 0;
+  dudlflag = 0;
+}
+
+/* ----------------------------------------------------------------------
+   General loop over the pairs of the neighbor list of the level. Forces
+   of the INNER and MIDDLE levels are switched off beyond cut_respa and
+   those of the MIDDLE and OUTER levels are switched on above cut_respa,
+   as in pair lj/cut. The NORESPA and OUTER levels tally energies and
+   virial of the full pair forces and add the grid energies, dU/dlambda
+   and perturbation energies requested in the current step.
+------------------------------------------------------------------------- */
+
+template <class P>
+void PairSoftcore::compute_scalar(const P &policy, int eflag, int level,
+                                  double *cut_respa)
+{
+  int i,j,ii,jj,inum,jnum,itype,jtype,c;
+  double xtmp,ytmp,ztmp,delx,dely,delz,evdwl,fpair,fswitch;
+  double rsq,rsw,factor_lj,dudl,w;
+  int *ilist,*jlist,*numneigh,**firstneigh;
+
+  double **x = atom->x;
+  double **f = force_target();
+  int *type = atom->type;
+  int nlocal = atom->nlocal;
+  double *special_lj = force->special_lj;
+  int newton_pair = force->newton_pair;
+  tagint *molecule = atom->molecule;
+  tagint *tag = atom->tag;
+  int *mask = atom->mask;
+
+  NeighList *rlist = NULL;
+  if (level == INNER) rlist = listinner;
+  else if (level == MIDDLE) rlist = listmiddle;
+  else if (level == OUTER) rlist = listouter;
+  if (rlist) {
+    inum = rlist->inum;
+    ilist = rlist->ilist;
+    numneigh = rlist->numneigh;
+    firstneigh = rlist->firstneigh;
+  } else neighbors(inum,ilist,numneigh,firstneigh);
+
+  // switching of the level: on from cut_in_off to cut_in_on,
+  // off from cut_out_on to cut_out_off
+
+  int switch_in = level == MIDDLE || level == OUTER;
+  int switch_out = level == INNER || level == MIDDLE;
+  double cut_in_off = 0.0, cut_in_on = 0.0;
+  double cut_out_on = 0.0, cut_out_off = 0.0;
+  if (level == INNER) {
+    cut_out_on = cut_respa[0];
+    cut_out_off = cut_respa[1];
+  } else if (level == MIDDLE) {
+    cut_in_off = cut_respa[0];
+    cut_in_on = cut_respa[1];
+    cut_out_on = cut_respa[2];
+    cut_out_off = cut_respa[3];
+  } else if (level == OUTER) {
+    cut_in_off = cut_respa[2];
+    cut_in_on = cut_respa[3];
+  }
+  double cut_in_diff = cut_in_on - cut_in_off;
+  double cut_out_diff = cut_out_off - cut_out_on;
+  double cut_in_off_sq = cut_in_off*cut_in_off;
+  double cut_in_on_sq = cut_in_on*cut_in_on;
+  double cut_out_on_sq = cut_out_on*cut_out_on;
+  double cut_out_off_sq = cut_out_off*cut_out_off;
+
+  // energies and requests of the step are handled by one level only
+
+  int extra = level == NORESPA || level == OUTER;
+  int tally = extra && evflag;
+  int dudlpair = extra && dudlflag;
+  int gridpair = extra && gridflag;
+  int pertpair = extra && pertflag;
+  int share = gridpair || pertpair;
+
+  evdwl = 0.0;
+
+  // loop over neighbors of my atoms
+
+  for (ii = 0; ii < inum; ii++) {
+    i = ilist[ii];
+    xtmp = x[i][0];
+    ytmp = x[i][1];
+    ztmp = x[i][2];
+    itype = type[i];
+    jlist = firstneigh[i];
+    jnum = numneigh[i];
+
+    for (jj = 0; jj < jnum; jj++) {
+      j = jlist[jj];
+      factor_lj = special_lj[sbmask(j)];
+      j &= NEIGHMASK;
+      jtype = type[j];
+
+      delx = xtmp - x[j][0];
+      dely = ytmp - x[j][1];
+      delz = ztmp - x[j][2];
+      rsq = delx*delx + dely*dely + delz*delz;
+
+      if (switch_out ? rsq >= cut_out_off_sq : rsq >= cutsq[itype][jtype])
+        continue;
+      c = full_strength(i,j,itype,jtype,molecule,mask);
+
+      int fon = !switch_in || rsq > cut_in_off_sq;
+      if (fon || tally) {
+        fpair = factor_lj*policy.eval(itype,jtype,c,rsq,eflag,evdwl);
+
+        if (fon) {
+          fswitch = fpair;
+          if (switch_in && rsq < cut_in_on_sq) {
+            rsw = (sqrt(rsq) - cut_in_off)/cut_in_diff;
+            fswitch *= rsw*rsw*(3.0 - 2.0*rsw);
+          }
+          if (switch_out && rsq > cut_out_on_sq) {
+            rsw = (sqrt(rsq) - cut_out_on)/cut_out_diff;
+            fswitch *= 1.0 + rsw*rsw*(2.0*rsw - 3.0);
+          }
+
+          f[i][0] += delx*fswitch;
+          f[i][1] += dely*fswitch;
+          f[i][2] += delz*fswitch;
+          if (newton_pair || j < nlocal) {
+            f[j][0] -= delx*fswitch;
+            f[j][1] -= dely*fswitch;
+            f[j][2] -= delz*fswitch;
+          }
+        }
+
+        if (tally) ev_tally(i,j,nlocal,newton_pair,
+                            factor_lj*evdwl,0.0,fpair,delx,dely,delz);
+      }
+
+      if (dudlpair && !c) {
+        dudl = factor_lj*policy.dudl(itype,jtype,rsq);
+        if (newton_pair || j < nlocal) edudl += dudl;
+        else edudl += 0.5*dudl;
+      }
+
+      if (share) {
+        w = factor_lj*grid_share(i,j,nlocal,newton_pair,tag);
+        if (w != 0.0) {
+          if (gridpair) policy.nodes(itype,jtype,c,rsq,w,evdwlnode);
+          if (pertpair) policy.pert(itype,jtype,c,rsq,w,epertnode);
+        }
+      }
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------
+   Force loop of regular steps (no energies, virial, dU/dlambda or
+   perturbations), with or without grid energies. The neighbors of each
+   atom are packed, keeping only those within the cutoff along with their
+   parameters, so that the arithmetic runs over contiguous arrays without
+   branches and can be vectorized by the compiler. Forces on neighbors are
+   scattered in a serial loop, which is safe even if an atom appears
+   twice. If grid = 1, the energies of the packed pairs at all nodes are
+   then added to evdwlnode, one pair at a time with the nodes in the
+   innermost loop.
+------------------------------------------------------------------------- */
+
+template <class P>
+void PairSoftcore::compute_packed(const P &policy, int grid)
+{
+  int i,j,k,n,ii,jj,inum,jnum,itype,jtype,c;
+  double xtmp,ytmp,ztmp,delx,dely,delz,rsq;
+  double fxtmp,fytmp,fztmp;
+  int *ilist,*jlist,*numneigh,**firstneigh;
+
+  // the policy parameters must fit in the packed arrays:
+  typedef char policy_fits_pack[(int) P::NP <= (int) NPARAM ? 1 : -1];
+  (void) sizeof(policy_fits_pack);
+
+  double **x = atom->x;
+  double **f = force_target();
+  int *type = atom->type;
+  int nlocal = atom->nlocal;
+  double *special_lj = force->special_lj;
+  int newton_pair = force->newton_pair;
+  tagint *molecule = atom->molecule;
+  tagint *tag = atom->tag;
+  int *mask = atom->mask;
+  double w;
+
+  neighbors(inum,ilist,numneigh,firstneigh);
+
+  for (ii = 0; ii < inum; ii++) {
+    i = ilist[ii];
+    xtmp = x[i][0];
+    ytmp = x[i][1];
+    ztmp = x[i][2];
+    itype = type[i];
+    jlist = firstneigh[i];
+    jnum = numneigh[i];
+    double *cutsqi = cutsq[itype];
+
+    if (jnum > maxpack) grow_pack(jnum);
+    double *dx = dpack[0];
+    double *dy = dpack[1];
+    double *dz = dpack[2];
+    double *dr = dpack[3];
+    double *rs = dpack[4];
+    double *fc = dpack[5];
+    double **p = &dpack[6];
+
+    // pack neighbors within the cutoff
+
+    n = 0;
+    for (jj = 0; jj < jnum; jj++) {
+      j = jlist[jj] & NEIGHMASK;
+      delx = xtmp - x[j][0];
+      dely = ytmp - x[j][1];
+      delz = ztmp - x[j][2];
+      rsq = delx*delx + dely*dely + delz*delz;
+      jtype = type[j];
+      if (rsq < cutsqi[jtype]) {
+        c = full_strength(i,j,itype,jtype,molecule,mask);
+        jpack[n] = j;
+        dx[n] = delx;
+        dy[n] = dely;
+        dz[n] = delz;
+        dr[n] = rs[n] = rsq;
+        fc[n] = special_lj[sbmask(jlist[jj])];
+        policy.gather(itype,jtype,c,p,n);
+        n++;
+      }
+    }
+
+    // fpair of all packed neighbors, stored in place of rsq
+
+    policy.fpair(n,dr,fc,p);
+
+    fxtmp = fytmp = fztmp = 0.0;
+    for (k = 0; k < n; k++) {
+      fxtmp += dx[k]*dr[k];
+      fytmp += dy[k]*dr[k];
+      fztmp += dz[k]*dr[k];
+      j = jpack[k];
+      if (newton_pair || j < nlocal) {
+        f[j][0] -= dx[k]*dr[k];
+        f[j][1] -= dy[k]*dr[k];
+        f[j][2] -= dz[k]*dr[k];
+      }
+    }
+    f[i][0] += fxtmp;
+    f[i][1] += fytmp;
+    f[i][2] += fztmp;
+
+    // grid energies of all packed neighbors
+
+    if (grid)
+      for (k = 0; k < n; k++) {
+        j = jpack[k];
+        w = fc[k]*grid_share(i,j,nlocal,newton_pair,tag);
+        if (w != 0.0) {
+          jtype = type[j];
+          c = full_strength(i,j,itype,jtype,molecule,mask);
+          policy.nodes(itype,jtype,c,rs[k],w,evdwlnode);
+        }
+      }
+  }
+}
+
+}
+
+#endif